@@ -16,444 +16,5707 @@
 # ---------------------------------------------------------------------------*/
 
 #include "JPSAStar.hpp"
+#include <cstring>
+#include <fstream>
+#include <queue>
+// Map files are mapped where POSIX provides mmap, other platforms read them
+#if defined(__unix__) || defined(__APPLE__)
+#define JPSASTAR_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 using namespace jpsastar;
 
 
 /**
- *  Generates list of waypoints using node.parent
+ *  Index of the lowest set bit, word must not be zero
+**/
+static inline int lowestBit(uint64_t word){
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while( !((word >> bit) & 1) ) ++bit;
+    return bit;
+#endif
+    }
+
+
+/**
+ *  Index of the highest set bit, word must not be zero
+**/
+static inline int highestBit(uint64_t word){
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    int bit = 63;
+    while( !((word >> bit) & 1) ) --bit;
+    return bit;
+#endif
+    }
+
+
+/**
+ *  Packs the free flags of up to 64 consecutive pixels into a word
+ *
+ *  Compares 32 pixels at once with AVX2 and 16 with SSE2 where the
+ *  compiler targets them, the remaining pixels one by one.
+ *
+ *  \param pixel First pixel, values above 0 are free
+ *  \param count Number of pixels, at most 64
+ *
+ *  \return      Word whose bit i is set if pixel i is free
+**/
+static inline uint64_t packPixels(const uchar *pixel, int count){
+    uint64_t word = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i zero_256 = _mm256_setzero_si256();
+    for(; i + 32 <= count ;i += 32){
+        const __m256i pixels = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pixel + i) );
+        word |= uint64_t( ~uint32_t( _mm256_movemask_epi8( _mm256_cmpeq_epi8(pixels, zero_256) ) ) ) << i;
+        }
+#endif
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= count ;i += 16){
+        const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pixel + i) );
+        word |= uint64_t( ~_mm_movemask_epi8( _mm_cmpeq_epi8(pixels, zero) ) & 0xffff ) << i;
+        }
+#endif
+    for(; i < count ;++i)
+        word |= uint64_t(0 < pixel[i]) << i;
+    return word;
+    }
+
+
+/**
+ *  Transposes a block of 64x64 bits in place
+ *
+ *  Swaps the off-diagonal halves of ever smaller blocks, which takes 6
+ *  rounds of 32 word swaps instead of moving 4096 single bits.
+ *
+ *  \param block 64 words, afterwards bit i of word j holds former bit j of word i
+**/
+static void transposeBits(uint64_t *block){
+    uint64_t mask = 0x00000000ffffffffull;
+    for(int width = 32; width != 0 ;width >>= 1, mask ^= mask << width){
+        for(int k = 0; k < 64 ;k = ((k | width) + 1) & ~width){
+            const uint64_t swapped = ((block[k] >> width) ^ block[k | width]) & mask;
+            block[k] ^= swapped << width;
+            block[k | width] ^= swapped;
+            }
+        }
+    }
+
+
+#ifndef JPSASTAR_NO_STATS
+/**
+ *  Returns the nanoseconds passed since a point in time
+ *
+ *  \param begin Start of the measured interval
+ *
+ *  \return      Elapsed time in nanoseconds
+**/
+static int64_t elapsedNs(const std::chrono::steady_clock::time_point &begin){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+#endif
+
+
+/**
+ *  Throws if a pixel isn't on a map
+ *
+ *  \param grid Map the pixel has to be on
+ *  \param vec  (x,y) of the checked pixel
+ *  \param name Role of the pixel used in the exception message
+ *
+ *  \throws     NotOnMap is thrown if vec isn't on the map.
+**/
+static void checkOnMap(const BitGrid &grid, const cv::Vec2i &vec, const std::string &name){
+    if( !grid.isInside(vec[0], vec[1]) )
+        throw NotOnMap( "[JPSAStar] " + name + " vector ("
+                      + std::to_string(vec[0]) + "," + std::to_string(vec[1])
+                      + ") out of map range ("
+                      + std::to_string(grid.cols()) + "," + std::to_string(grid.rows())
+                      + ")" );
+    }
+
+
+/**
+ *  Writes a value in the byte order of the machine
+**/
+template<typename T>
+static void writeValue(std::ostream &out, const T &value){
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+
+/**
+ *  Writes zero bytes until the stream reaches an offset
+**/
+static void writePadding(std::ostream &out, uint64_t offset){
+    while(uint64_t(out.tellp()) < offset)
+        out.put(0);
+    }
+
+
+/**
+ *  Reads a value written by writeValue
+ *
+ *  \throws std::runtime_error is thrown if the stream ends.
+**/
+template<typename T>
+static T readValue(std::istream &in){
+    T value;
+    if( !in.read(reinterpret_cast<char*>(&value), sizeof(T)) )
+        throw std::runtime_error("[JPSAStar] Unexpected end of cluster graph file");
+    return value;
+    }
+
+
+/**
+ *  Checks if a pixel lies inside a rectangle
+ *
+ *  \param rect Rectangle in map coordinates
+ *  \param vec  (x,y) of the checked pixel
+ *
+ *  \return     True if vec is one of the pixels covered by rect
+**/
+static bool insideRect(const cv::Rect &rect, const cv::Vec2i &vec){
+    return rect.x <= vec[0] && vec[0] < rect.x + rect.width && rect.y <= vec[1] && vec[1] < rect.y + rect.height;
+    }
+
+
+/**
+ *  Orders pixels by row, then by column
+**/
+static bool rowMajorLess(const cv::Vec2i &a, const cv::Vec2i &b){
+    return a[1] < b[1] || (a[1] == b[1] && a[0] < b[0]);
+    }
+
+
+/**
+ *  Orders pixels by column, then by row
+**/
+static bool columnMajorLess(const cv::Vec2i &a, const cv::Vec2i &b){
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+    }
+
+
+/**
+ *  Returns the costs of a straight or diagonal line
+ *
+ *  Every step costs its length times the mean costs of the two pixels
+ *  it connects.
+ *
+ *  \param data Snapshot whose costs are used
+ *  \param from First pixel of the line, must be on the map
+ *  \param to   Last pixel of the line, must be on the map
+ *
+ *  \return     Costs of the line, its Euclidean length if the snapshot has no costs
+**/
+static float lineCosts(const MapData &data, const cv::Vec2i &from, const cv::Vec2i &to){
+    const int dx = to[0] - from[0];
+    const int dy = to[1] - from[1];
+    const float length = std::sqrt( float(dx * dx + dy * dy) );
+    const int steps = std::max(std::abs(dx), std::abs(dy));
+    if(data.costs.empty() || steps == 0)
+        return length;
+    const cv::Vec2i step(dx / steps, dy / steps);
+    cv::Vec2i pixel = from;
+    float previous = data.costs.at<float>(from[1], from[0]);
+    float costs = 0.0;
+    for(int i = 0; i < steps ;++i){
+        pixel += step;
+        const float next = data.costs.at<float>(pixel[1], pixel[0]);
+        costs += 0.5f * (previous + next);
+        previous = next;
+        }
+    return costs * length / steps;
+    }
+
+
+/**
+ *  Returns the costs of a path
+ *
+ *  \param data Snapshot whose costs are used
+ *  \param path Waypoints connected by straight or diagonal lines
+ *
+ *  \return     Sum of the costs of the lines between consecutive waypoints
+**/
+static float pathCosts(const MapData &data, const std::vector<cv::Vec2i> &path){
+    float costs = 0.0;
+    for(size_t i = 1; i < path.size() ;++i)
+        costs += lineCosts(data, path[i - 1], path[i]);
+    return costs;
+    }
+
+
+/**
+ *  Computes a FNV-1a hash of the occupancy and the costs of a snapshot
+ *
+ *  \param data Hashed snapshot
+ *
+ *  \return     Hash of the grid, without costs the same as BitGrid::hash
+**/
+static uint64_t mapHash(const MapData &data){
+    uint64_t hash = data.grid.hash();
+    for(int y = 0; y < data.costs.rows ;++y){
+        const uchar *bytes = data.costs.ptr<uchar>(y);
+        for(size_t i = 0; i < data.costs.cols * sizeof(float) ;++i){
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+            }
+        }
+    return hash;
+    }
+
+
+/**
+ *  Returns the distance of a pixel to the closest pixel of a rectangle
+ *
+ *  \param pixel (x,y) of the pixel
+ *  \param rect  Pixels of the rectangle, must not be empty
+ *
+ *  \return      Euclidean distance, 0 if the pixel is inside
+**/
+static float rectDistance(const cv::Vec2i &pixel, const cv::Rect &rect){
+    int dx = std::max( std::max(rect.x - pixel[0], pixel[0] - (rect.x + rect.width - 1)), 0 );
+    int dy = std::max( std::max(rect.y - pixel[1], pixel[1] - (rect.y + rect.height - 1)), 0 );
+    return std::sqrt( float(dx * dx + dy * dy) );
+    }
+
+
+/**
+ *  Checks with the component labels if a search can reach a target
+ *
+ *  Searches may leave an occupied start through any free neighbor but
+ *  never enter an occupied pixel, and a start equal to the target is
+ *  always reached.
+ *
+ *  \param data   Snapshot of the search
+ *  \param start  (x,y) of the start point, must be on the map
+ *  \param target (x,y) of the target point, must be on the map
+ *
+ *  \return       False if no path exists, true if one may exist or the snapshot has no labels
+**/
+static bool reachable(const MapData &data, const cv::Vec2i &start, const cv::Vec2i &target){
+    const BitGrid &grid = data.grid;
+    const ComponentLabels &components = data.components;
+    if( components.empty() || start == target )
+        return true;
+    if( !grid.isFree(target[0], target[1]) )
+        return false;
+    const uint32_t label = components.label(target[0], target[1]);
+    if( grid.isFree(start[0], start[1]) )
+        return components.label(start[0], start[1]) == label;
+    for(int dir = 0; dir < 8 ;++dir){
+        cv::Vec2i next = start + JumpTable::DIRECTIONS[dir];
+        if( grid.isFree(next[0], next[1]) && components.label(next[0], next[1]) == label )
+            return true;
+        }
+    return false;
+    }
+
+
+/**
+ *  Updates the pixels of uniform costs around a changed region
+ *
+ *  A pixel is uniform if it is free and all its free 8-neighbors have
+ *  the same costs. Changing a pixel changes its neighbors as well.
+ *  Without costs the uniform bits are dropped.
+ *
+ *  \param data Snapshot whose grid and costs are up to date
+ *  \param rect Changed region, has to be on the map
+**/
+static void updateUniform(MapData &data, const cv::Rect &rect){
+    if( data.costs.empty() ){
+        data.uniform = BitGrid();
+        return;
+        }
+    const BitGrid &grid = data.grid;
+    if(data.uniform.cols() != grid.cols() || data.uniform.rows() != grid.rows())
+        data.uniform.assign( cv::Mat(grid.rows(), grid.cols(), CV_8UC1, cv::Scalar(0)) );
+    const cv::Rect around = cv::Rect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2)
+                          & cv::Rect(0, 0, grid.cols(), grid.rows());
+    for(int y = around.y; y < around.y + around.height ;++y){
+        for(int x = around.x; x < around.x + around.width ;++x){
+            bool uniform = grid.isFree(x, y);
+            const float costs = data.costs.at<float>(y, x);
+            for(int ny = y - 1; uniform && ny <= y + 1 ;++ny){
+                for(int nx = x - 1; uniform && nx <= x + 1 ;++nx){
+                    if( grid.isFree(nx, ny) && data.costs.at<float>(ny, nx) != costs )
+                        uniform = false;
+                    }
+                }
+            data.uniform.set(x, y, uniform);
+            }
+        }
+    }
+
+
+/**
+ *  Computes the costs from a pixel to all pixels with Dijkstra's algorithm
+ *
+ *  Moves and step costs are those of a CornerCutting search, so the
+ *  costs are at most those of every movement model.
+ *
+ *  \param data      Snapshot whose grid and costs are used
+ *  \param source    Cell index of a free pixel
+ *  \param distances Receives the costs of every cell, infinity if it can't be reached
+**/
+static void distanceField(const MapData &data, int source, std::vector<double> &distances){
+    typedef std::pair<double, int> Entry;
+    const BitGrid &grid = data.grid;
+    const int cols = grid.cols();
+    const bool costs = !data.costs.empty();
+    const double diagonal = std::sqrt(2.0);
+    distances.assign( size_t(cols) * grid.rows(), std::numeric_limits<double>::infinity() );
+    std::priority_queue< Entry, std::vector<Entry>, std::greater<Entry> > open;
+    distances[source] = 0.0;
+    open.push( Entry(0.0, source) );
+    while( !open.empty() ){
+        const Entry top = open.top();
+        open.pop();
+        // Cells are pushed again instead of decreasing their key
+        if(distances[top.second] < top.first)
+            continue;
+        const int x = top.second % cols;
+        const int y = top.second / cols;
+        const double from_costs = costs ? data.costs.at<float>(y, x) : 1.0;
+        for(int dir = 0; dir < 8 ;++dir){
+            const int nx = x + JumpTable::DIRECTIONS[dir][0];
+            const int ny = y + JumpTable::DIRECTIONS[dir][1];
+            if( !grid.isFree(nx, ny) )
+                continue;
+            const double length = dir % 2 == 0 ? 1.0 : diagonal;
+            const double next = top.first + (costs ? length * 0.5 * (from_costs + data.costs.at<float>(ny, nx)) : length);
+            const int cell = ny * cols + nx;
+            if(next < distances[cell]){
+                distances[cell] = next;
+                open.push( Entry(next, cell) );
+                }
+            }
+        }
+    }
+
+
+/**
+ *  Costs of a step of a CornerCutting search in units of a landmark scale
+ *
+ *  Steps cost the same in both directions, so the units are too.
+ *
+ *  \param data  Snapshot whose costs are used
+ *  \param x     Column of the pixel the step starts at
+ *  \param y     Row of the pixel the step starts at
+ *  \param dir   Index of the step in JumpTable::DIRECTIONS
+ *  \param scale Costs of one unit
+ *
+ *  \return      Costs divided by scale, rounded down, at most LandmarkTable::UNREACHABLE
+**/
+static int stepUnits(const MapData &data, int x, int y, int dir, float scale){
+    const double length = dir % 2 == 0 ? 1.0 : std::sqrt(2.0);
+    double costs = length;
+    if( !data.costs.empty() ){
+        const int nx = x + JumpTable::DIRECTIONS[dir][0];
+        const int ny = y + JumpTable::DIRECTIONS[dir][1];
+        costs = length * 0.5 * (data.costs.at<float>(y, x) + data.costs.at<float>(ny, nx));
+        }
+    return int( std::min(std::floor(costs / scale), double(LandmarkTable::UNREACHABLE)) );
+    }
+
+
+/**
+ *  Picks landmarks for a snapshot and computes their distances
+ *
+ *  \param data  Snapshot whose grid and costs are used
+ *  \param count Number of landmarks, 0 for none
+ *
+ *  \return      New landmark table, NULL if count is 0 or the map has no free pixel
+**/
+static std::shared_ptr<const LandmarkTable> createLandmarks(const MapData &data, int count){
+    if(count == 0)
+        return std::shared_ptr<const LandmarkTable>();
+    std::shared_ptr<LandmarkTable> landmarks = std::make_shared<LandmarkTable>();
+    landmarks->assign(data, count);
+    if(landmarks->count() == 0)
+        return std::shared_ptr<const LandmarkTable>();
+    return landmarks;
+    }
+
+
+/**
+ *  Builds the bit-packed rows and columns of a map
+ *
+ *  \param map 8 bit grey scale image, values above 0 are free
+**/
+void BitGrid::assign(const cv::Mat &map){
+    this->cols_ = map.cols;
+    this->rows_ = map.rows;
+    this->row_words_ = (this->cols_ + 63) / 64 + 2;
+    this->col_words_ = (this->rows_ + 63) / 64 + 2;
+    // Padding lines on both sides plus one word before and after all lines
+    const size_t row_count = size_t(this->rows_ + 2) * this->row_words_ + 2;
+    this->words_.assign(words(this->cols_, this->rows_), 0);
+    this->row_bits_ = this->words_.data();
+    this->col_bits_ = this->words_.data() + row_count;
+    this->owner_.reset();
+    for(int y = 0; y < this->rows_ ;++y){
+        const uchar *pixel = map.ptr<uchar>(y);
+        uint64_t *row = &this->words_[1 + (y + 1) * this->row_words_];
+        for(int x = 0; x < this->cols_ ;x += 64)
+            row[(x >> 6) + 1] = packPixels( pixel + x, std::min(64, this->cols_ - x) );
+        }
+    this->updateColumns( cv::Rect(0, 0, this->cols_, this->rows_) );
+    }
+
+
+/**
+ *  Uses words written by write without copying them
+ *
+ *  \param cols  Number of map columns
+ *  \param rows  Number of map rows
+ *  \param words words(cols, rows) words in the layout of write, 8 byte aligned
+ *  \param owner Keeps words alive as long as the grid or a snapshot uses them
+**/
+void BitGrid::attach(int cols, int rows, const uint64_t *words, const std::shared_ptr<const void> &owner){
+    this->cols_ = cols;
+    this->rows_ = rows;
+    this->row_words_ = (cols + 63) / 64 + 2;
+    this->col_words_ = (rows + 63) / 64 + 2;
+    this->words_.clear();
+    this->row_bits_ = words;
+    this->col_bits_ = words + size_t(rows + 2) * this->row_words_ + 2;
+    this->owner_ = owner;
+    }
+
+
+/**
+ *  Copy constructor, the copy owns its words
+ *
+ *  \param other Grid to copy
+**/
+BitGrid::BitGrid(const BitGrid &other) : row_bits_(NULL), col_bits_(NULL){
+    *this = other;
+    }
+
+
+/**
+ *  Computes a FNV-1a hash of the occupancy
+ *
+ *  \return Hash which differs for different maps with high probability
+**/
+uint64_t BitGrid::hash() const{
+    uint64_t hash = 14695981039346656037ull;
+    const size_t row_count = size_t(this->rows_ + 2) * this->row_words_ + 2;
+    for(size_t i = 0; this->row_bits_ != NULL && i < row_count ;++i){
+        hash ^= this->row_bits_[i];
+        hash *= 1099511628211ull;
+        }
+    return hash;
+    }
+
+
+/**
+ *  Checks if all positions of a span of a line are free
+ *
+ *  \param line  Padded line which is checked
+ *  \param begin First position of the span
+ *  \param end   Last position of the span, not below begin
+ *
+ *  \return      True if all bits from begin to end are set
+**/
+bool BitGrid::isSpanFree(const uint64_t *line, int begin, int end){
+    const int last = (end >> 6) + 1;
+    uint64_t mask = ~uint64_t(0) << (begin & 63);
+    for(int word = (begin >> 6) + 1; word < last ;++word){
+        if( (line[word] & mask) != mask )
+            return false;
+        mask = ~uint64_t(0);
+        }
+    mask &= ~uint64_t(0) >> (63 - (end & 63));
+    return (line[last] & mask) == mask;
+    }
+
+
+/**
+ *  Checks if the straight line between the centers of two pixels only crosses free pixels
+ *
+ *  Flat lines are walked row by row and steep lines column by column.
+ *  The pixels a line crosses in a row or column form one span, which is
+ *  checked a word of the bit-packed line at a time. Takes O(n + m / 64)
+ *  time for a line crossing n rows or columns and m pixels.
+ *
+ *  \param from    (x,y) of the first pixel, must be on the map
+ *  \param to      (x,y) of the last pixel, must be on the map
+ *  \param corners True if pixels which the line only touches at a corner have to be free too
+ *
+ *  \return        True if all crossed pixels are free
+**/
+bool BitGrid::lineOfSight(const cv::Vec2i &from, const cv::Vec2i &to, bool corners) const{
+    // Axis along which the line is longer, the spans run along it
+    const int major = std::abs(to[1] - from[1]) <= std::abs(to[0] - from[0]) ? 0 : 1;
+    const cv::Vec2i &first = from[major] <= to[major] ? from : to;
+    const cv::Vec2i &last = from[major] <= to[major] ? to : from;
+    const int64_t du = last[major] - first[major];
+    const int64_t dv = std::abs(last[1 - major] - first[1 - major]);
+    const int step = last[1 - major] < first[1 - major] ? -1 : 1;
+    for(int64_t k = 0; k <= dv ;++k){
+        const int v = first[1 - major] + int(k) * step;
+        const uint64_t *line = major == 0 ? this->row(v) : this->column(v);
+        int64_t begin = 0, end = du;
+        // The line enters the k-th row or column at (2k - 1) du / 2dv and leaves it at (2k + 1) du / 2dv
+        if(0 < k){
+            const int64_t enter = (2 * k - 1) * du - dv;
+            begin = corners ? (enter + 2 * dv - 1) / (2 * dv) : enter / (2 * dv) + 1;
+            }
+        if(k < dv){
+            const int64_t leave = (2 * k + 1) * du + dv;
+            end = std::min( corners ? leave / (2 * dv) : (leave + 2 * dv - 1) / (2 * dv) - 1, du );
+            }
+        if( !isSpanFree(line, first[major] + int(begin), first[major] + int(end)) )
+            return false;
+        }
+    return true;
+    }
+
+
+/**
+ *  Copies the words of another grid into this one
+ *
+ *  \param other Grid to copy
+ *
+ *  \return      This grid
+**/
+BitGrid& BitGrid::operator=(const BitGrid &other){
+    if(this == &other)
+        return *this;
+    this->cols_ = other.cols_;
+    this->rows_ = other.rows_;
+    this->row_words_ = other.row_words_;
+    this->col_words_ = other.col_words_;
+    this->owner_.reset();
+    if(other.row_bits_ == NULL){
+        this->words_.clear();
+        this->row_bits_ = NULL;
+        this->col_bits_ = NULL;
+        return *this;
+        }
+    this->words_.assign(other.row_bits_, other.row_bits_ + words(this->cols_, this->rows_));
+    this->row_bits_ = this->words_.data();
+    this->col_bits_ = this->words_.data() + (other.col_bits_ - other.row_bits_);
+    return *this;
+    }
+
+
+/**
+ *  Copies attached words, so they can be changed
+**/
+void BitGrid::own(){
+    if(!this->owner_)
+        return;
+    BitGrid copy(*this);
+    this->words_.swap(copy.words_);
+    this->row_bits_ = copy.row_bits_;
+    this->col_bits_ = copy.col_bits_;
+    this->owner_.reset();
+    }
+
+
+/**
+ *  Finds the next position towards lower indices which is occupied or has forced neighbors
+ *
+ *  With corner cutting a position has a forced neighbor if it is
+ *  occupied on a side line and the side line is free at the next lower
+ *  position. Otherwise it has one if it is free on a side line and the
+ *  side line is occupied at the previous, higher position.
+ *
+ *  \param line   Padded line which is scanned
+ *  \param side_a Padded line next to line
+ *  \param side_b Padded line on the other side of line
+ *  \param from   First position to check
+ *
+ *  \return       Found position, -1 if the line start was reached
+**/
+template<bool CORNER_CUTTING>
+int BitGrid::scanBackward(const uint64_t *line, const uint64_t *side_a, const uint64_t *side_b, int from){
+    int word = (from >> 6) + 1;
+    uint64_t mask = ~uint64_t(0) >> (63 - (from & 63));
+    while(true){
+        uint64_t stop;
+        if(CORNER_CUTTING){
+            uint64_t next_a = (side_a[word] << 1) | (side_a[word - 1] >> 63);
+            uint64_t next_b = (side_b[word] << 1) | (side_b[word - 1] >> 63);
+            stop = (~line[word] | (~side_a[word] & next_a) | (~side_b[word] & next_b)) & mask;
+            }
+        else{
+            uint64_t previous_a = (side_a[word] >> 1) | (side_a[word + 1] << 63);
+            uint64_t previous_b = (side_b[word] >> 1) | (side_b[word + 1] << 63);
+            stop = (~line[word] | (side_a[word] & ~previous_a) | (side_b[word] & ~previous_b)) & mask;
+            }
+        if(stop)
+            return (word - 1) * 64 + highestBit(stop);
+        --word;
+        mask = ~uint64_t(0);
+        }
+    }
+
+
+/**
+ *  Finds the next position towards higher indices which is occupied or has forced neighbors
+ *
+ *  With corner cutting a position has a forced neighbor if it is
+ *  occupied on a side line and the side line is free at the next higher
+ *  position. Otherwise it has one if it is free on a side line and the
+ *  side line is occupied at the previous, lower position.
+ *
+ *  \param line   Padded line which is scanned
+ *  \param side_a Padded line next to line
+ *  \param side_b Padded line on the other side of line
+ *  \param from   First position to check
+ *
+ *  \return       Found position, at most the line length
+**/
+template<bool CORNER_CUTTING>
+int BitGrid::scanForward(const uint64_t *line, const uint64_t *side_a, const uint64_t *side_b, int from){
+    int word = (from >> 6) + 1;
+    uint64_t mask = ~uint64_t(0) << (from & 63);
+    while(true){
+        uint64_t stop;
+        if(CORNER_CUTTING){
+            uint64_t next_a = (side_a[word] >> 1) | (side_a[word + 1] << 63);
+            uint64_t next_b = (side_b[word] >> 1) | (side_b[word + 1] << 63);
+            stop = (~line[word] | (~side_a[word] & next_a) | (~side_b[word] & next_b)) & mask;
+            }
+        else{
+            uint64_t previous_a = (side_a[word] << 1) | (side_a[word - 1] >> 63);
+            uint64_t previous_b = (side_b[word] << 1) | (side_b[word - 1] >> 63);
+            stop = (~line[word] | (side_a[word] & ~previous_a) | (side_b[word] & ~previous_b)) & mask;
+            }
+        if(stop)
+            return (word - 1) * 64 + lowestBit(stop);
+        ++word;
+        mask = ~uint64_t(0);
+        }
+    }
+
+
+/**
+ *  Finds the next pixel in a column which is occupied or has forced neighbors
+ *
+ *  \param x    Column of the scan, must be on the map
+ *  \param y    First row to check, must be on the map
+ *  \param step Scan direction, 1 or -1
+ *
+ *  \return     Row of the found pixel, -1 or rows() if the map border was reached
+**/
+int BitGrid::scanColumn(int x, int y, int step) const{
+    if(0 < step)
+        return scanForward<true>(this->column(x), this->column(x - 1), this->column(x + 1), y);
+    return scanBackward<true>(this->column(x), this->column(x - 1), this->column(x + 1), y);
+    }
+
+
+/**
+ *  Finds the next pixel in a column which is occupied or has forced
+ *  neighbors without corner cutting
+ *
+ *  Such a pixel has a free side neighbor whose predecessor in scan
+ *  direction is occupied.
+ *
+ *  \param x    Column of the scan, must be on the map
+ *  \param y    First row to check, must be on the map
+ *  \param step Scan direction, 1 or -1
+ *
+ *  \return     Row of the found pixel, -1 or rows() if the map border was reached
+**/
+int BitGrid::scanColumnPastCorners(int x, int y, int step) const{
+    if(0 < step)
+        return scanForward<false>(this->column(x), this->column(x - 1), this->column(x + 1), y);
+    return scanBackward<false>(this->column(x), this->column(x - 1), this->column(x + 1), y);
+    }
+
+
+/**
+ *  Finds the next pixel in a row which is occupied or has forced neighbors
+ *
+ *  \param x    First column to check, must be on the map
+ *  \param y    Row of the scan, must be on the map
+ *  \param step Scan direction, 1 or -1
+ *
+ *  \return     Column of the found pixel, -1 or cols() if the map border was reached
+**/
+int BitGrid::scanRow(int x, int y, int step) const{
+    if(0 < step)
+        return scanForward<true>(this->row(y), this->row(y - 1), this->row(y + 1), x);
+    return scanBackward<true>(this->row(y), this->row(y - 1), this->row(y + 1), x);
+    }
+
+
+/**
+ *  Finds the next pixel in a row which is occupied or has forced
+ *  neighbors without corner cutting
+ *
+ *  Such a pixel has a free side neighbor whose predecessor in scan
+ *  direction is occupied.
+ *
+ *  \param x    First column to check, must be on the map
+ *  \param y    Row of the scan, must be on the map
+ *  \param step Scan direction, 1 or -1
+ *
+ *  \return     Column of the found pixel, -1 or cols() if the map border was reached
+**/
+int BitGrid::scanRowPastCorners(int x, int y, int step) const{
+    if(0 < step)
+        return scanForward<false>(this->row(y), this->row(y - 1), this->row(y + 1), x);
+    return scanBackward<false>(this->row(y), this->row(y - 1), this->row(y + 1), x);
+    }
+
+
+/**
+ *  Sets the bit of a single pixel
+ *
+ *  \param x    Column of the pixel, must be on the map
+ *  \param y    Row of the pixel, must be on the map
+ *  \param free New value of the bit
+**/
+void BitGrid::set(int x, int y, bool free){
+    this->own();
+    uint64_t &row_word = this->words_[1 + (y + 1) * this->row_words_ + (x >> 6) + 1];
+    uint64_t &col_word = this->words_[(this->col_bits_ - this->row_bits_) + 1 + (x + 1) * this->col_words_ + (y >> 6) + 1];
+    if(free){
+        row_word |= uint64_t(1) << (x & 63);
+        col_word |= uint64_t(1) << (y & 63);
+        }
+    else{
+        row_word &= ~(uint64_t(1) << (x & 63));
+        col_word &= ~(uint64_t(1) << (y & 63));
+        }
+    }
+
+
+/**
+ *  Updates the bits of a region of the map
+ *
+ *  \param map  8 bit grey scale image, values above 0 are free
+ *  \param rect Changed region, has to be on the map
+**/
+void BitGrid::update(const cv::Mat &map, const cv::Rect &rect){
+    if(rect.area() == 0)
+        return;
+    this->own();
+    for(int y = rect.y; y < rect.y + rect.height ;++y){
+        const uchar *pixel = map.ptr<uchar>(y);
+        uint64_t *row = &this->words_[1 + (y + 1) * this->row_words_];
+        // Pixels of a word outside of rect keep their bits
+        for(int x = rect.x; x < rect.x + rect.width ;x = (x | 63) + 1){
+            const int count = std::min( 64 - (x & 63), rect.x + rect.width - x );
+            const uint64_t mask = (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << (x & 63);
+            uint64_t &word = row[(x >> 6) + 1];
+            word = (word & ~mask) | (packPixels(pixel + x, count) << (x & 63));
+            }
+        }
+    this->updateColumns(rect);
+    }
+
+
+/**
+ *  Transposes the rows of all blocks of 64x64 pixels overlapping a region into the columns
+ *
+ *  \param rect Region whose rows are up to date, has to be on the map
+**/
+void BitGrid::updateColumns(const cv::Rect &rect){
+    uint64_t *cols = &this->words_[this->col_bits_ - this->row_bits_];
+    uint64_t block[64];
+    for(int block_y = rect.y >> 6; block_y <= (rect.y + rect.height - 1) >> 6 ;++block_y){
+        for(int block_x = rect.x >> 6; block_x <= (rect.x + rect.width - 1) >> 6 ;++block_x){
+            // Rows below the map are zero, like the padding of the columns
+            for(int i = 0; i < 64 ;++i){
+                const int y = block_y * 64 + i;
+                block[i] = y < this->rows_ ? this->row(y)[block_x + 1] : 0;
+                }
+            transposeBits(block);
+            const int count = std::min(64, this->cols_ - block_x * 64);
+            for(int i = 0; i < count ;++i)
+                cols[1 + (block_x * 64 + i + 1) * this->col_words_ + block_y + 1] = block[i];
+            }
+        }
+    }
+
+
+/**
+ *  Computes the number of words of a grid
+ *
+ *  \param cols Number of map columns
+ *  \param rows Number of map rows
+ *
+ *  \return     Number of words of the padded rows and columns
+**/
+size_t BitGrid::words(int cols, int rows){
+    return size_t(rows + 2) * ((cols + 63) / 64 + 2) + 2 + size_t(cols + 2) * ((rows + 63) / 64 + 2) + 2;
+    }
+
+
+/**
+ *  Writes the padded rows followed by the padded columns
+ *
+ *  \param out Stream opened in binary mode, words are written in the byte order of the machine
+**/
+void BitGrid::write(std::ostream &out) const{
+    if(this->row_bits_ != NULL)
+        out.write( reinterpret_cast<const char*>(this->row_bits_), words(this->cols_, this->rows_) * sizeof(uint64_t) );
+    }
+
+
+/**
+ *  Places the entrances of a cluster and computes the paths between them
+ *
+ *  \param cluster Index of the cluster
+**/
+void ClusterGraph::build(int cluster){
+    Cluster &state = this->clusters_[cluster];
+    state.nodes.clear();
+    for(int side = 0; side < 4 ;++side){
+        state.side_begin[side] = state.nodes.size();
+        this->entrances(cluster, side, state.nodes);
+        }
+    const int count = state.nodes.size();
+    state.side_begin[4] = count;
+    state.costs.assign(count * count, std::numeric_limits<float>::infinity());
+    state.paths.offsets.assign(1, 0);
+    state.paths.waypoints.clear();
+    if(count == 0)
+        return;
+
+    // Jump point search restricted to the pixels of the cluster
+    const cv::Vec2i origin = this->focus(cluster);
+    const MapData &data = *this->cluster_data_;
+    std::vector<cv::Vec2i> &local = this->local_;
+    local.resize(count);
+    for(int i = 0; i < count ;++i)
+        local[i] = state.nodes[i] - origin;
+    PathBatch batch;
+    for(int from = 0; from < count ;++from){
+        this->cluster_searcher_.findPaths(local[from], local, batch);
+        for(int to = 0; to < count ;++to){
+            if( !batch.empty(to) ){
+                float costs = 0.0;
+                for(const cv::Vec2i *it = batch.begin(to); it != batch.end(to) ;++it){
+                    if(it != batch.begin(to))
+                        costs += lineCosts(data, *(it - 1), *it);
+                    state.paths.waypoints.push_back(*it + origin);
+                    }
+                state.costs[from * count + to] = costs;
+                }
+            state.paths.offsets.push_back( state.paths.waypoints.size() );
+            }
+        }
+    }
+
+
+/**
+ *  Constructor, builds the graph of the current map of the engine
+ *
+ *  Takes one multi-target search per entrance on its cluster. Use save
+ *  and load to keep the graph of a large map.
+ *
+ *  \param engine       Engine whose map is searched, must outlive the graph
+ *  \param cluster_size Width and height of the clusters in pixels
+ *
+ *  \throws             std::invalid_argument is thrown if cluster_size is smaller than 2.
+**/
+ClusterGraph::ClusterGraph(const JPSAStar &engine, int cluster_size)
+    : engine_(&engine), cluster_size_(cluster_size), clusters_x_(0), clusters_y_(0), offsets_(1, 0), searcher_(engine),
+      cluster_data_(std::make_shared<MapData>()), cluster_searcher_(cluster_data_){
+    if(cluster_size < 2)
+        throw std::invalid_argument("[JPSAStar] Clusters have to be at least 2 pixels wide");
+    this->sync();
+    }
+
+
+/**
+ *  Returns the pixels covered by a cluster
+ *
+ *  \param cluster Index of the cluster
+ *
+ *  \return        Rectangle of the cluster, clusters at the right and lower border may be smaller
+**/
+cv::Rect ClusterGraph::clusterRect(int cluster) const{
+    const int x = cluster % this->clusters_x_ * this->cluster_size_;
+    const int y = cluster / this->clusters_x_ * this->cluster_size_;
+    return cv::Rect(x, y, std::min(this->cluster_size_, this->data_->grid.cols() - x),
+                          std::min(this->cluster_size_, this->data_->grid.rows() - y));
+    }
+
+
+/**
+ *  Computes the paths from a pixel to all entrances of its cluster
+ *
+ *  \param cluster Index of the cluster containing pixel
+ *  \param pixel   (x,y) in map coordinates
+ *  \param costs   Receives the costs of each node, infinity if not connected
+ *  \param paths   Receives the waypoints to each node in map coordinates
+**/
+void ClusterGraph::connect(int cluster, const cv::Vec2i &pixel, std::vector<float> &costs, PathBatch &paths){
+    const Cluster &state = this->clusters_[cluster];
+    costs.assign(state.nodes.size(), std::numeric_limits<float>::infinity());
+    paths.offsets.assign(state.nodes.size() + 1, 0);
+    paths.waypoints.clear();
+    if( state.nodes.empty() )
+        return;
+    const cv::Vec2i origin = this->focus(cluster);
+    std::vector<cv::Vec2i> &local = this->local_;
+    local.resize( state.nodes.size() );
+    for(size_t i = 0; i < local.size() ;++i)
+        local[i] = state.nodes[i] - origin;
+    this->cluster_searcher_.findPaths(pixel - origin, local, paths);
+    for(size_t i = 0; i < paths.waypoints.size() ;++i)
+        paths.waypoints[i] += origin;
+    for(size_t i = 0; i < local.size() ;++i){
+        if( paths.empty(i) )
+            continue;
+        costs[i] = 0.0;
+        for(const cv::Vec2i *it = paths.begin(i) + 1; it < paths.end(i) ;++it)
+            costs[i] += lineCosts(*this->data_, *(it - 1), *it);
+        }
+    }
+
+
+/**
+ *  Finds the entrances on one side of a cluster
+ *
+ *  Pixels on both sides of the border have to be free. A run of such
+ *  pixels shorter than 6 gets one entrance in its middle, longer runs
+ *  one at each end. Both clusters of a border find the same entrances
+ *  in the same order, so the k-th node on a side is connected to the
+ *  k-th node on the opposite side of the neighbor.
+ *
+ *  \param cluster Index of the cluster
+ *  \param side    0 left, 1 right, 2 top, 3 bottom
+ *  \param pixels  Pixels of the entrances inside the cluster are appended
+**/
+void ClusterGraph::entrances(int cluster, int side, std::vector<cv::Vec2i> &pixels) const{
+    static const cv::Vec2i outward[4] = { cv::Vec2i(-1, 0), cv::Vec2i(1, 0), cv::Vec2i(0, -1), cv::Vec2i(0, 1) };
+    if(this->neighbor(cluster, side) == -1)
+        return;
+    const BitGrid &grid = this->data_->grid;
+    const cv::Rect rect = this->clusterRect(cluster);
+    // First pixel of the border inside the cluster and the step along the border
+    cv::Vec2i first(side == 1 ? rect.x + rect.width - 1 : rect.x, side == 3 ? rect.y + rect.height - 1 : rect.y);
+    cv::Vec2i step = side < 2 ? cv::Vec2i(0, 1) : cv::Vec2i(1, 0);
+    const int length = side < 2 ? rect.height : rect.width;
+    int run = 0;
+    for(int i = 0; i <= length ;++i){
+        cv::Vec2i pixel = first + i * step;
+        cv::Vec2i other = pixel + outward[side];
+        if( i < length && grid.isFree(pixel[0], pixel[1]) && grid.isFree(other[0], other[1]) ){
+            ++run;
+            continue;
+            }
+        if(run == 0)
+            continue;
+        if(run < 6)
+            pixels.push_back( first + (i - 1 - run / 2) * step );
+        else{
+            pixels.push_back( first + (i - run) * step );
+            pixels.push_back( first + (i - 1) * step );
+            }
+        run = 0;
+        }
+    }
+
+
+/**
+ *  Generates a path with the graph of entrances
+ *
+ *  Queries within one cluster or between touching clusters, queries
+ *  whose octile distance is below two clusters, from or to occupied
+ *  pixels and queries the graph can't answer are passed to findPath of
+ *  the engine.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *  \param path   Is cleared and receives the waypoints from start to target
+ *
+ *  \return       True if a path was found
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+bool ClusterGraph::findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path){
+    path.clear();
+    this->sync();
+    checkOnMap(this->data_->grid, start, "Start");
+    checkOnMap(this->data_->grid, target, "Target");
+    const int size = this->cluster_size_;
+    const int start_cluster = start[1] / size * this->clusters_x_ + start[0] / size;
+    const int target_cluster = target[1] / size * this->clusters_x_ + target[0] / size;
+    // Near queries would detour through the entrances, a plain search is cheap for them
+    const int dx = std::abs(start[0] - target[0]);
+    const int dy = std::abs(start[1] - target[1]);
+    const float octile = std::max(dx, dy) + (std::sqrt(2.0f) - 1.0f) * std::min(dx, dy);
+    const bool touching =    std::abs(start[0] / size - target[0] / size) <= 1
+                          && std::abs(start[1] / size - target[1] / size) <= 1;
+    // Entrances are free pixels, findPath decides about occupied ends
+    if(   touching || octile < 2 * size
+       || !this->data_->grid.isFree(start[0], start[1]) || !this->data_->grid.isFree(target[0], target[1]) )
+        return this->searcher_.findPath(start, target, path);
+
+    this->connect(start_cluster, start, this->start_costs_, this->start_paths_);
+    this->connect(target_cluster, target, this->target_costs_, this->target_paths_);
+    // Ids of the nodes are offsets_[cluster] + index, start and target follow the last node
+    const int start_id = this->offsets_.back();
+    const int target_id = start_id + 1;
+    auto locate = [this](int id){
+        return int( std::upper_bound(this->offsets_.begin(), this->offsets_.end(), id) - this->offsets_.begin() ) - 1; };
+    auto pixel = [this, &start, &target, start_id, target_id, &locate](int id){
+        if(id == start_id)
+            return start;
+        if(id == target_id)
+            return target;
+        int cluster = locate(id);
+        return this->clusters_[cluster].nodes[id - this->offsets_[cluster]]; };
+    SearchArena &arena = this->arena_;
+    arena.reset(target_id + 1);
+    auto relax = [this, &arena, &pixel, &target](int from, int to, float costs){
+        float g_value = arena.cell(from).g_value + costs;
+        CellState &state = arena.cell(to);
+        if(state.g_value <= g_value)
+            return;
+        state.g_value = g_value;
+        state.parent = from;
+        float f_value = g_value + this->searcher_.distance(pixel(to), target);
+        if( arena.isOpen(to) )
+            arena.update(to, f_value);
+        else
+            arena.push(to, f_value);
+        };
+    arena.cell(start_id).g_value = 0.0;
+    arena.push(start_id, this->searcher_.distance(start, target));
+    while( !arena.empty() ){
+        const int current = arena.pop();
+        if(current == target_id)
+            break;
+        if(current == start_id){
+            for(size_t i = 0; i < this->start_costs_.size() ;++i){
+                if(this->start_costs_[i] < std::numeric_limits<float>::infinity())
+                    relax(current, this->offsets_[start_cluster] + i, this->start_costs_[i]);
+                }
+            continue;
+            }
+        const int cluster = locate(current);
+        const Cluster &state = this->clusters_[cluster];
+        const int count = state.nodes.size();
+        const int index = current - this->offsets_[cluster];
+        for(int to = 0; to < count ;++to){
+            if(to != index && state.costs[index * count + to] < std::numeric_limits<float>::infinity())
+                relax(current, this->offsets_[cluster] + to, state.costs[index * count + to]);
+            }
+        // Straight step to the node on the other side of the entrance
+        int side = 0;
+        while(state.side_begin[side + 1] <= index)
+            ++side;
+        const int other = this->neighbor(cluster, side);
+        const int across = this->offsets_[other] + this->clusters_[other].side_begin[side ^ 1] + index - state.side_begin[side];
+        relax( current, across, lineCosts(*this->data_, pixel(current), pixel(across)) );
+        if(cluster == target_cluster && this->target_costs_[index] < std::numeric_limits<float>::infinity())
+            relax(current, target_id, this->target_costs_[index]);
+        }
+    if( !arena.isClosed(target_id) )
+        return this->searcher_.findPath(start, target, path);
+
+    std::vector<int> nodes;
+    for(int id = arena.cell(target_id).parent; id != start_id; id = arena.cell(id).parent)
+        nodes.push_back(id);
+    std::reverse(nodes.begin(), nodes.end());
+    const int first = nodes.front() - this->offsets_[start_cluster];
+    path.assign( this->start_paths_.begin(first), this->start_paths_.end(first) );
+    for(size_t i = 1; i < nodes.size() ;++i){
+        const int cluster = locate(nodes[i - 1]);
+        if(locate(nodes[i]) != cluster){
+            path.push_back( pixel(nodes[i]) );
+            continue;
+            }
+        const Cluster &state = this->clusters_[cluster];
+        const size_t route = (nodes[i - 1] - this->offsets_[cluster]) * state.nodes.size() + nodes[i] - this->offsets_[cluster];
+        path.insert(path.end(), state.paths.begin(route) + 1, state.paths.end(route));
+        }
+    const int last = nodes.back() - this->offsets_[target_cluster];
+    path.insert( path.end(), std::reverse_iterator<const cv::Vec2i*>(this->target_paths_.end(last) - 1),
+                             std::reverse_iterator<const cv::Vec2i*>(this->target_paths_.begin(last)) );
+    path.erase(std::unique(path.begin(), path.end()), path.end());
+    return true;
+    }
+
+
+/**
+ *  Points cluster_searcher_ to the pixels of a cluster
+ *
+ *  The pixels, costs and grids of cluster_data_ are overwritten, their
+ *  memory is kept for the next cluster.
+ *
+ *  \param cluster Index of the cluster
+ *
+ *  \return        (x,y) of the upper left pixel of the cluster in map coordinates
+**/
+cv::Vec2i ClusterGraph::focus(int cluster){
+    const cv::Rect rect = this->clusterRect(cluster);
+    MapData &data = *this->cluster_data_;
+    data.map = this->data_->map(rect);
+    data.grid.assign(data.map);
+    data.costs = this->data_->costs.empty() ? cv::Mat() : this->data_->costs(rect);
+    updateUniform( data, cv::Rect(0, 0, rect.width, rect.height) );
+    return cv::Vec2i(rect.x, rect.y);
+    }
+
+
+/**
+ *  Replaces the graph with one written by save
+ *
+ *  \param in Stream opened in binary mode
+ *
+ *  \throws   std::runtime_error is thrown if the file is broken or belongs to another map or other costs.
+**/
+void ClusterGraph::load(std::istream &in){
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    if(readValue<uint32_t>(in) != 0x4353504a || readValue<uint32_t>(in) != 1)
+        throw std::runtime_error("[JPSAStar] Not a cluster graph file");
+    const int32_t cols = readValue<int32_t>(in);
+    const int32_t rows = readValue<int32_t>(in);
+    const int32_t cluster_size = readValue<int32_t>(in);
+    if( cols != data->grid.cols() || rows != data->grid.rows() || readValue<uint64_t>(in) != mapHash(*data) )
+        throw std::runtime_error("[JPSAStar] Cluster graph belongs to another map");
+    if(cluster_size < 2)
+        throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+    const int clusters_x = (cols + cluster_size - 1) / cluster_size;
+    const int clusters_y = (rows + cluster_size - 1) / cluster_size;
+    std::vector<Cluster> clusters(clusters_x * clusters_y);
+    for(size_t i = 0; i < clusters.size() ;++i){
+        Cluster &state = clusters[i];
+        const int left = i % clusters_x * cluster_size;
+        const int top = i / clusters_x * cluster_size;
+        const cv::Rect rect(left, top, std::min(cluster_size, cols - left), std::min(cluster_size, rows - top));
+        for(int side = 0; side < 5 ;++side)
+            state.side_begin[side] = readValue<int32_t>(in);
+        // Sides are consecutive ranges of the nodes
+        if(state.side_begin[0] != 0)
+            throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+        for(int side = 0; side < 4 ;++side)
+            if(state.side_begin[side + 1] < state.side_begin[side])
+                throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+        const size_t count = state.side_begin[4];
+        if(int64_t(cluster_size) * 4 < state.side_begin[4])
+            throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+        state.nodes.resize(count);
+        for(size_t n = 0; n < count ;++n){
+            const int x = readValue<int32_t>(in);
+            state.nodes[n] = cv::Vec2i( x, readValue<int32_t>(in) );
+            }
+        // Entrances lie on the border of their side
+        for(int side = 0; side < 4 ;++side){
+            const int border = side == 0 ? rect.x : side == 1 ? rect.x + rect.width - 1 : side == 2 ? rect.y : rect.y + rect.height - 1;
+            for(int n = state.side_begin[side]; n < state.side_begin[side + 1] ;++n)
+                if( !insideRect(rect, state.nodes[n]) || state.nodes[n][side / 2] != border )
+                    throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            }
+        state.costs.resize(count * count);
+        state.paths.offsets.resize(count * count + 1);
+        for(size_t n = 0; n < count * count ;++n){
+            state.costs[n] = readValue<float>(in);
+            // Negative or NaN costs would break the search of the graph
+            if( !(0.0f <= state.costs[n]) )
+                throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            }
+        for(size_t n = 0; n <= count * count ;++n){
+            state.paths.offsets[n] = readValue<uint64_t>(in);
+            if(n == 0 ? state.paths.offsets[n] != 0 : state.paths.offsets[n] < state.paths.offsets[n - 1])
+                throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            }
+        if(state.paths.offsets.back() > size_t(cols) * rows * count * count)
+            throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+        state.paths.waypoints.resize( state.paths.offsets.back() );
+        for(size_t n = 0; n < state.paths.waypoints.size() ;++n){
+            const int x = readValue<int32_t>(in);
+            state.paths.waypoints[n] = cv::Vec2i( x, readValue<int32_t>(in) );
+            if( !insideRect(rect, state.paths.waypoints[n]) )
+                throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            }
+        }
+    // Both clusters of a border have the same entrances, the map border has none
+    for(size_t i = 0; i < clusters.size() ;++i){
+        const int x = i % clusters_x;
+        const int y = i / clusters_x;
+        const int neighbors[4] = { 0 < x ? int(i) - 1 : -1,
+                                   x + 1 < clusters_x ? int(i) + 1 : -1,
+                                   0 < y ? int(i) - clusters_x : -1,
+                                   y + 1 < clusters_y ? int(i) + clusters_x : -1 };
+        const Cluster &state = clusters[i];
+        for(int side = 0; side < 4 ;++side){
+            const int begin = state.side_begin[side];
+            const int count = state.side_begin[side + 1] - begin;
+            if(neighbors[side] == -1){
+                if(count != 0)
+                    throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+                continue;
+                }
+            const Cluster &other = clusters[neighbors[side]];
+            const int other_begin = other.side_begin[side ^ 1];
+            if(other.side_begin[(side ^ 1) + 1] - other_begin != count)
+                throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            for(int n = 0; n < count ;++n)
+                if(state.nodes[begin + n][1 - side / 2] != other.nodes[other_begin + n][1 - side / 2])
+                    throw std::runtime_error("[JPSAStar] Broken cluster graph file");
+            }
+        }
+    this->data_ = data;
+    this->cluster_size_ = cluster_size;
+    this->clusters_x_ = clusters_x;
+    this->clusters_y_ = clusters_y;
+    this->clusters_.swap(clusters);
+    this->offsets_.assign(1, 0);
+    for(size_t i = 0; i < this->clusters_.size() ;++i)
+        this->offsets_.push_back( this->offsets_.back() + this->clusters_[i].side_begin[4] );
+    }
+
+
+/**
+ *  Returns the cluster next to a side of a cluster
+ *
+ *  \param cluster Index of the cluster
+ *  \param side    0 left, 1 right, 2 top, 3 bottom
+ *
+ *  \return        Index of the neighbor, -1 at the map border
+**/
+int ClusterGraph::neighbor(int cluster, int side) const{
+    const int x = cluster % this->clusters_x_ + (side == 1) - (side == 0);
+    const int y = cluster / this->clusters_x_ + (side == 3) - (side == 2);
+    if(x < 0 || this->clusters_x_ <= x || y < 0 || this->clusters_y_ <= y)
+        return -1;
+    return y * this->clusters_x_ + x;
+    }
+
+
+/**
+ *  Builds all clusters of the current snapshot
+**/
+void ClusterGraph::rebuild(){
+    this->clusters_x_ = (this->data_->grid.cols() + this->cluster_size_ - 1) / this->cluster_size_;
+    this->clusters_y_ = (this->data_->grid.rows() + this->cluster_size_ - 1) / this->cluster_size_;
+    this->clusters_.assign(this->clusters_x_ * this->clusters_y_, Cluster());
+    for(size_t i = 0; i < this->clusters_.size() ;++i)
+        this->build(i);
+    }
+
+
+/**
+ *  Writes the graph to a binary file
+ *
+ *  The file stores a hash of the map and its costs, load refuses graphs
+ *  of other maps or costs.
+ *
+ *  \param out Stream opened in binary mode
+**/
+void ClusterGraph::save(std::ostream &out) const{
+    writeValue<uint32_t>(out, 0x4353504a);
+    writeValue<uint32_t>(out, 1);
+    writeValue<int32_t>( out, this->data_->grid.cols() );
+    writeValue<int32_t>( out, this->data_->grid.rows() );
+    writeValue<int32_t>(out, this->cluster_size_);
+    writeValue<uint64_t>( out, mapHash(*this->data_) );
+    for(size_t i = 0; i < this->clusters_.size() ;++i){
+        const Cluster &state = this->clusters_[i];
+        for(int side = 0; side < 5 ;++side)
+            writeValue<int32_t>(out, state.side_begin[side]);
+        for(size_t n = 0; n < state.nodes.size() ;++n){
+            writeValue<int32_t>(out, state.nodes[n][0]);
+            writeValue<int32_t>(out, state.nodes[n][1]);
+            }
+        for(size_t n = 0; n < state.costs.size() ;++n)
+            writeValue<float>(out, state.costs[n]);
+        for(size_t n = 0; n < state.paths.offsets.size() ;++n)
+            writeValue<uint64_t>(out, state.paths.offsets[n]);
+        for(size_t n = 0; n < state.paths.waypoints.size() ;++n){
+            writeValue<int32_t>(out, state.paths.waypoints[n][0]);
+            writeValue<int32_t>(out, state.paths.waypoints[n][1]);
+            }
+        }
+    }
+
+
+/**
+ *  Brings the graph up to date with the map of the engine
+ *
+ *  Clusters touching a changed region are rebuilt, including the
+ *  neighbors sharing a changed border. Unknown changes rebuild all.
+**/
+void ClusterGraph::sync(){
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    std::vector<cv::Rect> regions;
+    if(   !this->data_ || data->grid.cols() != this->data_->grid.cols() || data->grid.rows() != this->data_->grid.rows()
+       || !this->engine_->changes(this->data_->version, data->version, regions) ){
+        this->data_ = data;
+        this->rebuild();
+        }
+    else{
+        this->data_ = data;
+        if( regions.empty() )
+            return;
+        std::vector<bool> dirty(this->clusters_.size(), false);
+        const int size = this->cluster_size_;
+        for(size_t i = 0; i < regions.size() ;++i){
+            const cv::Rect &region = regions[i];
+            if(region.area() == 0)
+                continue;
+            // Entrances depend on the pixels on both sides of a border
+            const int left = std::max(region.x - 1, 0) / size;
+            const int top = std::max(region.y - 1, 0) / size;
+            const int right = std::min(region.x + region.width, data->grid.cols() - 1) / size;
+            const int bottom = std::min(region.y + region.height, data->grid.rows() - 1) / size;
+            for(int y = top; y <= bottom ;++y){
+                for(int x = left; x <= right ;++x)
+                    dirty[y * this->clusters_x_ + x] = true;
+                }
+            }
+        for(size_t i = 0; i < dirty.size() ;++i){
+            if(dirty[i])
+                this->build(i);
+            }
+        }
+    this->offsets_.assign(1, 0);
+    for(size_t i = 0; i < this->clusters_.size() ;++i)
+        this->offsets_.push_back( this->offsets_.back() + this->clusters_[i].side_begin[4] );
+    }
+
+
+/**
+ *  Labels the components of all free pixels
+ *
+ *  Runs of free pixels get the label of the runs they touch in the row
+ *  above, labels of runs touching several runs are merged. A second
+ *  pass replaces all labels by their roots.
+ *
+ *  \param grid Occupancy to label
+**/
+void ComponentLabels::assign(const BitGrid &grid){
+    const int cols = grid.cols();
+    this->cols_ = cols;
+    this->cells_ = size_t(cols) * grid.rows();
+    this->owned_.assign(this->cells_, 0);
+    this->labels_ = this->owned_.data();
+    this->owner_.reset();
+    // Label 0 marks occupied pixels
+    this->parents_.assign(1, 0);
+    this->ranks_.assign(1, 0);
+    // Begin, end and label of the runs of the previous and the current row
+    std::vector<int> previous, current;
+    for(int y = 0; y < grid.rows() ;++y){
+        uint32_t *row = &this->owned_[size_t(y) * cols];
+        current.clear();
+        size_t above = 0;
+        for(int x = 0; x < cols ;++x){
+            if( !grid.isFree(x, y) )
+                continue;
+            const int begin = x;
+            while( x < cols && grid.isFree(x, y) )
+                ++x;
+            // Runs above touch diagonally up to one pixel beyond both ends
+            while(above < previous.size() && previous[above + 1] < begin)
+                above += 3;
+            uint32_t label = 0;
+            for(size_t i = above; i < previous.size() && previous[i] <= x ;i += 3)
+                label = label == 0 ? previous[i + 2] : this->unite(label, previous[i + 2]);
+            if(label == 0)
+                label = this->newLabel();
+            std::fill(row + begin, row + x, label);
+            current.push_back(begin);
+            current.push_back(x);
+            current.push_back(label);
+            }
+        previous.swap(current);
+        }
+    for(size_t i = 0; i < this->cells_ ;++i)
+        this->owned_[i] = this->find(this->owned_[i]);
+    }
+
+
+/**
+ *  Uses labels written by write without copying them
+ *
+ *  \param cols   Number of map columns
+ *  \param rows   Number of map rows
+ *  \param labels Root label of each pixel in row-major order, 4 byte aligned
+ *  \param owner  Keeps labels alive as long as the object or a snapshot uses them
+**/
+void ComponentLabels::attach(int cols, int rows, const uint32_t *labels, const std::shared_ptr<const void> &owner){
+    this->owned_.clear();
+    this->labels_ = labels;
+    this->cols_ = cols;
+    this->cells_ = size_t(cols) * rows;
+    this->parents_.clear();
+    this->ranks_.clear();
+    this->owner_ = owner;
+    }
+
+
+/**
+ *  Copy constructor, the copy owns its labels
+ *
+ *  \param other Labels to copy
+**/
+ComponentLabels::ComponentLabels(const ComponentLabels &other) : labels_(NULL), cols_(0), cells_(0){
+    *this = other;
+    }
+
+
+/**
+ *  Finds the root of a raw label and shortens the path to it
+ *
+ *  \param label Raw label
+ *
+ *  \return      Root label
+**/
+uint32_t ComponentLabels::find(uint32_t label){
+    while(this->parents_[label] != label){
+        this->parents_[label] = this->parents_[this->parents_[label]];
+        label = this->parents_[label];
+        }
+    return label;
+    }
+
+
+/**
+ *  Creates a root label
+ *
+ *  \return New label
+**/
+uint32_t ComponentLabels::newLabel(){
+    this->parents_.push_back( this->parents_.size() );
+    this->ranks_.push_back(0);
+    return this->parents_.size() - 1;
+    }
+
+
+/**
+ *  Copies the labels of another object into this one
+ *
+ *  \param other Labels to copy
+ *
+ *  \return      This object
+**/
+ComponentLabels& ComponentLabels::operator=(const ComponentLabels &other){
+    if(this == &other)
+        return *this;
+    this->owned_.assign(other.labels_, other.labels_ + other.cells_);
+    this->labels_ = this->owned_.data();
+    this->cols_ = other.cols_;
+    this->cells_ = other.cells_;
+    this->parents_ = other.parents_;
+    this->ranks_ = other.ranks_;
+    this->owner_.reset();
+    if( this->parents_.empty() ){
+        // Attached labels are roots
+        uint32_t count = 1;
+        for(size_t i = 0; i < this->cells_ ;++i)
+            count = std::max(count, this->owned_[i] + 1);
+        this->parents_.resize(count);
+        for(uint32_t label = 0; label < count ;++label)
+            this->parents_[label] = label;
+        this->ranks_.assign(count, 0);
+        }
+    return *this;
+    }
+
+
+/**
+ *  Copies attached labels, so they can be changed
+**/
+void ComponentLabels::own(){
+    if(!this->owner_)
+        return;
+    ComponentLabels copy(*this);
+    this->owned_.swap(copy.owned_);
+    this->parents_.swap(copy.parents_);
+    this->ranks_.swap(copy.ranks_);
+    this->labels_ = this->owned_.data();
+    this->owner_.reset();
+    }
+
+
+/**
+ *  Relabels the parts of a component that may have lost their connection
+ *
+ *  Runs one breadth-first search per piece in turns. Searches that meet
+ *  are merged. Once at most one merged search can still grow, the others
+ *  have explored their whole components and keep their new labels. The
+ *  last one is merged with root, so pixels no search reached stay in it.
+ *
+ *  \param grid   Changed occupancy
+ *  \param root   Label of the component before the change
+ *  \param queues Pixels of each piece, used as queues of the searches
+**/
+void ComponentLabels::split(const BitGrid &grid, uint32_t root, std::vector< std::vector<int> > &queues){
+    const int cols = this->cols_;
+    uint32_t *labels = this->owned_.data();
+    // Labels from first on mark pixels reached by a search
+    const uint32_t first = this->parents_.size();
+    std::vector<uint32_t> searches( queues.size() );
+    std::vector<size_t> heads(queues.size(), 0);
+    for(size_t i = 0; i < queues.size() ;++i){
+        searches[i] = this->newLabel();
+        for(size_t n = 0; n < queues[i].size() ;++n)
+            labels[queues[i][n]] = searches[i];
+        }
+    std::vector<uint32_t> merged, growing;
+    bool changed = true;
+    while(true){
+        if(changed){
+            merged.clear();
+            growing.clear();
+            for(size_t i = 0; i < queues.size() ;++i){
+                const uint32_t label = this->find(searches[i]);
+                if( std::find(merged.begin(), merged.end(), label) == merged.end() )
+                    merged.push_back(label);
+                if( heads[i] < queues[i].size() && std::find(growing.begin(), growing.end(), label) == growing.end() )
+                    growing.push_back(label);
+                }
+            if(merged.size() == 1 || growing.size() <= 1)
+                break;
+            changed = false;
+            }
+        for(size_t i = 0; i < queues.size() ;++i){
+            if(queues[i].size() <= heads[i])
+                continue;
+            const int current = queues[i][heads[i]++];
+            const cv::Vec2i current_vec(current % cols, current / cols);
+            for(int dir = 0; dir < 8 ;++dir){
+                cv::Vec2i next = current_vec + JumpTable::DIRECTIONS[dir];
+                if( !grid.isFree(next[0], next[1]) )
+                    continue;
+                const int next_cell = next[1] * cols + next[0];
+                if(first <= labels[next_cell]){
+                    if( this->find(labels[next_cell]) != this->find(searches[i]) ){
+                        this->unite(labels[next_cell], searches[i]);
+                        changed = true;
+                        }
+                    continue;
+                    }
+                labels[next_cell] = searches[i];
+                queues[i].push_back(next_cell);
+                }
+            changed = changed || queues[i].size() <= heads[i];
+            }
+        }
+    this->unite(root, growing.empty() ? merged.front() : growing.front());
+    }
+
+
+/**
+ *  Merges the trees of two labels
+ *
+ *  \param a Raw label
+ *  \param b Raw label
+ *
+ *  \return  Root of the merged tree
+**/
+uint32_t ComponentLabels::unite(uint32_t a, uint32_t b){
+    a = this->find(a);
+    b = this->find(b);
+    if(a == b)
+        return a;
+    if(this->ranks_[a] < this->ranks_[b])
+        std::swap(a, b);
+    this->parents_[b] = a;
+    if(this->ranks_[a] == this->ranks_[b])
+        ++this->ranks_[a];
+    return a;
+    }
+
+
+/**
+ *  Updates the labels after a region of the map changed
+ *
+ *  The free pixels of the region and of the ring of pixels around it are
+ *  split into pieces that are connected within the ring. A piece merges
+ *  the components of its ring pixels. If only pixels were freed, nothing
+ *  else changes. If pixels became occupied, pieces of the same component
+ *  may have lost their connection and are checked by split.
+ *
+ *  \param grid Occupancy after the change
+ *  \param rect Changed region, has to be on the map
+**/
+void ComponentLabels::update(const BitGrid &grid, const cv::Rect &rect){
+    if(rect.area() == 0 || this->empty())
+        return;
+    this->own();
+    // Split off parts get new labels, start over once there are far more labels than pixels
+    if(2 * this->cells_ + 1024 < this->parents_.size()){
+        this->assign(grid);
+        return;
+        }
+    const int cols = this->cols_;
+    uint32_t *labels = this->owned_.data();
+    bool blocked = false;
+    for(int y = rect.y; y < rect.y + rect.height ;++y){
+        for(int x = rect.x; x < rect.x + rect.width ;++x){
+            blocked = blocked || (labels[y * cols + x] != 0 && !grid.isFree(x, y));
+            labels[y * cols + x] = 0;
+            }
+        }
+
+    const cv::Rect area = cv::Rect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2)
+                        & cv::Rect(0, 0, cols, int(this->cells_ / cols));
+    std::vector<int> piece_of(area.area(), -1);
+    std::vector<int> pixels;          // Pixels of all pieces, grouped by piece
+    std::vector<size_t> piece_begin;  // First pixel of each piece, the extra last entry is the number of pixels
+    std::vector<uint32_t> roots;      // Component of each piece before the change, 0 for pieces of freed pixels only
+    for(int y = area.y; y < area.y + area.height ;++y){
+        for(int x = area.x; x < area.x + area.width ;++x){
+            if( piece_of[(y - area.y) * area.width + x - area.x] != -1 || !grid.isFree(x, y) )
+                continue;
+            const int piece = piece_begin.size();
+            piece_begin.push_back( pixels.size() );
+            piece_of[(y - area.y) * area.width + x - area.x] = piece;
+            pixels.push_back(y * cols + x);
+            uint32_t root = 0;
+            for(size_t i = piece_begin.back(); i < pixels.size() ;++i){
+                // Only ring pixels still have labels
+                if(labels[pixels[i]] != 0)
+                    root = root == 0 ? this->find(labels[pixels[i]]) : this->unite(root, labels[pixels[i]]);
+                const cv::Vec2i current_vec(pixels[i] % cols, pixels[i] / cols);
+                for(int dir = 0; dir < 8 ;++dir){
+                    cv::Vec2i next = current_vec + JumpTable::DIRECTIONS[dir];
+                    if(   next[0] < area.x || area.x + area.width <= next[0] || next[1] < area.y || area.y + area.height <= next[1]
+                       || !grid.isFree(next[0], next[1]) )
+                        continue;
+                    int &next_piece = piece_of[(next[1] - area.y) * area.width + next[0] - area.x];
+                    if(next_piece != -1)
+                        continue;
+                    next_piece = piece;
+                    pixels.push_back(next[1] * cols + next[0]);
+                    }
+                }
+            roots.push_back(root);
+            }
+        }
+    piece_begin.push_back( pixels.size() );
+
+    // Pieces of the same component, only pieces of blocked components can be separated
+    std::map< uint32_t, std::vector<int> > groups;
+    for(size_t piece = 0; piece < roots.size() ;++piece){
+        const uint32_t root = roots[piece] == 0 ? this->newLabel() : this->find(roots[piece]);
+        groups[root].push_back(piece);
+        }
+    std::vector< std::vector<int> > queues;
+    for(std::map< uint32_t, std::vector<int> >::iterator group = groups.begin(); group != groups.end() ;++group){
+        const std::vector<int> &pieces = group->second;
+        if(!blocked || pieces.size() == 1){
+            for(size_t i = 0; i < pieces.size() ;++i){
+                for(size_t n = piece_begin[pieces[i]]; n < piece_begin[pieces[i] + 1] ;++n)
+                    labels[pixels[n]] = group->first;
+                }
+            continue;
+            }
+        queues.resize( pieces.size() );
+        for(size_t i = 0; i < pieces.size() ;++i)
+            queues[i].assign(pixels.begin() + piece_begin[pieces[i]], pixels.begin() + piece_begin[pieces[i] + 1]);
+        this->split(grid, group->first, queues);
+        }
+    }
+
+
+/**
+ *  Writes the root label of every pixel in row-major order
+ *
+ *  \param out Stream opened in binary mode, labels are written in the byte order of the machine
+**/
+void ComponentLabels::write(std::ostream &out) const{
+    std::vector<uint32_t> row(this->cols_);
+    for(size_t cell = 0; cell < this->cells_ ;cell += this->cols_){
+        for(int x = 0; x < this->cols_ ;++x)
+            row[x] = this->label(x, cell / this->cols_);
+        out.write( reinterpret_cast<const char*>(row.data()), row.size() * sizeof(uint32_t) );
+        }
+    }
+
+
+/**
+ *  Checks if a jump stops at a pixel because of forced neighbors
+ *
+ *  \param grid      Searched map
+ *  \param current   Pixel reached by the jump
+ *  \param direction Unit vector of the jump direction
+ *
+ *  \return          True if current has at least one forced neighbor
+**/
+bool CornerCutting::hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction){
+    if(direction[0] != 0 && direction[1] != 0){
+        return (   !grid.isFree(current[0], current[1] - direction[1])
+                && grid.isFree(current[0] + direction[0], current[1] - direction[1]) )
+            || (   !grid.isFree(current[0] - direction[0], current[1])
+                && grid.isFree(current[0] - direction[0], current[1] + direction[1]) );
+        }
+    // Vector pointing to one side of the expansion direction
+    cv::Vec2i side(direction[1], direction[0]);
+    return (   !grid.isFree(current[0] + side[0], current[1] + side[1])
+            && grid.isFree(current[0] + side[0] + direction[0], current[1] + side[1] + direction[1]) )
+        || (   !grid.isFree(current[0] - side[0], current[1] - side[1])
+            && grid.isFree(current[0] - side[0] + direction[0], current[1] - side[1] + direction[1]) );
+    }
+
+
+/**
+ *  Appends the natural and forced neighbors of a pixel reached by a move
+ *
+ *  A neighbor behind an occupied side pixel is forced, because the
+ *  shortest path to it passes current.
+ *
+ *  \param grid      Searched map
+ *  \param current   Center pixel for which neighbors will be generated
+ *  \param direction Unit vector from the parent to current
+ *  \param pruned    Natural and forced neighbors of current are appended to this list
+**/
+void CornerCutting::prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned){
+    int x_nat = current[0] + direction[0];
+    int y_nat = current[1] + direction[1];
+    // Diagonal prune case
+    if(direction[0] != 0 && direction[1] != 0){
+        // Natural neighbors
+        if( grid.isFree(x_nat, current[1]) ){
+            pruned.push_back( cv::Vec2i(x_nat, current[1]) );
+            }
+        if( grid.isFree(current[0], y_nat) ){
+            pruned.push_back( cv::Vec2i(current[0], y_nat) );
+            }
+        if( grid.isFree(x_nat, y_nat) ){
+            pruned.push_back( cv::Vec2i(x_nat, y_nat) );
+            }
+        // Forced neighbors
+        if( !grid.isFree(current[0], current[1] - direction[1]) && grid.isFree(x_nat, current[1] - direction[1]) ){
+            pruned.push_back( cv::Vec2i(x_nat, current[1] - direction[1]) );
+            }
+        if( !grid.isFree(current[0] - direction[0], current[1]) && grid.isFree(current[0] - direction[0], y_nat) ){
+            pruned.push_back( cv::Vec2i(current[0] - direction[0], y_nat) );
+            }
+        }
+    // Straight prune case
+    else{
+        // Natural neighbor
+        if( grid.isFree(x_nat, y_nat) ){
+            pruned.push_back( cv::Vec2i(x_nat, y_nat) );
+            }
+        // Forced neighbors, vector pointing to one side of the expansion direction
+        cv::Vec2i side(direction[1], direction[0]);
+        cv::Vec2i blocked = current + side;
+        if( !grid.isFree(blocked[0], blocked[1]) && grid.isFree(blocked[0] + direction[0], blocked[1] + direction[1]) )
+            pruned.push_back(blocked + direction);
+        blocked = current - side;
+        if( !grid.isFree(blocked[0], blocked[1]) && grid.isFree(blocked[0] + direction[0], blocked[1] + direction[1]) )
+            pruned.push_back(blocked + direction);
+        }
+    }
+
+
+/**
+ *  Checks if a jump stops at a pixel because of forced neighbors
+ *
+ *  Only vertical jumps have forced neighbors, a side pixel is forced if
+ *  the side pixel of the previous row is occupied.
+ *
+ *  \param grid      Searched map
+ *  \param current   Pixel reached by the jump
+ *  \param direction Unit vector of the jump direction
+ *
+ *  \return          True if current has at least one forced neighbor
+**/
+bool FourConnected::hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction){
+    if(direction[0] != 0)
+        return false;
+    const int previous = current[1] - direction[1];
+    return    (grid.isFree(current[0] + 1, current[1]) && !grid.isFree(current[0] + 1, previous))
+           || (grid.isFree(current[0] - 1, current[1]) && !grid.isFree(current[0] - 1, previous));
+    }
+
+
+/**
+ *  Appends the natural and forced neighbors of a pixel reached by a move
+ *
+ *  A horizontal move continues in all three free directions. A vertical
+ *  move only turns where the parent could not turn first.
+ *
+ *  \param grid      Searched map
+ *  \param current   Center pixel for which neighbors will be generated
+ *  \param direction Unit vector from the parent to current, must be straight
+ *  \param pruned    Natural and forced neighbors of current are appended to this list
+**/
+void FourConnected::prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned){
+    // Natural neighbor
+    if( grid.isFree(current[0] + direction[0], current[1] + direction[1]) )
+        pruned.push_back(current + direction);
+    // Horizontal prune case
+    if(direction[0] != 0){
+        if( grid.isFree(current[0], current[1] - 1) )
+            pruned.push_back( cv::Vec2i(current[0], current[1] - 1) );
+        if( grid.isFree(current[0], current[1] + 1) )
+            pruned.push_back( cv::Vec2i(current[0], current[1] + 1) );
+        return;
+        }
+    // Forced neighbors of the vertical prune case
+    const int previous = current[1] - direction[1];
+    if( grid.isFree(current[0] - 1, current[1]) && !grid.isFree(current[0] - 1, previous) )
+        pruned.push_back( cv::Vec2i(current[0] - 1, current[1]) );
+    if( grid.isFree(current[0] + 1, current[1]) && !grid.isFree(current[0] + 1, previous) )
+        pruned.push_back( cv::Vec2i(current[0] + 1, current[1]) );
+    }
+
+
+/**
+ *  Creates a map snapshot with all derived data
+ *
+ *  \param map        8 bit grey scale image
+ *  \param preprocess Precompute jump distances if true
+ *
+ *  \return           New snapshot
+**/
+std::shared_ptr<MapData> JPSAStar::createMapData(cv::Mat map, bool preprocess){
+    std::shared_ptr<MapData> data = std::make_shared<MapData>();
+    data->map = map;
+    data->grid.assign(map);
+    data->components.assign(data->grid);
+    if(preprocess)
+        Searcher(data).buildJumpTable(data->jumps);
+    return data;
+    }
+
+
+/**
+ *  Collects the regions changed between two versions of the map
+ *
+ *  Used by Replanner to repair its search instead of starting over.
+ *  setMap changes the whole map, preprocess changes nothing.
+ *
+ *  \param from    Version of the older snapshot
+ *  \param to      Version of the newer snapshot
+ *  \param regions Changed regions are appended to this list
+ *
+ *  \return        False if the changes are no longer known, regions is unchanged then
+**/
+bool JPSAStar::changes(uint64_t from, uint64_t to, std::vector<cv::Rect> &regions) const{
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    uint64_t current = this->snapshot()->version;
+    if(to < from || current < to || HISTORY < current - from)
+        return false;
+    for(uint64_t version = from + 1; version <= to ;++version)
+        regions.push_back(this->history_[version % HISTORY]);
+    return true;
+    }
+
+
+/**
+ *  Returns a clone of the costs
+ *
+ *  \return Costs set by setCosts, empty if all pixels cost 1
+**/
+cv::Mat JPSAStar::costs() const{
+    return this->snapshot()->costs.clone();
+    }
+
+
+/**
+ *  Gernerates path from start to target using a grid map
+ *
+ *  Thread-safe, but concurrent calls are serialized. Use one Searcher per
+ *  thread to run queries in parallel.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *
+ *  \return       Waypoints from start (excluded) to target (included). Empty if no path was found.
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+std::list<cv::Vec2i> JPSAStar::findPath(cv::Vec2i start, cv::Vec2i target) const{
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    return this->searcher_.findPath(start, target);
+    }
+
+
+/**
+ *  Gernerates path from start to target without allocating memory for the result
+ *
+ *  Thread-safe, but concurrent calls are serialized. Use one Searcher per
+ *  thread to run queries in parallel.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *  \param path   Is cleared and receives the waypoints from start to target
+ *  \param stats  Receives the counters and timings of the query if not NULL
+ *
+ *  \return       True if a path was found
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+bool JPSAStar::findPath(const cv::Vec2i &start,
+                        const cv::Vec2i &target,
+                        std::vector<cv::Vec2i> &path,
+                        SearchStats *stats) const{
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    bool found = this->searcher_.findPath(start, target, path);
+    if(stats != NULL)
+        *stats = this->searcher_.stats();
+    return found;
+    }
+
+
+/**
+ *  Generates the paths of a batch of queries in parallel
+ *
+ *  Runs on a thread pool with one thread per hardware thread, which is
+ *  created by the first call. Concurrent calls are serialized. Queries
+ *  with start or target outside of the map get an empty path instead of
+ *  throwing NotOnMap.
+ *
+ *  \param queries Start and target of each query
+ *  \param count   Number of queries
+ *  \param batch   Receives the paths in the order of the queries
+**/
+void JPSAStar::findPaths(const PathQuery *queries, size_t count, PathBatch &batch) const{
+    std::lock_guard<std::mutex> lock(this->pool_mutex_);
+    if(!this->pool_)
+        this->pool_.reset( new QueryPool(*this) );
+    this->pool_->findPaths(queries, count, batch);
+    }
+
+
+/**
+ *  Generates the paths of a batch of queries in parallel
+ *
+ *  \param queries Start and target of each query
+ *  \param batch   Receives the paths in the order of the queries
+**/
+void JPSAStar::findPaths(const std::vector<PathQuery> &queries, PathBatch &batch) const{
+    this->findPaths(queries.data(), queries.size(), batch);
+    }
+
+
+/**
+ *  Generates paths from start to several targets with a single search
+ *
+ *  Thread-safe, but concurrent calls are serialized like findPath.
+ *
+ *  \param start   (x,y) of the start point in map coordinates
+ *  \param targets (x,y) of the target points in map coordinates
+ *  \param batch   Receives one path per target, empty if the target wasn't reached
+ *  \param limit   Number of targets after which the search stops, 0 for all
+ *
+ *  \return        Number of targets with a path
+ *
+ *  \throws        NotOnMap is thrown if start or a target isn't on the map.
+**/
+size_t JPSAStar::findPaths(const cv::Vec2i &start,
+                           const std::vector<cv::Vec2i> &targets,
+                           PathBatch &batch,
+                           size_t limit) const{
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    return this->searcher_.findPaths(start, targets, batch, limit);
+    }
+
+
+/**
+ *  Converts the grey values of a map into costs for setCosts
+ *
+ *  A free pixel with the value v costs 255 / v, so white pixels cost 1
+ *  and darker ones are slower to cross. Occupied pixels cost 1, only an
+ *  occupied start is ever left.
+ *
+ *  \param map 8 bit grey scale image
+ *
+ *  \return    32 bit float costs of the size of map
+**/
+cv::Mat JPSAStar::greyCosts(const cv::Mat &map){
+    cv::Mat costs(map.rows, map.cols, CV_32FC1);
+    for(int y = 0; y < map.rows ;++y){
+        const uchar *pixel = map.ptr<uchar>(y);
+        float *cost = costs.ptr<float>(y);
+        for(int x = 0; x < map.cols ;++x)
+            cost[x] = 0 < pixel[x] ? 255.0f / pixel[x] : 1.0f;
+        }
+    return costs;
+    }
+
+
+/**
+ *  Checks if jump distances are precomputed
+ *
+ *  \return True if preprocess() was called
+**/
+bool JPSAStar::isPreprocessed() const{
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    return this->preprocessed_;
+    }
+
+
+/**
+ *  Constructor
+ *
+ *  The grid map has to be an 8 bit grey scale image. Values below 255
+ *  are considered to be occupied. And a cells/pixels with a value of
+ *  255 is considered to be free space and therefore usable for
+ *  navigation.
+ *
+ *  \param map 8 bit grey scale image
+**/
+JPSAStar::JPSAStar(cv::Mat map)
+    : data_(createMapData(map, false)), preprocessed_(false), landmarks_(0), searcher_(*this), history_(HISTORY){
+    }
+
+
+/**
+ *  Constructor mapping a file written by save
+ *
+ *  The map, the bits, the jump distances and the landmark distances are
+ *  used directly from the file, see load.
+ *
+ *  \param file Path of the file
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be mapped or is broken.
+**/
+JPSAStar::JPSAStar(const std::string &file)
+    : data_(mapFile(file)),
+      preprocessed_(!data_->jumps.empty()),
+      landmarks_(data_->landmarks ? data_->landmarks->count() : 0),
+      searcher_(*this),
+      history_(HISTORY){
+    }
+
+
+/**
+ *  Replaces the map with one from a file written by save
+ *
+ *  The file is mapped read-only and shared, so the pages are loaded on
+ *  first access and processes opening the same file share them. The
+ *  first updateRegion copies the data. Jump distances in the file switch
+ *  the engine to preprocessed, if the engine is preprocessed and the
+ *  file has none, they are computed. Landmarks are handled the same way.
+ *  Costs are replaced by those of the file, a file without costs drops
+ *  them.
+ *
+ *  \param file Path of the file
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be mapped or is broken.
+**/
+void JPSAStar::load(const std::string &file){
+    std::shared_ptr<MapData> data = mapFile(file);
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    if( this->preprocessed_ && data->jumps.empty() )
+        Searcher(data).buildJumpTable(data->jumps);
+    if(0 < this->landmarks_ && !data->landmarks)
+        data->landmarks = createLandmarks(*data, this->landmarks_);
+    this->preprocessed_ = !data->jumps.empty();
+    this->landmarks_ = data->landmarks ? data->landmarks->count() : 0;
+    this->front_.reset();
+    this->spare_.reset();
+    this->front_landmarks_.reset();
+    this->spare_landmarks_.reset();
+    this->publish( data, cv::Rect(0, 0, data->grid.cols(), data->grid.rows()) );
+    }
+
+
+/**
+ *  Returns a clone of the map
+ *
+ *  \return Clone of internally used map
+**/
+cv::Mat JPSAStar::map() const{
+    return this->snapshot()->map.clone();
+    }
+
+
+/**
+ *  Maps a file written by save into memory
+ *
+ *  Only the header and the section table are read, the sections are
+ *  used in place. Without mmap the whole file is read into one buffer
+ *  the sections point into.
+ *
+ *  \param file Path of the file
+ *
+ *  \return     Snapshot pointing into the mapped file
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be mapped or is broken.
+**/
+std::shared_ptr<MapData> JPSAStar::mapFile(const std::string &file){
+#if defined(JPSASTAR_MMAP)
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("[JPSAStar] Can't open map file " + file);
+    struct stat info;
+    void *address = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && 0 < info.st_size)
+        address = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(address == MAP_FAILED)
+        throw std::runtime_error("[JPSAStar] Can't map map file " + file);
+    const uint64_t size = info.st_size;
+    std::shared_ptr<const void> mapping( address, [size](void *bytes){ munmap(bytes, size); } );
+#else
+    std::ifstream in(file.c_str(), std::ios::binary | std::ios::ate);
+    if( !in )
+        throw std::runtime_error("[JPSAStar] Can't open map file " + file);
+    const uint64_t size = uint64_t( in.tellg() );
+    // Words keep the sections 8 byte aligned like the pages of a mapping
+    std::shared_ptr< std::vector<uint64_t> > words = std::make_shared< std::vector<uint64_t> >( (size + 7) / 8 );
+    in.seekg(0);
+    if( !in.read(reinterpret_cast<char*>( words->data() ), size) )
+        throw std::runtime_error("[JPSAStar] Can't read map file " + file);
+    const void *address = words->data();
+    std::shared_ptr<const void> mapping(words, address);
+#endif
+
+    const char *bytes = static_cast<const char*>(address);
+    // Magic, version, columns, rows, number of sections, reserved
+    uint32_t header[6];
+    if(size < sizeof(header))
+        throw std::runtime_error("[JPSAStar] Not a map file " + file);
+    std::memcpy(header, bytes, sizeof(header));
+    if(header[0] != FILE_MAGIC || header[1] != FILE_VERSION)
+        throw std::runtime_error("[JPSAStar] Not a map file " + file);
+    const int cols = int32_t(header[2]);
+    const int rows = int32_t(header[3]);
+    const uint64_t count = header[4];
+    if(cols < 0 || rows < 0 || (size - sizeof(header)) / 24 < count)
+        throw std::runtime_error("[JPSAStar] Broken map file " + file);
+    // Expected size of the map, the grid, the jump distances, the labels and the costs
+    const uint64_t expected[5] = { uint64_t(cols) * rows,
+                                   BitGrid::words(cols, rows) * sizeof(uint64_t),
+                                   uint64_t(cols) * rows * 8 * sizeof(int16_t),
+                                   uint64_t(cols) * rows * sizeof(uint32_t),
+                                   uint64_t(cols) * rows * sizeof(float) };
+    const char *sections[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    uint64_t landmarks_size = 0;
+    uint64_t distances_size = 0;
+    for(uint64_t i = 0; i < count ;++i){
+        uint32_t tag;
+        uint64_t offset, bytes_size;
+        std::memcpy(&tag, bytes + sizeof(header) + i * 24, sizeof(tag));
+        std::memcpy(&offset, bytes + sizeof(header) + i * 24 + 8, sizeof(offset));
+        std::memcpy(&bytes_size, bytes + sizeof(header) + i * 24 + 16, sizeof(bytes_size));
+        if(size < offset || size - offset < bytes_size || offset % 64 != 0)
+            throw std::runtime_error("[JPSAStar] Broken map file " + file);
+        // Unknown sections are left to later versions
+        if(tag < 1 || 7 < tag)
+            continue;
+        // The size of the landmark sections depends on the number of landmarks
+        if(tag == 6)
+            landmarks_size = bytes_size;
+        else if(tag == 7)
+            distances_size = bytes_size;
+        else if(bytes_size != expected[tag - 1])
+            throw std::runtime_error("[JPSAStar] Broken map file " + file);
+        sections[tag - 1] = bytes + offset;
+        }
+    if(sections[0] == NULL || sections[1] == NULL)
+        throw std::runtime_error("[JPSAStar] Broken map file " + file);
+    const uint64_t landmarks = landmarks_size / 8;
+    if(   (sections[5] == NULL) != (sections[6] == NULL) || landmarks_size % 8 != 0
+       || (   sections[5] != NULL
+           && (   landmarks == 0 || distances_size % (landmarks * sizeof(uint16_t)) != 0
+               || distances_size / (landmarks * sizeof(uint16_t)) != uint64_t(cols) * rows) ) )
+        throw std::runtime_error("[JPSAStar] Broken map file " + file);
+
+    std::shared_ptr<MapData> data = std::make_shared<MapData>();
+    data->map = cv::Mat( rows, cols, CV_8UC1, const_cast<char*>(sections[0]) );
+    data->file = mapping;
+    data->grid.attach( cols, rows, reinterpret_cast<const uint64_t*>(sections[1]), mapping );
+    if(sections[2] != NULL)
+        data->jumps.attach( reinterpret_cast<const int16_t*>(sections[2]), size_t(cols) * rows, mapping );
+    // Files written before labels were added
+    if(sections[3] != NULL)
+        data->components.attach( cols, rows, reinterpret_cast<const uint32_t*>(sections[3]), mapping );
+    else
+        data->components.assign(data->grid);
+    if(sections[4] != NULL){
+        data->costs = cv::Mat( rows, cols, CV_32FC1, const_cast<char*>(sections[4]) );
+        updateUniform( *data, cv::Rect(0, 0, cols, rows) );
+        }
+    if(sections[5] != NULL){
+        std::shared_ptr<LandmarkTable> table = std::make_shared<LandmarkTable>();
+        table->attach( sections[5], landmarks, reinterpret_cast<const uint16_t*>(sections[6]), size_t(cols) * rows, mapping );
+        data->landmarks = table;
+        }
+    return data;
+    }
+
+
+/**
+ *  Precomputes jump distances of all pixels (JPS+)
+ *
+ *  Afterwards jump points are looked up in O(1) instead of being scanned
+ *  for. Distances are recomputed by every following setMap call. Takes
+ *  O(rows * cols) time and 16 byte per pixel.
+**/
+void JPSAStar::preprocess(){
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    this->preprocessed_ = true;
+    this->front_.reset();
+    this->spare_.reset();
+    this->front_landmarks_.reset();
+    this->spare_landmarks_.reset();
+    std::shared_ptr<const MapData> current = this->snapshot();
+    std::shared_ptr<MapData> data = createMapData(current->map, true);
+    data->costs = current->costs;
+    data->uniform = current->uniform;
+    data->file = current->file;
+    data->landmarks = current->landmarks;
+    this->publish( data, cv::Rect() );
+    }
+
+
+/**
+ *  Makes a snapshot the current one, update_mutex_ has to be locked
+ *
+ *  \param data    New snapshot, gets the next version
+ *  \param changed Region whose pixels differ from the previous snapshot
+**/
+void JPSAStar::publish(const std::shared_ptr<MapData> &data, const cv::Rect &changed){
+    data->version = this->snapshot()->version + 1;
+    this->history_[data->version % HISTORY] = changed;
+    std::atomic_store( &this->data_, std::shared_ptr<const MapData>(data) );
+    }
+
+
+/**
+ *  Writes the current map and its derived data to a file for load
+ *
+ *  The file starts with the magic number, the format version, the
+ *  number of columns and rows, the number of sections and a reserved
+ *  word, each 32 bit. A table follows with the tag, a reserved word, the
+ *  offset and the size in bytes of each section. Sections are aligned to
+ *  64 bytes: 1 holds the map with one byte per pixel, 2 the words of the
+ *  BitGrid, 3 the jump distances if the map is preprocessed, 4 the
+ *  component labels, 5 the costs as 32 bit floats if costs are set, 6
+ *  the cell index as 32 bit integer and the scale as 32 bit float of
+ *  each landmark and 7 the 16 bit landmark distances if landmarks are
+ *  set. All values are stored in the byte order of the machine.
+ *
+ *  \param file Path of the file, an existing file is replaced
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be written.
+**/
+void JPSAStar::save(const std::string &file) const{
+    std::shared_ptr<const MapData> data = this->snapshot();
+    const int cols = data->grid.cols();
+    const int rows = data->grid.rows();
+    const LandmarkTable *landmarks = data->landmarks.get();
+    const uint64_t sizes[7] = { uint64_t(cols) * rows,
+                                BitGrid::words(cols, rows) * sizeof(uint64_t),
+                                data->jumps.cells() * 8 * sizeof(int16_t),
+                                data->components.cells() * sizeof(uint32_t),
+                                data->costs.total() * sizeof(float),
+                                landmarks ? uint64_t( landmarks->count() ) * 8 : 0,
+                                landmarks ? landmarks->cells() * landmarks->count() * sizeof(uint16_t) : 0 };
+    std::vector<uint32_t> tags;
+    for(uint32_t tag = 1; tag <= 7 ;++tag){
+        if(tag == 1 || 0 < sizes[tag - 1])
+            tags.push_back(tag);
+        }
+    const uint32_t count = tags.size();
+    std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out)
+        throw std::runtime_error("[JPSAStar] Can't open map file " + file);
+    writeValue<uint32_t>(out, FILE_MAGIC);
+    writeValue<uint32_t>(out, FILE_VERSION);
+    writeValue<int32_t>(out, cols);
+    writeValue<int32_t>(out, rows);
+    writeValue<uint32_t>(out, count);
+    writeValue<uint32_t>(out, 0);
+    std::vector<uint64_t> offsets;
+    uint64_t offset = 24 + count * 24;
+    for(uint32_t i = 0; i < count ;++i){
+        offset = (offset + 63) / 64 * 64;
+        offsets.push_back(offset);
+        writeValue<uint32_t>(out, tags[i]);
+        writeValue<uint32_t>(out, 0);
+        writeValue<uint64_t>(out, offset);
+        writeValue<uint64_t>(out, sizes[tags[i] - 1]);
+        offset += sizes[tags[i] - 1];
+        }
+    for(uint32_t i = 0; i < count ;++i){
+        writePadding(out, offsets[i]);
+        if(tags[i] == 1){
+            for(int y = 0; y < rows ;++y)
+                out.write(data->map.ptr<char>(y), cols);
+            }
+        else if(tags[i] == 2)
+            data->grid.write(out);
+        else if(tags[i] == 3)
+            data->jumps.write(out);
+        else if(tags[i] == 4)
+            data->components.write(out);
+        else if(tags[i] == 5){
+            for(int y = 0; y < rows ;++y)
+                out.write(data->costs.ptr<char>(y), cols * sizeof(float));
+            }
+        else if(tags[i] == 6)
+            landmarks->writeLandmarks(out);
+        else
+            landmarks->write(out);
+        }
+    if(!out)
+        throw std::runtime_error("[JPSAStar] Can't write map file " + file);
+    }
+
+
+/**
+ *  Switches findPath between jump point search and any-angle search
+ *
+ *  \param enabled True to run Lazy Theta*, whose paths run in any direction
+**/
+void JPSAStar::setAnyAngle(bool enabled){
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    this->searcher_.setAnyAngle(enabled);
+    }
+
+
+/**
+ *  Switches findPath between unidirectional and bidirectional search
+ *
+ *  \param enabled True to search from start and target at once
+**/
+void JPSAStar::setBidirectional(bool enabled){
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    this->searcher_.setBidirectional(enabled);
+    }
+
+
+/**
+ *  Marks a single pixel as free or occupied
+ *
+ *  Same as updateRegion with a 1x1 patch. Use updateRegion to change
+ *  many pixels at once, every call publishes a new snapshot.
+ *
+ *  \param x        Column of the pixel
+ *  \param y        Row of the pixel
+ *  \param occupied Sets the pixel to 0 if true, to 255 otherwise
+ *
+ *  \throws         NotOnMap is thrown if the pixel isn't on the map.
+**/
+void JPSAStar::setCell(int x, int y, bool occupied){
+    this->updateRegion( cv::Rect(x, y, 1, 1), cv::Mat(1, 1, CV_8UC1, cv::Scalar(occupied ? 0 : 255)) );
+    }
+
+
+/**
+ *  Sets the costs of crossing each pixel
+ *
+ *  A step between two neighbors costs its length times the mean costs
+ *  of both pixels. Costs of at least 1 keep the Euclidean distance a
+ *  lower bound, so preferred lanes cost 1 and slower terrain more.
+ *  Jumps run through regions of equal costs as before. Pixels next to a
+ *  change of the costs stop every jump and are expanded in all
+ *  directions like in A*. The jump distances of preprocess don't know
+ *  about costs and are not used while costs are set. Landmarks are
+ *  rebuilt for the new costs. updateRegion keeps the costs, use
+ *  greyCosts to derive them from the map.
+ *
+ *  \param costs 32 bit float image of the size of the map, copied. Empty to let every pixel cost 1.
+ *
+ *  \throws      std::invalid_argument is thrown if costs doesn't match the map or has values below 1.
+**/
+void JPSAStar::setCosts(const cv::Mat &costs){
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    std::shared_ptr<const MapData> current = this->snapshot();
+    const int cols = current->grid.cols();
+    const int rows = current->grid.rows();
+    if( !costs.empty() ){
+        if(costs.type() != CV_32FC1 || costs.cols != cols || costs.rows != rows)
+            throw std::invalid_argument("[JPSAStar] Costs have to be a 32 bit float image of the size of the map");
+        for(int y = 0; y < rows ;++y){
+            const float *cost = costs.ptr<float>(y);
+            for(int x = 0; x < cols ;++x){
+                if( !(1.0f <= cost[x] && cost[x] < std::numeric_limits<float>::infinity()) )
+                    throw std::invalid_argument("[JPSAStar] Costs have to be finite and at least 1");
+                }
+            }
+        }
+    std::shared_ptr<MapData> data = std::make_shared<MapData>(*current);
+    data->costs = costs.empty() ? cv::Mat() : costs.clone();
+    updateUniform( *data, cv::Rect(0, 0, cols, rows) );
+    data->landmarks = createLandmarks(*data, this->landmarks_);
+    this->front_.reset();
+    this->spare_.reset();
+    this->front_landmarks_.reset();
+    this->spare_landmarks_.reset();
+    this->publish( data, cv::Rect(0, 0, cols, rows) );
+    }
+
+
+/**
+ *  Builds landmarks for the ALT heuristic of all searches
+ *
+ *  Landmarks tighten the heuristic on maps with walls and dead ends, so
+ *  fewer nodes are expanded. Takes O(count * rows * cols * log(rows * cols))
+ *  time and 2 * count byte per pixel. setMap, setCosts and updateRegion calls
+ *  which free pixels rebuild them. save stores them for load.
+ *
+ *  \param count Number of landmarks, 0 to drop them
+ *
+ *  \throws      std::invalid_argument is thrown if count is negative.
+**/
+void JPSAStar::setLandmarks(int count){
+    if(count < 0)
+        throw std::invalid_argument("[JPSAStar] Number of landmarks can't be negative");
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    this->front_.reset();
+    this->spare_.reset();
+    this->front_landmarks_.reset();
+    this->spare_landmarks_.reset();
+    std::shared_ptr<MapData> data = std::make_shared<MapData>(*this->snapshot());
+    data->landmarks = createLandmarks(*data, count);
+    this->landmarks_ = count;
+    this->publish( data, cv::Rect() );
+    }
+
+
+/**
+ *  Sets map used for path planning
+ *
+ *  Jump distances and landmarks are recomputed if they were set before.
+ *  Costs are kept if the new map has the same size, dropped otherwise.
+ *  Queries which are already running finish on the previous map.
+ *
+ *  \param new_map Map used for path planning. Underlying cv::Mat data will not be dublicated.
+**/
+void JPSAStar::setMap(cv::Mat new_map){
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    this->front_.reset();
+    this->spare_.reset();
+    this->front_landmarks_.reset();
+    this->spare_landmarks_.reset();
+    std::shared_ptr<MapData> data = createMapData(new_map, this->preprocessed_);
+    const cv::Rect rect(0, 0, new_map.cols, new_map.rows);
+    std::shared_ptr<const MapData> current = this->snapshot();
+    if(current->costs.size() == new_map.size()){
+        data->costs = current->file ? current->costs.clone() : current->costs;
+        updateUniform(*data, rect);
+        }
+    data->landmarks = createLandmarks(*data, this->landmarks_);
+    this->publish(data, rect);
+    }
+
+
+/**
+ *  Switches the smoothing of the paths of findPath on or off
+ *
+ *  \param enabled True to remove waypoints which the previous waypoint can see past
+**/
+void JPSAStar::setSmoothing(bool enabled){
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    this->searcher_.setSmoothing(enabled);
+    }
+
+
+/**
+ *  Sets the factor of the heuristic of findPath
+ *
+ *  \param weight Factor of the heuristic, paths cost at most weight times as much as a shortest path
+ *
+ *  \throws       std::invalid_argument is thrown if weight is below 1 or not finite.
+**/
+void JPSAStar::setWeight(float weight){
+    std::lock_guard<std::mutex> lock(this->searcher_mutex_);
+    this->searcher_.setWeight(weight);
+    }
+
+
+/**
+ *  Returns the current map snapshot
+ *
+ *  \return Snapshot which stays valid and unchanged while it is referenced
+**/
+std::shared_ptr<const MapData> JPSAStar::snapshot() const{
+    return std::atomic_load(&this->data_);
+    }
+
+
+/**
+ *  Overwrites a region of the map without rebuilding all derived data
+ *
+ *  Only the bits and jump distances affected by the region are updated.
+ *  The snapshot replaced by an update is kept as spare and becomes the
+ *  next snapshot, so an update costs time in the size of the changed
+ *  region and of the jumps running through it. If the spare is still
+ *  used by a running query or a Searcher, the whole snapshot is copied
+ *  instead. Searchers hold their snapshot until their next query.
+ *  The first update copies the map, later changes of the image passed
+ *  to setMap are ignored. Blocked pixels only make paths longer, so the
+ *  landmarks stay valid bounds. Freed pixels lower the distances of the
+ *  landmarks around them, the table is repaired in a copy or in the
+ *  table replaced by the last repair.
+ *
+ *  \param rect  Region of the map that is overwritten
+ *  \param patch 8 bit grey scale image of the size of rect
+ *
+ *  \throws      NotOnMap is thrown if rect isn't on the map.
+ *  \throws      std::invalid_argument is thrown if patch doesn't match rect.
+**/
+void JPSAStar::updateRegion(const cv::Rect &rect, const cv::Mat &patch){
+    std::lock_guard<std::mutex> lock(this->update_mutex_);
+    std::shared_ptr<const MapData> current = this->snapshot();
+    const int cols = current->grid.cols();
+    const int rows = current->grid.rows();
+    if(   rect.x < 0 || rect.y < 0 || rect.width < 0 || rect.height < 0
+       || cols < rect.x + rect.width || rows < rect.y + rect.height )
+        throw NotOnMap( "[JPSAStar] Region (" + std::to_string(rect.x) + "," + std::to_string(rect.y) + ","
+                      + std::to_string(rect.width) + "," + std::to_string(rect.height)
+                      + ") out of map range (" + std::to_string(cols) + "," + std::to_string(rows) + ")" );
+    if(patch.type() != CV_8UC1 || patch.cols != rect.width || patch.rows != rect.height)
+        throw std::invalid_argument("[JPSAStar] Patch has to be an 8 bit grey scale image of the size of the region");
+    bool freed = false;
+    if(current->landmarks){
+        for(int y = 0; y < rect.height && !freed ;++y){
+            const uchar *old_row = current->map.ptr<uchar>(rect.y + y) + rect.x;
+            const uchar *new_row = patch.ptr<uchar>(y);
+            for(int x = 0; x < rect.width && !freed ;++x)
+                freed = 0 < new_row[x] && old_row[x] == 0;
+            }
+        }
+
+    // The own searcher keeps the snapshot of its last query, which is probably the spare
+    {
+        std::unique_lock<std::mutex> searcher_lock(this->searcher_mutex_, std::try_to_lock);
+        if( searcher_lock.owns_lock() )
+            this->searcher_.data_.reset();
+    }
+    std::shared_ptr<MapData> data;
+    cv::Rect stale;
+    if(this->spare_ && this->spare_.use_count() == 1){
+        // Nobody else can get hold of the spare, all reads of it are done
+        std::atomic_thread_fence(std::memory_order_acquire);
+        data.swap(this->spare_);
+        stale = this->stale_;
+        cv::Mat stale_pixels = data->map(stale);
+        current->map(stale).copyTo(stale_pixels);
+        data->grid.update(data->map, stale);
+        data->components.update(data->grid, stale);
+        updateUniform(*data, stale);
+        }
+    else{
+        this->spare_.reset();
+        data = std::make_shared<MapData>(*current);
+        data->map = current->map.clone();
+        // Costs are shared by the snapshots unless they point into the file
+        if(data->file)
+            data->costs = current->costs.clone();
+        data->file.reset();
+        }
+    cv::Mat pixels = data->map(rect);
+    patch.copyTo(pixels);
+    data->grid.update(data->map, rect);
+    data->components.update(data->grid, rect);
+    updateUniform(*data, rect);
+    if( !data->jumps.empty() ){
+        if(cols < JumpTable::FAR_LIMIT && rows < JumpTable::FAR_LIMIT){
+            Searcher searcher(data);
+            if(0 < stale.area())
+                searcher.updateJumpTable(data->jumps, stale);
+            searcher.updateJumpTable(data->jumps, rect);
+            }
+        else
+            Searcher(data).buildJumpTable(data->jumps);
+        }
+    data->landmarks.reset();
+    if(freed){
+        std::shared_ptr<LandmarkTable> landmarks;
+        if(   current->landmarks == this->front_landmarks_
+           && this->spare_landmarks_ && this->spare_landmarks_.use_count() == 1 ){
+            // Like the spare snapshot, the spare table only lacks the cells of the last repair
+            std::atomic_thread_fence(std::memory_order_acquire);
+            landmarks.swap(this->spare_landmarks_);
+            landmarks->copyCells(*current->landmarks, this->stale_landmarks_);
+            }
+        else
+            landmarks = std::make_shared<LandmarkTable>(*current->landmarks);
+        this->stale_landmarks_.clear();
+        landmarks->repair(*data, current->grid, rect, this->stale_landmarks_);
+        if(current->landmarks == this->front_landmarks_)
+            this->spare_landmarks_ = this->front_landmarks_;
+        else
+            this->spare_landmarks_.reset();
+        this->front_landmarks_ = landmarks;
+        data->landmarks = landmarks;
+        }
+    else
+        data->landmarks = current->landmarks;
+
+    this->publish(data, rect);
+    // Snapshots of setMap may share their image with the caller and are never reused
+    if(this->front_ && this->front_ == current){
+        this->spare_ = this->front_;
+        this->stale_ = rect;
+        }
+    this->front_ = data;
+    }
+
+
+const uint32_t JPSAStar::FILE_MAGIC;
+const uint32_t JPSAStar::FILE_VERSION;
+
+
+/**
+ *  Allocates zero distances for all cells of a map
+ *
+ *  \param cols Number of map columns
+ *  \param rows Number of map rows
+**/
+void JumpTable::assign(int cols, int rows){
+    this->cells_ = size_t(cols) * rows;
+    this->owned_.assign(this->cells_ * 8, 0);
+    this->distances_ = this->owned_.data();
+    this->owner_.reset();
+    }
+
+
+/**
+ *  Uses distances written by write without copying them
+ *
+ *  \param distances 8 distances per cell, 2 byte aligned
+ *  \param cells     Number of cells
+ *  \param owner     Keeps distances alive as long as the table or a snapshot uses them
+**/
+void JumpTable::attach(const int16_t *distances, size_t cells, const std::shared_ptr<const void> &owner){
+    this->owned_.clear();
+    this->distances_ = distances;
+    this->cells_ = cells;
+    this->owner_ = owner;
+    }
+
+
+/**
+ *  Drops all distances
+**/
+void JumpTable::clear(){
+    this->owned_.clear();
+    this->distances_ = NULL;
+    this->cells_ = 0;
+    this->owner_.reset();
+    }
+
+
+/**
+ *  Maps a unit direction vector to its index in DIRECTIONS
+ *
+ *  \param vec One of the 8 unit direction vectors
+ *
+ *  \return    Index of vec in DIRECTIONS
+**/
+int JumpTable::direction(const cv::Vec2i &vec){
+    static const int indices[9] = { 5, 6, 7,
+                                    4, -1, 0,
+                                    3, 2, 1 };
+    return indices[(vec[1] + 1) * 3 + vec[0] + 1];
+    }
+
+
+/**
+ *  Copy constructor, the copy owns its distances
+ *
+ *  \param other Table to copy
+**/
+JumpTable::JumpTable(const JumpTable &other) : distances_(NULL), cells_(0){
+    *this = other;
+    }
+
+
+/**
+ *  Copies the distances of another table into this one
+ *
+ *  \param other Table to copy
+ *
+ *  \return      This table
+**/
+JumpTable& JumpTable::operator=(const JumpTable &other){
+    if(this == &other)
+        return *this;
+    this->owned_.assign(other.distances_, other.distances_ + other.cells_ * 8);
+    this->distances_ = this->owned_.data();
+    this->cells_ = other.cells_;
+    this->owner_.reset();
+    return *this;
+    }
+
+
+/**
+ *  Writes the distances of all cells
+ *
+ *  \param out Stream opened in binary mode, distances are written in the byte order of the machine
+**/
+void JumpTable::write(std::ostream &out) const{
+    out.write( reinterpret_cast<const char*>(this->distances_), this->cells_ * 8 * sizeof(int16_t) );
+    }
+
+
+const cv::Vec2i JumpTable::DIRECTIONS[8] = { cv::Vec2i(1, 0), cv::Vec2i(1, 1), cv::Vec2i(0, 1), cv::Vec2i(-1, 1),
+                                             cv::Vec2i(-1, 0), cv::Vec2i(-1, -1), cv::Vec2i(0, -1), cv::Vec2i(1, -1) };
+
+
+/**
+ *  Picks landmarks and computes their distances to all pixels
+ *
+ *  The first landmark is the pixel farthest from a seed pixel of the
+ *  largest component, every further one the pixel farthest from all
+ *  landmarks picked before.
+ *
+ *  \param data  Snapshot whose grid, components and costs are used
+ *  \param count Number of landmarks, fewer are picked if the largest component is smaller
+**/
+void LandmarkTable::assign(const MapData &data, int count){
+    const BitGrid &grid = data.grid;
+    const int cols = grid.cols();
+    this->cells_ = size_t(cols) * grid.rows();
+    this->landmarks_.clear();
+    this->scales_.clear();
+    this->owned_.clear();
+    this->distances_ = NULL;
+    this->owner_.reset();
+    // Landmarks in small components would bound only their own pixels
+    std::map<uint32_t, int> sizes;
+    int seed = -1;
+    int largest = 0;
+    for(int y = 0; y < grid.rows() ;++y)
+        for(int x = 0; x < cols ;++x)
+            if( grid.isFree(x, y) ){
+                const int size = ++sizes[data.components.label(x, y)];
+                if(largest < size)
+                    largest = size;
+                }
+    for(size_t cell = 0; cell < this->cells_ && seed < 0 ;++cell)
+        if( grid.isFree(cell % cols, cell / cols) && sizes[data.components.label(cell % cols, cell / cols)] == largest )
+            seed = cell;
+    count = std::min(count, largest);
+    if(seed < 0 || count <= 0)
+        return;
+    std::vector<double> nearest;
+    std::vector<double> distances;
+    distanceField(data, seed, nearest);
+    for(int i = 0; i < count ;++i){
+        int farthest = -1;
+        for(size_t cell = 0; cell < this->cells_ ;++cell)
+            if( std::isfinite(nearest[cell]) && (farthest < 0 || nearest[farthest] < nearest[cell]) )
+                farthest = cell;
+        // All pixels of the component are landmarks already
+        if(farthest < 0 || nearest[farthest] == 0.0)
+            break;
+        distanceField(data, farthest, distances);
+        double maximum = 0.0;
+        for(size_t cell = 0; cell < this->cells_ ;++cell)
+            if( std::isfinite(distances[cell]) )
+                maximum = std::max(maximum, distances[cell]);
+        // Rounded steps never add up to more than the distances, so the largest one fits
+        this->landmarks_.push_back(farthest);
+        this->scales_.push_back( 0.0 < maximum ? float(maximum / (UNREACHABLE - 1)) : 1.0f );
+        // The seed itself is no landmark, so only the landmarks count
+        for(size_t cell = 0; cell < this->cells_ ;++cell)
+            nearest[cell] = i == 0 ? distances[cell] : std::min(nearest[cell], distances[cell]);
+        }
+    this->owned_.assign(this->cells_ * this->landmarks_.size(), UNREACHABLE);
+    this->distances_ = this->owned_.data();
+    for(size_t i = 0; i < this->landmarks_.size() ;++i)
+        this->fill(data, i);
+    }
+
+
+/**
+ *  Uses landmarks and distances written by writeLandmarks and write without copying the distances
+ *
+ *  \param landmarks Cell index as 32 bit integer and scale as 32 bit float of each landmark
+ *  \param count     Number of landmarks
+ *  \param distances count distances per cell, 2 byte aligned
+ *  \param cells     Number of cells
+ *  \param owner     Keeps distances alive as long as the table or a snapshot uses them
+**/
+void LandmarkTable::attach(const char *landmarks,
+                           int count,
+                           const uint16_t *distances,
+                           size_t cells,
+                           const std::shared_ptr<const void> &owner){
+    this->landmarks_.resize(count);
+    this->scales_.resize(count);
+    for(int i = 0; i < count ;++i){
+        int32_t cell;
+        std::memcpy(&cell, landmarks + i * 8, sizeof(cell));
+        std::memcpy(&this->scales_[i], landmarks + i * 8 + 4, sizeof(float));
+        this->landmarks_[i] = cell;
+        }
+    this->owned_.clear();
+    this->distances_ = distances;
+    this->cells_ = cells;
+    this->owner_ = owner;
+    }
+
+
+/**
+ *  Copies the distances of some cells from a table with the same landmarks
+ *
+ *  \param other Table to copy from
+ *  \param cells Cell index of every cell to copy, may contain duplicates
+**/
+void LandmarkTable::copyCells(const LandmarkTable &other, const std::vector<int> &cells){
+    const size_t count = this->landmarks_.size();
+    for(size_t i = 0; i < cells.size() ;++i){
+        const size_t offset = size_t(cells[i]) * count;
+        std::copy(other.distances_ + offset, other.distances_ + offset + count, this->owned_.begin() + offset);
+        }
+    }
+
+
+/**
+ *  Computes the distances of one landmark to all cells
+ *
+ *  \param data     Snapshot whose grid and costs are used
+ *  \param landmark Index of the landmark
+**/
+void LandmarkTable::fill(const MapData &data, size_t landmark){
+    const size_t count = this->landmarks_.size();
+    for(size_t cell = 0; cell < this->cells_ ;++cell)
+        this->owned_[cell * count + landmark] = UNREACHABLE;
+    this->owned_[size_t(this->landmarks_[landmark]) * count + landmark] = 0;
+    std::vector< std::pair<uint16_t, int> > seeds( 1, std::make_pair(uint16_t(0), this->landmarks_[landmark]) );
+    this->spread(data, landmark, seeds, NULL);
+    }
+
+
+/**
+ *  Copy constructor, the copy owns its distances
+ *
+ *  \param other Table to copy
+**/
+LandmarkTable::LandmarkTable(const LandmarkTable &other) : distances_(NULL), cells_(0){
+    *this = other;
+    }
+
+
+/**
+ *  Copies the landmarks and distances of another table into this one
+ *
+ *  \param other Table to copy
+ *
+ *  \return      This table
+**/
+LandmarkTable& LandmarkTable::operator=(const LandmarkTable &other){
+    if(this == &other)
+        return *this;
+    this->landmarks_ = other.landmarks_;
+    this->scales_ = other.scales_;
+    this->owned_.assign(other.distances_, other.distances_ + other.cells_ * other.landmarks_.size());
+    this->distances_ = this->owned_.data();
+    this->cells_ = other.cells_;
+    this->owner_.reset();
+    return *this;
+    }
+
+
+/**
+ *  Lowers the distances after pixels of a region were freed
+ *
+ *  Every freed pixel takes the shortest distance over its neighbors which
+ *  were free before, then Dijkstra's algorithm spreads the lowered
+ *  distances. The result is the same as computing the distances of the
+ *  landmarks again. Pixels which became occupied keep their distances,
+ *  blocking only lengthens paths, so they still bound the costs. Tables
+ *  attached to a mapped file are read-only, repair needs a table created
+ *  by assign or a copy.
+ *
+ *  \param data    Snapshot after the update whose grid and costs are used
+ *  \param before  Grid before the update
+ *  \param rect    Updated region
+ *  \param changed Receives the cell index of every cell whose distances changed, may contain duplicates
+**/
+void LandmarkTable::repair(const MapData &data, const BitGrid &before, const cv::Rect &rect, std::vector<int> &changed){
+    const BitGrid &grid = data.grid;
+    const int cols = grid.cols();
+    const size_t count = this->landmarks_.size();
+    std::vector< std::pair<uint16_t, int> > seeds;
+    for(size_t i = 0; i < count ;++i){
+        uint16_t *distances = this->owned_.data() + i;
+        seeds.clear();
+        for(int y = rect.y; y < rect.y + rect.height ;++y){
+            for(int x = rect.x; x < rect.x + rect.width ;++x){
+                if( !grid.isFree(x, y) || before.isFree(x, y) )
+                    continue;
+                const int cell = y * cols + x;
+                int distance = cell == this->landmarks_[i] ? 0 : UNREACHABLE;
+                for(int dir = 0; dir < 8 && 0 < distance ;++dir){
+                    const int nx = x + JumpTable::DIRECTIONS[dir][0];
+                    const int ny = y + JumpTable::DIRECTIONS[dir][1];
+                    // Neighbors freed by the same update keep outdated distances until they are seeded
+                    if( !grid.isFree(nx, ny) || !before.isFree(nx, ny) )
+                        continue;
+                    const int next = distances[size_t(ny * cols + nx) * count];
+                    if(next != UNREACHABLE)
+                        distance = std::min( distance, std::min(next + stepUnits(data, x, y, dir, this->scales_[i]), UNREACHABLE - 1) );
+                    }
+                if(distances[size_t(cell) * count] != distance){
+                    distances[size_t(cell) * count] = distance;
+                    changed.push_back(cell);
+                    }
+                if(distance != UNREACHABLE)
+                    seeds.push_back( std::make_pair(uint16_t(distance), cell) );
+                }
+            }
+        this->spread(data, i, seeds, &changed);
+        }
+    }
+
+
+/**
+ *  Lowers the distances of one landmark with Dijkstra's algorithm
+ *
+ *  Distances of the seeds have to be stored already, they are only
+ *  lowered further if a shorter way to them is found.
+ *
+ *  \param data     Snapshot whose grid and costs are used
+ *  \param landmark Index of the landmark
+ *  \param seeds    Distance and cell index of each cell to start from, used up by the search
+ *  \param changed  Receives the cell index of every lowered cell, NULL if not needed
+**/
+void LandmarkTable::spread(const MapData &data,
+                           size_t landmark,
+                           std::vector< std::pair<uint16_t, int> > &seeds,
+                           std::vector<int> *changed){
+    typedef std::pair<uint16_t, int> Entry;
+    const BitGrid &grid = data.grid;
+    const int cols = grid.cols();
+    const size_t count = this->landmarks_.size();
+    const float scale = this->scales_[landmark];
+    uint16_t *distances = this->owned_.data() + landmark;
+    std::priority_queue< Entry, std::vector<Entry>, std::greater<Entry> > open( std::greater<Entry>(), std::move(seeds) );
+    while( !open.empty() ){
+        const Entry top = open.top();
+        open.pop();
+        // Cells are pushed again instead of decreasing their key
+        if(distances[size_t(top.second) * count] < top.first)
+            continue;
+        const int x = top.second % cols;
+        const int y = top.second / cols;
+        for(int dir = 0; dir < 8 ;++dir){
+            const int nx = x + JumpTable::DIRECTIONS[dir][0];
+            const int ny = y + JumpTable::DIRECTIONS[dir][1];
+            if( !grid.isFree(nx, ny) )
+                continue;
+            // Distances beyond the 16 bit range stay at its end, which still bounds the costs
+            const uint16_t next = std::min( top.first + stepUnits(data, x, y, dir, scale), UNREACHABLE - 1 );
+            const int cell = ny * cols + nx;
+            if(next < distances[size_t(cell) * count]){
+                distances[size_t(cell) * count] = next;
+                open.push( Entry(next, cell) );
+                if(changed)
+                    changed->push_back(cell);
+                }
+            }
+        }
+    }
+
+
+/**
+ *  Writes the distances of all cells in the layout attach expects
+ *
+ *  \param out Stream the distances are written to
+**/
+void LandmarkTable::write(std::ostream &out) const{
+    out.write( reinterpret_cast<const char*>(this->distances_), this->cells_ * this->landmarks_.size() * sizeof(uint16_t) );
+    }
+
+
+/**
+ *  Writes the cell index and scale of every landmark in the layout attach expects
+ *
+ *  \param out Stream the landmarks are written to
+**/
+void LandmarkTable::writeLandmarks(std::ostream &out) const{
+    for(size_t i = 0; i < this->landmarks_.size() ;++i){
+        const int32_t cell = this->landmarks_[i];
+        out.write( reinterpret_cast<const char*>(&cell), sizeof(cell) );
+        out.write( reinterpret_cast<const char*>(&this->scales_[i]), sizeof(float) );
+        }
+    }
+
+
+const uint16_t LandmarkTable::UNREACHABLE;
+
+
+/**
+ *  Checks if a jump stops at a pixel because of forced neighbors
+ *
+ *  Only straight jumps have forced neighbors, a side pixel is forced if
+ *  the side pixel next to the parent is occupied.
+ *
+ *  \param grid      Searched map
+ *  \param current   Pixel reached by the jump
+ *  \param direction Unit vector of the jump direction
+ *
+ *  \return          True if current has at least one forced neighbor
+**/
+bool NoCornerCutting::hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction){
+    if(direction[0] != 0 && direction[1] != 0)
+        return false;
+    // Vector pointing to one side of the expansion direction
+    cv::Vec2i side(direction[1], direction[0]);
+    return (   grid.isFree(current[0] + side[0], current[1] + side[1])
+            && !grid.isFree(current[0] + side[0] - direction[0], current[1] + side[1] - direction[1]) )
+        || (   grid.isFree(current[0] - side[0], current[1] - side[1])
+            && !grid.isFree(current[0] - side[0] - direction[0], current[1] - side[1] - direction[1]) );
+    }
+
+
+/**
+ *  Appends the natural and forced neighbors of a pixel reached by a move
+ *
+ *  Diagonal moves have no forced neighbors, as their parent could have
+ *  reached any pixel behind a corner without passing current. A straight
+ *  move turns where the side pixel next to the parent is occupied.
+ *
+ *  \param grid      Searched map
+ *  \param current   Center pixel for which neighbors will be generated
+ *  \param direction Unit vector from the parent to current
+ *  \param pruned    Natural and forced neighbors of current are appended to this list
+**/
+void NoCornerCutting::prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned){
+    const int x_nat = current[0] + direction[0];
+    const int y_nat = current[1] + direction[1];
+    // Diagonal prune case
+    if(direction[0] != 0 && direction[1] != 0){
+        const bool x_free = grid.isFree(x_nat, current[1]);
+        const bool y_free = grid.isFree(current[0], y_nat);
+        if(x_free)
+            pruned.push_back( cv::Vec2i(x_nat, current[1]) );
+        if(y_free)
+            pruned.push_back( cv::Vec2i(current[0], y_nat) );
+        if( x_free && y_free && grid.isFree(x_nat, y_nat) )
+            pruned.push_back( cv::Vec2i(x_nat, y_nat) );
+        return;
+        }
+    // Straight prune case
+    const bool ahead_free = grid.isFree(x_nat, y_nat);
+    if(ahead_free)
+        pruned.push_back( cv::Vec2i(x_nat, y_nat) );
+    // Vector pointing to one side of the expansion direction
+    cv::Vec2i side(direction[1], direction[0]);
+    for(int i = 0; i < 2 ;++i, side = -side){
+        cv::Vec2i beside = current + side;
+        if( !grid.isFree(beside[0], beside[1]) || grid.isFree(beside[0] - direction[0], beside[1] - direction[1]) )
+            continue;
+        pruned.push_back(beside);
+        if( ahead_free && grid.isFree(beside[0] + direction[0], beside[1] + direction[1]) )
+            pruned.push_back(beside + direction);
+        }
+    }
+
+
+/**
+ *  Computes the shortest path tree of a hub
+ *
+ *  Takes a Dijkstra search over the whole map and O(rows + runs) memory.
+ *  Adding a hub twice has no effect.
+ *
+ *  \param hub (x,y) of the hub in map coordinates
+ *
+ *  \throws    NotOnMap is thrown if hub isn't on the map.
+**/
+void PathCache::addHub(const cv::Vec2i &hub){
+    checkOnMap(this->engine_->snapshot()->grid, hub, "Hub");
+    if( this->hubs_.count(key(hub)) )
+        return;
+    Hub &tree = this->hubs_[key(hub)];
+    tree.pixel = hub;
+    this->buildHub(tree);
+    }
+
+
+/**
+ *  Checks if map changes can block a path or open a shorter one
+ *
+ *  A changed pixel only matters if the sum of its distances to start
+ *  and target is at most the length of the path.
+ *
+ *  \param from   Map version the path is known to be a shortest path of
+ *  \param to     Current map version
+ *  \param start  First waypoint of the path
+ *  \param target Last waypoint of the path
+ *  \param length Costs of the path
+ *
+ *  \return       True if a changed region reaches into the ellipse of the path or the changes are unknown
+**/
+bool PathCache::affected(uint64_t from, uint64_t to, const cv::Vec2i &start, const cv::Vec2i &target, float length){
+    this->regions_.clear();
+    if( !this->engine_->changes(from, to, this->regions_) )
+        return true;
+    return crosses(this->regions_, start, target, length);
+    }
+
+
+/**
+ *  Computes the shortest path tree of a hub on the current map
+ *
+ *  Runs Dijkstra from the hub over the 8-connected grid with the costs
+ *  of the map. The move from every pixel to its parent in the tree is
+ *  run length encoded per row.
+ *
+ *  \param hub Tree whose pixel is set, the runs are replaced
+**/
+void PathCache::buildHub(Hub &hub){
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    const BitGrid &grid = data->grid;
+    const int cols = grid.cols();
+    const float diagonal = std::sqrt(2.0f);
+    SearchArena &arena = this->arena_;
+    arena.reset(grid.rows() * cols);
+    if( grid.isFree(hub.pixel[0], hub.pixel[1]) ){
+        int root = hub.pixel[1] * cols + hub.pixel[0];
+        arena.cell(root).g_value = 0.0;
+        arena.push(root, 0.0);
+        }
+    while( !arena.empty() ){
+        const int current = arena.pop();
+        const float g_value = arena.cell(current).g_value;
+        const cv::Vec2i current_vec(current % cols, current / cols);
+        for(int dir = 0; dir < 8 ;++dir){
+            cv::Vec2i next = current_vec + JumpTable::DIRECTIONS[dir];
+            if( !grid.isFree(next[0], next[1]) )
+                continue;
+            // Straight directions have even indices
+            float step = dir % 2 ? diagonal : 1.0f;
+            if( !data->costs.empty() )
+                step *= 0.5f * (data->costs.at<float>(current_vec[1], current_vec[0]) + data->costs.at<float>(next[1], next[0]));
+            float g_next = g_value + step;
+            int next_cell = next[1] * cols + next[0];
+            CellState &state = arena.cell(next_cell);
+            if(state.g_value <= g_next)
+                continue;
+            state.g_value = g_next;
+            state.parent = current;
+            if( arena.isOpen(next_cell) )
+                arena.update(next_cell, g_next);
+            else
+                arena.push(next_cell, g_next);
+            }
+        }
+
+    this->hub_bytes_ -= hub.runs.capacity() * sizeof(uint32_t) + hub.row_runs.capacity() * sizeof(size_t);
+    hub.runs.clear();
+    hub.row_runs.assign(1, 0);
+    for(int y = 0; y < grid.rows() ;++y){
+        for(int x = 0; x < cols ;++x){
+            int parent = arena.cell(y * cols + x).parent;
+            uint32_t move = NO_MOVE;
+            if(parent != -1)
+                move = JumpTable::direction( cv::Vec2i(parent % cols - x, parent / cols - y) );
+            if( x == 0 || (hub.runs.back() & 15) != move )
+                hub.runs.push_back(uint32_t(x) << 4 | move);
+            }
+        hub.row_runs.push_back( hub.runs.size() );
+        }
+    hub.runs.shrink_to_fit();
+    hub.size = cv::Size(cols, grid.rows());
+    hub.version = data->version;
+    hub.changed.clear();
+    this->hub_bytes_ += hub.runs.capacity() * sizeof(uint32_t) + hub.row_runs.capacity() * sizeof(size_t);
+    }
+
+
+/**
+ *  Checks if changed regions reach into the ellipse of a path
+ *
+ *  \param regions Changed regions, empty ones are ignored
+ *  \param start   First waypoint of the path
+ *  \param target  Last waypoint of the path
+ *  \param length  Costs of the path
+ *
+ *  \return        True if a region may block the path or open a shorter one
+**/
+bool PathCache::crosses(const std::vector<cv::Rect> &regions, const cv::Vec2i &start, const cv::Vec2i &target, float length){
+    for(size_t i = 0; i < regions.size() ;++i){
+        const cv::Rect &region = regions[i];
+        if(region.area() == 0)
+            continue;
+        // Tolerance for the rounding of the costs
+        if(rectDistance(start, region) + rectDistance(target, region) <= length + 1e-3f)
+            return true;
+        }
+    return false;
+    }
+
+
+/**
+ *  Drops all cached paths, the trees of the hubs are kept
+**/
+void PathCache::clear(){
+    this->entries_.clear();
+    this->index_.clear();
+    this->bytes_ = 0;
+    }
+
+
+/**
+ *  Generates a path from the cache or with a search
+ *
+ *  Paths to and from hubs are read from their trees. Other paths are
+ *  looked up in the least recently used list, a miss runs findPath and
+ *  stores the path. Paths touched by map changes are computed again.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *  \param path   Is cleared and receives the waypoints from start to target
+ *
+ *  \return       True if a path was found
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+bool PathCache::findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path){
+    path.clear();
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    checkOnMap(data->grid, start, "Start");
+    checkOnMap(data->grid, target, "Target");
+    // Searches may leave an occupied start, trees only hold free pixels
+    if( data->grid.isFree(start[0], start[1]) && data->grid.isFree(target[0], target[1]) ){
+        std::map<uint64_t, Hub>::iterator hub = this->hubs_.find( key(target) );
+        if( hub != this->hubs_.end() ){
+            ++this->hits_;
+            return this->hubPath(hub->second, start, path);
+            }
+        hub = this->hubs_.find( key(start) );
+        if( hub != this->hubs_.end() ){
+            ++this->hits_;
+            bool found = this->hubPath(hub->second, target, path);
+            std::reverse(path.begin(), path.end());
+            return found;
+            }
+        }
+
+    std::map<Key, EntryList::iterator>::iterator cached = this->index_.find( Key(key(start), key(target)) );
+    if( cached != this->index_.end() ){
+        Entry &entry = *cached->second;
+        if( entry.version == data->version || !this->affected(entry.version, data->version, start, target, entry.length) ){
+            entry.version = data->version;
+            this->entries_.splice(this->entries_.begin(), this->entries_, cached->second);
+            path = entry.path;
+            ++this->hits_;
+            return true;
+            }
+        this->bytes_ -= entryBytes(entry);
+        this->entries_.erase(cached->second);
+        this->index_.erase(cached);
+        }
+    ++this->misses_;
+    if( !this->searcher_.findPath(start, target, path) )
+        return false;
+    this->store(start, target, path, *this->searcher_.data_);
+    return true;
+    }
+
+
+/**
+ *  Reads the path from a pixel to a hub from its tree
+ *
+ *  The tree is computed again if the map changed within the ellipse of
+ *  the path or if the pixel could not reach the hub before a change.
+ *
+ *  \param hub  Tree of the hub
+ *  \param from Free pixel on the current map
+ *  \param path Receives the waypoints from from to the hub, empty if there is no path
+ *
+ *  \return     True if a path was found
+**/
+bool PathCache::hubPath(Hub &hub, const cv::Vec2i &from, std::vector<cv::Vec2i> &path){
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    if( hub.size != cv::Size(data->grid.cols(), data->grid.rows()) )
+        this->buildHub(hub);
+    // New changes are collected once, so the tree outlives the change history of the engine
+    if(hub.version != data->version){
+        this->regions_.clear();
+        if(   !this->engine_->changes(hub.version, data->version, this->regions_)
+           || HUB_CHANGES < hub.changed.size() + this->regions_.size() ){
+            this->buildHub(hub);
+            return walk(hub, from, path);
+            }
+        for(size_t i = 0; i < this->regions_.size() ;++i)
+            if(0 < this->regions_[i].area())
+                hub.changed.push_back(this->regions_[i]);
+        hub.version = data->version;
+        }
+    bool found = walk(hub, from, path);
+    if( !hub.changed.empty() && (!found || crosses(hub.changed, from, hub.pixel, pathCosts(*data, path))) ){
+        this->buildHub(hub);
+        found = walk(hub, from, path);
+        }
+    return found;
+    }
+
+
+/**
+ *  Looks up the move of a pixel toward the hub
+ *
+ *  \param hub Tree of the hub
+ *  \param x   Column of the pixel, must be on the map of the tree
+ *  \param y   Row of the pixel, must be on the map of the tree
+ *
+ *  \return    Index in JumpTable::DIRECTIONS, NO_MOVE for the hub and unreachable pixels
+**/
+int PathCache::move(const Hub &hub, int x, int y){
+    std::vector<uint32_t>::const_iterator begin = hub.runs.begin() + hub.row_runs[y];
+    std::vector<uint32_t>::const_iterator end = hub.runs.begin() + hub.row_runs[y + 1];
+    // Last run starting at or before x
+    return *(std::upper_bound(begin, end, uint32_t(x) << 4 | 15) - 1) & 15;
+    }
+
+
+/**
+ *  Constructor
+ *
+ *  \param engine    Engine whose map is searched, must outlive the cache
+ *  \param max_bytes Memory limit of the cached paths, the trees of the hubs come on top
+**/
+PathCache::PathCache(const JPSAStar &engine, size_t max_bytes)
+    : engine_(&engine), searcher_(engine), max_bytes_(max_bytes), bytes_(0), hub_bytes_(0), hits_(0), misses_(0){
+    }
+
+
+/**
+ *  Adds a path to the front of the least recently used list
+ *
+ *  The least recently used paths are dropped until the cache fits into
+ *  its memory limit.
+ *
+ *  \param start   Start of the query
+ *  \param target  Target of the query
+ *  \param path    Waypoints from start to target
+ *  \param data    Snapshot the path was found on
+**/
+void PathCache::store(const cv::Vec2i &start, const cv::Vec2i &target, const std::vector<cv::Vec2i> &path, const MapData &data){
+    Entry entry;
+    entry.start = start;
+    entry.target = target;
+    entry.path = path;
+    entry.length = pathCosts(data, path);
+    entry.version = data.version;
+    if(this->max_bytes_ < entryBytes(entry))
+        return;
+    this->bytes_ += entryBytes(entry);
+    this->entries_.push_front(entry);
+    this->index_[Key(key(start), key(target))] = this->entries_.begin();
+    while(this->max_bytes_ < this->bytes_){
+        const Entry &last = this->entries_.back();
+        this->bytes_ -= entryBytes(last);
+        this->index_.erase( Key(key(last.start), key(last.target)) );
+        this->entries_.pop_back();
+        }
+    }
+
+
+/**
+ *  Follows the moves of a tree from a pixel to its hub
+ *
+ *  \param hub  Tree of the hub
+ *  \param from Pixel on the map of the tree
+ *  \param path Receives the pixels where the move changes, from from to the hub
+ *
+ *  \return     True if from reaches the hub
+**/
+bool PathCache::walk(const Hub &hub, const cv::Vec2i &from, std::vector<cv::Vec2i> &path){
+    path.assign(1, from);
+    cv::Vec2i current = from;
+    int last = NO_MOVE;
+    while(current != hub.pixel){
+        int dir = move(hub, current[0], current[1]);
+        if(dir == int(NO_MOVE)){
+            path.clear();
+            return false;
+            }
+        if(dir != last && last != int(NO_MOVE))
+            path.push_back(current);
+        last = dir;
+        current += JumpTable::DIRECTIONS[dir];
+        }
+    if(path.back() != current)
+        path.push_back(current);
+    return true;
+    }
+
+
+/**
+ *  Generates the paths of a batch of queries
+ *
+ *  All queries of the batch use the map snapshot which is current when
+ *  the batch starts. Queries with start or target outside of the map get
+ *  an empty path.
+ *
+ *  \param queries Start and target of each query
+ *  \param count   Number of queries
+ *  \param batch   Receives the paths in the order of the queries
+**/
+void QueryPool::findPaths(const PathQuery *queries, size_t count, PathBatch &batch){
+    this->data_ = this->engine_->snapshot();
+    this->queries_ = queries;
+    // Group queries sharing a start, equal queries end up next to each other
+    this->order_.resize(count);
+    for(size_t i = 0; i < count ;++i)
+        this->order_[i] = i;
+    std::sort(this->order_.begin(), this->order_.end(), [queries](size_t a, size_t b){
+        const PathQuery &qa = queries[a];
+        const PathQuery &qb = queries[b];
+        if(qa.start[1] != qb.start[1]) return qa.start[1] < qb.start[1];
+        if(qa.start[0] != qb.start[0]) return qa.start[0] < qb.start[0];
+        if(qa.target[1] != qb.target[1]) return qa.target[1] < qb.target[1];
+        return qa.target[0] < qb.target[0]; });
+    this->groups_.clear();
+    for(size_t i = 0; i < count ;++i){
+        if(i == 0 || queries[this->order_[i]].start != queries[this->order_[i - 1]].start)
+            this->groups_.push_back(i);
+        }
+    this->groups_.push_back(count);
+    this->results_.resize(count);
+
+    // Split groups evenly, stealing balances the rest
+    const size_t groups = this->groups_.size() - 1;
+    const size_t workers = this->workers_.size();
+    for(size_t w = 0; w < workers ;++w){
+        Worker &worker = *this->workers_[w];
+        worker.waypoints.clear();
+        worker.searcher.data_ = this->data_;
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.begin = groups * w / workers;
+        worker.end = groups * (w + 1) / workers;
+        }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->busy_ = this->threads_.size();
+        ++this->generation_;
+    }
+    this->start_.notify_all();
+    this->work(0);
+    {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        this->done_.wait(lock, [this](){ return this->busy_ == 0; });
+    }
+
+    // Gather the paths of all workers in query order
+    batch.offsets.resize(count + 1);
+    batch.offsets[0] = 0;
+    for(size_t i = 0; i < count ;++i)
+        batch.offsets[i + 1] = batch.offsets[i] + this->results_[i].size;
+    batch.waypoints.resize(batch.offsets[count]);
+    for(size_t i = 0; i < count ;++i){
+        const Result &result = this->results_[i];
+        const cv::Vec2i *source = this->workers_[result.worker]->waypoints.data() + result.begin;
+        std::copy(source, source + result.size, batch.waypoints.begin() + batch.offsets[i]);
+        }
+    // Snapshots of past batches would keep map updates from reusing them
+    for(size_t w = 0; w < workers ;++w)
+        this->workers_[w]->searcher.data_.reset();
+    this->data_.reset();
+    }
+
+
+/**
+ *  Generates the paths of a batch of queries
+ *
+ *  \param queries Start and target of each query
+ *  \param batch   Receives the paths in the order of the queries
+**/
+void QueryPool::findPaths(const std::vector<PathQuery> &queries, PathBatch &batch){
+    this->findPaths(queries.data(), queries.size(), batch);
+    }
+
+
+/**
+ *  Takes the next group of a worker, steals groups if the worker has none left
+ *
+ *  \param worker Index of the worker
+ *  \param group  Receives the index of the group
+ *
+ *  \return       False if no groups are left
+**/
+bool QueryPool::nextGroup(unsigned worker, size_t &group){
+    Worker &own = *this->workers_[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(own.begin < own.end){
+            group = own.begin++;
+            return true;
+            }
+    }
+    for(size_t i = 1; i < this->workers_.size() ;++i){
+        Worker &victim = *this->workers_[(worker + i) % this->workers_.size()];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(victim.end <= victim.begin)
+                continue;
+            // Take the upper half, the victim continues with the lower one
+            end = victim.end;
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        group = begin;
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+        }
+    return false;
+    }
+
+
+/**
+ *  Constructor
+ *
+ *  \param engine  Engine whose map is searched, must outlive the pool
+ *  \param threads Number of workers including the calling thread, 0 uses one per hardware thread
+**/
+QueryPool::QueryPool(const JPSAStar &engine, unsigned threads)
+    : engine_(&engine), generation_(0), busy_(0), stop_(false), queries_(NULL){
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned w = 0; w < threads ;++w)
+        this->workers_.push_back( std::unique_ptr<Worker>(new Worker(engine)) );
+    for(unsigned w = 1; w < threads ;++w)
+        this->threads_.push_back( std::thread(&QueryPool::run, this, w) );
+    }
+
+
+/**
+ *  Destructor, stops all threads
+**/
+QueryPool::~QueryPool(){
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stop_ = true;
+    }
+    this->start_.notify_all();
+    for(size_t i = 0; i < this->threads_.size() ;++i)
+        this->threads_[i].join();
+    }
+
+
+/**
+ *  Thread main loop, works on every batch until the pool is destroyed
+ *
+ *  \param worker Index of the worker run by the thread
+**/
+void QueryPool::run(unsigned worker){
+    unsigned generation = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->start_.wait(lock, [this, generation](){ return this->stop_ || this->generation_ != generation; });
+            if(this->stop_)
+                return;
+            generation = this->generation_;
+        }
+        this->work(worker);
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if(--this->busy_ == 0)
+            this->done_.notify_one();
+        }
+    }
+
+
+/**
+ *  Answers all queries of a group with a single search
+ *
+ *  \param worker Index of the worker
+ *  \param group  Index of the group
+**/
+void QueryPool::solveGroup(unsigned worker, size_t group){
+    Worker &state = *this->workers_[worker];
+    Searcher &searcher = state.searcher;
+    const BitGrid &grid = this->data_->grid;
+    const size_t first = this->groups_[group];
+    const size_t last = this->groups_[group + 1];
+    const cv::Vec2i &start = this->queries_[this->order_[first]].start;
+    state.targets.clear();
+    if( grid.isInside(start[0], start[1]) ){
+        for(size_t i = first; i < last ;++i){
+            const cv::Vec2i &target = this->queries_[this->order_[i]].target;
+            if( grid.isInside(target[0], target[1]) && reachable(*this->data_, start, target) )
+                state.targets.push_back(target);
+            }
+        }
+    searcher.targets_.assign(state.targets.data(), state.targets.size());
+    if( !state.targets.empty() )
+        searcher.expand(start, 0);
+
+    for(size_t i = first; i < last ;++i){
+        const cv::Vec2i &target = this->queries_[this->order_[i]].target;
+        Result &result = this->results_[this->order_[i]];
+        // Repeated queries share the path
+        if(i != first && target == this->queries_[this->order_[i - 1]].target){
+            result = this->results_[this->order_[i - 1]];
+            continue;
+            }
+        result.worker = worker;
+        result.begin = state.waypoints.size();
+        result.size = 0;
+        if( !searcher.reached(target) )
+            continue;
+        searcher.buildPath(target[1] * grid.cols() + target[0], state.waypoints);
+        result.size = state.waypoints.size() - result.begin;
+        }
+    }
+
+
+/**
+ *  Answers groups until no group is left
+ *
+ *  \param worker Index of the worker
+**/
+void QueryPool::work(unsigned worker){
+    size_t group;
+    while(this->nextGroup(worker, group))
+        this->solveGroup(worker, group);
+    }
+
+
+/**
+ *  Generates the waypoints from start to target by following the parent links
+ *
+ *  As in the paths of Searcher, only pixels where the direction changes
+ *  are waypoints. Start and target are included.
+ *
+ *  \param path Receives the waypoints
+ *
+ *  \return     False if the parent links don't lead to the target
+**/
+bool Replanner::buildPath(std::vector<cv::Vec2i> &path) const{
+    const int cols = this->data_->grid.cols();
+    const int target = this->target_[1] * cols + this->target_[0];
+    int current = this->start_[1] * cols + this->start_[0];
+    cv::Vec2i direction(0, 0);
+    path.push_back(this->start_);
+    // Links of a finished search can't form a cycle, the limit guards against rounding errors
+    for(size_t steps = 0; current != target ;++steps){
+        int next = this->cells_[current].parent;
+        if(next == -1 || this->cells_.size() <= steps)
+            return false;
+        cv::Vec2i step(next % cols - current % cols, next / cols - current / cols);
+        if(step != direction && current != path.front()[1] * cols + path.front()[0])
+            path.push_back( cv::Vec2i(current % cols, current / cols) );
+        direction = step;
+        current = next;
+        }
+    if(current != path.front()[1] * cols + path.front()[0])
+        path.push_back(this->target_);
+    return true;
+    }
+
+
+/**
+ *  Expands cells until the costs of the start are consistent (ComputeShortestPath of D* Lite)
+ *
+ *  Moves into occupied pixels cost infinity, the start itself may be
+ *  occupied. Diagonal moves may cut corners like in the jump point search.
+**/
+void Replanner::computePath(){
+    const BitGrid &grid = this->data_->grid;
+    const int cols = grid.cols();
+    const int start = this->start_[1] * cols + this->start_[0];
+    while(!this->heap_.empty()){
+        const ReplanState &start_state = this->cell(start);
+        if( !(this->heap_.front() < this->key(start)) && start_state.rhs <= start_state.g_value )
+            break;
+        const int current = this->heap_.front().cell;
+        Entry new_key = this->key(current);
+        // The start moved since the cell was queued
+        if(this->heap_.front() < new_key){
+            this->heap_.front() = new_key;
+            this->siftDown(0);
+            JPSASTAR_STAT( ++this->stats_.updated; )
+            continue;
+            }
+        this->remove(0);
+        JPSASTAR_STAT( ++this->stats_.popped; )
+        ReplanState &state = this->cell(current);
+        const int x = current % cols;
+        const int y = current / cols;
+        const bool free = grid.isFree(x, y);
+        if(state.rhs < state.g_value){
+            state.g_value = state.rhs;
+            if(!free)
+                continue;
+            for(int ny = y - 1; ny <= y + 1 ;++ny){
+                for(int nx = x - 1; nx <= x + 1 ;++nx){
+                    if( (nx == x && ny == y) || !grid.isInside(nx, ny) )
+                        continue;
+                    const int neighbor = ny * cols + nx;
+                    ReplanState &neighbor_state = this->cell(neighbor);
+                    uint32_t rhs = state.g_value + this->stepCosts(current, neighbor);
+                    if(rhs < neighbor_state.rhs){
+                        neighbor_state.rhs = rhs;
+                        neighbor_state.parent = current;
+                        this->updateVertex(neighbor);
+                        }
+                    }
+                }
+            }
+        else{
+            state.g_value = COST_INFINITE;
+            this->updateVertex(current);
+            for(int ny = y - 1; ny <= y + 1 ;++ny){
+                for(int nx = x - 1; nx <= x + 1 ;++nx){
+                    if( (nx != x || ny != y) && grid.isInside(nx, ny) && this->cell(ny * cols + nx).parent == current )
+                        this->updateRhs(ny * cols + nx);
+                    }
+                }
+            }
+        }
+    }
+
+
+/**
+ *  Generates a path and repairs the search of the previous call if possible
+ *
+ *  The costs of the previous search are kept if the target is the same
+ *  and the map changes since the previous call are known by the engine.
+ *  Moving the start along the path and changing a few pixels is then
+ *  much cheaper than a new search.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *  \param path   Is cleared and receives the waypoints from start to target
+ *
+ *  \return       True if a path was found
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+bool Replanner::findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path){
+    JPSASTAR_STAT( this->stats_ = SearchStats();
+                   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    path.clear();
+    std::shared_ptr<const MapData> data = this->engine_->snapshot();
+    checkOnMap(data->grid, start, "Start");
+    checkOnMap(data->grid, target, "Target");
+    // The repaired search would still explore the whole component of the target
+    if( !reachable(*data, start, target) )
+        return false;
+    std::vector<cv::Rect> regions;
+    if(   !this->data_ || target != this->target_
+       || data->grid.cols() != this->data_->grid.cols() || data->grid.rows() != this->data_->grid.rows()
+       || !this->engine_->changes(this->data_->version, data->version, regions) ){
+        this->data_ = data;
+        this->reset(start, target);
+        }
+    else{
+        std::shared_ptr<const MapData> previous = this->data_;
+        this->data_ = data;
+        // Queued keys stay lower bounds if they are raised by the estimate between both starts
+        this->key_offset_ += octile(this->start_, start);
+        this->start_ = start;
+        const int cols = data->grid.cols();
+        // Snapshots share their costs unless setCosts replaced them
+        const bool same_costs = previous->costs.data == data->costs.data;
+        auto pixelCosts = [](const MapData &snapshot, int x, int y){
+            return snapshot.costs.empty() ? 1.0f : snapshot.costs.at<float>(y, x); };
+        for(size_t i = 0; i < regions.size() ;++i){
+            const cv::Rect &region = regions[i];
+            for(int y = region.y; y < region.y + region.height ;++y){
+                for(int x = region.x; x < region.x + region.width ;++x){
+                    const bool costs_changed = !same_costs && pixelCosts(*previous, x, y) != pixelCosts(*data, x, y);
+                    if( previous->grid.isFree(x, y) == data->grid.isFree(x, y) && !costs_changed )
+                        continue;
+                    // Moves out of the pixel change with its costs
+                    if( costs_changed && data->grid.isFree(x, y) )
+                        this->updateRhs(y * cols + x);
+                    // Moves into the pixel changed
+                    for(int ny = y - 1; ny <= y + 1 ;++ny){
+                        for(int nx = x - 1; nx <= x + 1 ;++nx){
+                            if( (nx != x || ny != y) && data->grid.isInside(nx, ny) )
+                                this->updateRhs(ny * cols + nx);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    JPSASTAR_STAT( this->stats_.setup_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+    this->computePath();
+    JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+    const int start_cell = start[1] * data->grid.cols() + start[0];
+    bool found = this->cell(start_cell).rhs != COST_INFINITE && this->buildPath(path);
+    if(!found)
+        path.clear();
+    JPSASTAR_STAT( this->stats_.path_ns = elapsedNs(begin); )
+    return found;
+    }
+
+
+/**
+ *  Computes the open list key of a cell
+ *
+ *  \param cell Map cell index
+ *
+ *  \return     Key of the cell for the current start
+**/
+Replanner::Entry Replanner::key(int cell){
+    const ReplanState &state = this->cell(cell);
+    const int cols = this->data_->grid.cols();
+    uint32_t costs = std::min(state.g_value, state.rhs);
+    Entry entry = { uint64_t(costs) + octile( this->start_, cv::Vec2i(cell % cols, cell / cols) ) + this->key_offset_,
+                    costs, cell };
+    return entry;
+    }
+
+
+/**
+ *  Estimates the costs between two pixels on the 8-connected grid
+ *
+ *  \param a First pixel
+ *  \param b Second pixel
+ *
+ *  \return  Costs of the shortest path without obstacles
+**/
+uint32_t Replanner::octile(const cv::Vec2i &a, const cv::Vec2i &b){
+    uint32_t dx = std::abs(a[0] - b[0]);
+    uint32_t dy = std::abs(a[1] - b[1]);
+    return COST_STRAIGHT * std::max(dx, dy) + (COST_DIAGONAL - COST_STRAIGHT) * std::min(dx, dy);
+    }
+
+
+/**
+ *  Removes an entry from the open list
+ *
+ *  \param pos Heap position of the entry
+**/
+void Replanner::remove(size_t pos){
+    this->cells_[this->heap_[pos].cell].heap_index = CellState::OPEN_NONE;
+    Entry last = this->heap_.back();
+    this->heap_.pop_back();
+    if(pos == this->heap_.size())
+        return;
+    this->heap_[pos] = last;
+    this->cells_[last.cell].heap_index = pos;
+    this->siftUp(pos);
+    this->siftDown(this->cells_[last.cell].heap_index);
+    }
+
+
+/**
+ *  Constructor
+ *
+ *  \param engine Engine whose map is searched, must outlive the planner
+**/
+Replanner::Replanner(const JPSAStar &engine) : engine_(&engine), generation_(0), key_offset_(0){
+    }
+
+
+/**
+ *  Starts a new search towards a target
+ *
+ *  Memory is only allocated if the number of cells changes, otherwise
+ *  old states are invalidated by a generation counter.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+**/
+void Replanner::reset(const cv::Vec2i &start, const cv::Vec2i &target){
+    const size_t cells = size_t(this->data_->grid.cols()) * this->data_->grid.rows();
+    if(this->cells_.size() != cells){
+        ReplanState invalid = { 0, 0, -1, CellState::OPEN_NONE, 0 };
+        this->cells_.assign(cells, invalid);
+        this->generation_ = 0;
+        }
+    ++this->generation_;
+    // Generation counter overflowed, states of generation 0 would be valid again
+    if(this->generation_ == 0){
+        for(size_t i = 0; i < this->cells_.size() ;++i)
+            this->cells_[i].generation = 0;
+        this->generation_ = 1;
+        }
+    this->heap_.clear();
+    this->start_ = start;
+    this->target_ = target;
+    this->key_offset_ = 0;
+    const int target_cell = target[1] * this->data_->grid.cols() + target[0];
+    this->cell(target_cell).rhs = 0;
+    this->updateVertex(target_cell);
+    }
+
+
+/**
+ *  Moves an entry towards the leaves until the heap property is restored
+ *
+ *  \param pos Heap position of the entry
+**/
+void Replanner::siftDown(size_t pos){
+    Entry entry = this->heap_[pos];
+    size_t size = this->heap_.size();
+    size_t child = 2 * pos + 1;
+    while(child < size){
+        if(child + 1 < size && this->heap_[child + 1] < this->heap_[child])
+            ++child;
+        if( !(this->heap_[child] < entry) )
+            break;
+        this->heap_[pos] = this->heap_[child];
+        this->cells_[this->heap_[pos].cell].heap_index = pos;
+        pos = child;
+        child = 2 * pos + 1;
+        }
+    this->heap_[pos] = entry;
+    this->cells_[entry.cell].heap_index = pos;
+    }
+
+
+/**
+ *  Moves an entry towards the root until the heap property is restored
+ *
+ *  \param pos Heap position of the entry
+**/
+void Replanner::siftUp(size_t pos){
+    Entry entry = this->heap_[pos];
+    while(pos > 0){
+        size_t parent = (pos - 1) / 2;
+        if( !(entry < this->heap_[parent]) )
+            break;
+        this->heap_[pos] = this->heap_[parent];
+        this->cells_[this->heap_[pos].cell].heap_index = pos;
+        pos = parent;
+        }
+    this->heap_[pos] = entry;
+    this->cells_[entry.cell].heap_index = pos;
+    }
+
+
+/**
+ *  Computes the costs of a step between two neighbors
+ *
+ *  \param from Map cell index
+ *  \param to   Map cell index of an 8-neighbor of from
+ *
+ *  \return     COST_STRAIGHT or COST_DIAGONAL times the mean costs of both pixels, rounded
+**/
+uint32_t Replanner::stepCosts(int from, int to) const{
+    const int cols = this->data_->grid.cols();
+    const uint32_t step = from % cols != to % cols && from / cols != to / cols ? COST_DIAGONAL : COST_STRAIGHT;
+    const cv::Mat &costs = this->data_->costs;
+    if( costs.empty() )
+        return step;
+    return uint32_t( step * 0.5f * (costs.at<float>(from / cols, from % cols) + costs.at<float>(to / cols, to % cols)) + 0.5f );
+    }
+
+
+/**
+ *  Recomputes the lookahead costs of a cell from all its neighbors
+ *
+ *  \param cell Map cell index, the target keeps its costs of 0
+**/
+void Replanner::updateRhs(int cell){
+    const BitGrid &grid = this->data_->grid;
+    const int cols = grid.cols();
+    const int x = cell % cols;
+    const int y = cell / cols;
+    ReplanState &state = this->cell(cell);
+    if(x == this->target_[0] && y == this->target_[1])
+        return;
+    state.rhs = COST_INFINITE;
+    state.parent = -1;
+    for(int ny = y - 1; ny <= y + 1 ;++ny){
+        for(int nx = x - 1; nx <= x + 1 ;++nx){
+            if( (nx == x && ny == y) || !grid.isFree(nx, ny) )
+                continue;
+            const uint32_t g_value = this->cell(ny * cols + nx).g_value;
+            if(g_value == COST_INFINITE)
+                continue;
+            uint32_t rhs = g_value + this->stepCosts(cell, ny * cols + nx);
+            if(rhs < state.rhs){
+                state.rhs = rhs;
+                state.parent = ny * cols + nx;
+                }
+            }
+        }
+    this->updateVertex(cell);
+    }
+
+
+/**
+ *  Queues a cell if its costs are inconsistent, removes it otherwise
+ *
+ *  \param cell Map cell index
+**/
+void Replanner::updateVertex(int cell){
+    const ReplanState &state = this->cell(cell);
+    const bool open = 0 <= state.heap_index;
+    if(state.g_value != state.rhs){
+        Entry entry = this->key(cell);
+        if(open){
+            size_t pos = state.heap_index;
+            this->heap_[pos] = entry;
+            this->siftUp(pos);
+            this->siftDown(this->cells_[cell].heap_index);
+            JPSASTAR_STAT( ++this->stats_.updated; )
+            }
+        else{
+            this->cells_[cell].heap_index = this->heap_.size();
+            this->heap_.push_back(entry);
+            this->siftUp(this->heap_.size() - 1);
+            JPSASTAR_STAT( ++this->stats_.pushed;
+                           this->stats_.open_peak = std::max(this->stats_.open_peak, this->heap_.size()); )
+            }
+        }
+    else if(open)
+        this->remove(state.heap_index);
+    }
+
+
+/**
+ *  Removes the cell with the smallest f value from the open list and closes it
+ *
+ *  \return Cell index with the smallest f value, the open list must not be empty
+**/
+int SearchArena::pop(){
+    int top = this->heap_.front().cell;
+    this->cells_[top].heap_index = CellState::OPEN_CLOSED;
+    if(this->heap_.size() > 1){
+        this->heap_.front() = this->heap_.back();
+        this->heap_.pop_back();
+        this->siftDown(0);
+        }
+    else
+        this->heap_.pop_back();
+    return top;
+    }
+
+
+/**
+ *  Inserts a cell into the open list
+ *
+ *  \param cell    Map cell index (y * cols + x), must not be open yet
+ *  \param f_value Key of the cell in the open list
+**/
+void SearchArena::push(int cell, float f_value){
+    Entry entry = { f_value, cell };
+    this->cell(cell).heap_index = this->heap_.size();
+    this->heap_.push_back(entry);
+    this->siftUp(this->heap_.size() - 1);
+    }
+
+
+/**
+ *  Starts a new query by invalidating all cell states
+ *
+ *  Memory is only allocated if the number of cells changes, otherwise
+ *  this is O(1) apart from a full reset every 2^32 queries.
+ *
+ *  \param cells Number of cells of the searched map
+**/
+void SearchArena::reset(int cells){
+    this->heap_.clear();
+    if(this->cells_.size() != static_cast<size_t>(cells)){
+        CellState invalid = { 0.0, -1, CellState::OPEN_NONE, 0 };
+        this->cells_.assign(cells, invalid);
+        this->generation_ = 0;
+        }
+    ++this->generation_;
+    // Generation counter overflowed, states of generation 0 would be valid again
+    if(this->generation_ == 0){
+        std::vector<CellState>::iterator it = this->cells_.begin(), end = this->cells_.end();
+        for(; it != end ;++it){
+            it->generation = 0;
+            }
+        this->generation_ = 1;
+        }
+    }
+
+
+/**
+ *  Moves an entry towards the leaves until the heap property is restored
+ *
+ *  \param pos Heap position of the entry
+**/
+void SearchArena::siftDown(size_t pos){
+    Entry entry = this->heap_[pos];
+    size_t size = this->heap_.size();
+    size_t child = 2 * pos + 1;
+    while(child < size){
+        if(child + 1 < size && this->heap_[child + 1].f_value < this->heap_[child].f_value)
+            ++child;
+        if(entry.f_value <= this->heap_[child].f_value)
+            break;
+        this->heap_[pos] = this->heap_[child];
+        this->cells_[this->heap_[pos].cell].heap_index = pos;
+        pos = child;
+        child = 2 * pos + 1;
+        }
+    this->heap_[pos] = entry;
+    this->cells_[entry.cell].heap_index = pos;
+    }
+
+
+/**
+ *  Moves an entry towards the root until the heap property is restored
+ *
+ *  \param pos Heap position of the entry
+**/
+void SearchArena::siftUp(size_t pos){
+    Entry entry = this->heap_[pos];
+    while(pos > 0){
+        size_t parent = (pos - 1) / 2;
+        if(this->heap_[parent].f_value <= entry.f_value)
+            break;
+        this->heap_[pos] = this->heap_[parent];
+        this->cells_[this->heap_[pos].cell].heap_index = pos;
+        pos = parent;
+        }
+    this->heap_[pos] = entry;
+    this->cells_[entry.cell].heap_index = pos;
+    }
+
+
+/**
+ *  Decreases the key of an open cell
+ *
+ *  \param cell    Map cell index of the open cell
+ *  \param f_value New key of the cell, must not be greater than the old one
+**/
+void SearchArena::update(int cell, float f_value){
+    int pos = this->cells_[cell].heap_index;
+    this->heap_[pos].f_value = f_value;
+    this->siftUp(pos);
+    }
+
+
+// Definitions of the status constants, which are bound to references by comparisons
+const int SearchLimits::NONE;
+const int SearchLimits::DEADLINE;
+const int SearchLimits::POPPED;
+const int SearchLimits::SCANNED;
+const int SearchLimits::CANCELLED;
+const size_t SearchLimits::CHECK_INTERVAL;
+
+
+/**
+ *  Computes the jump point of a jump which branches into straight jumps
+ *
+ *  These are diagonal jumps and horizontal jumps of FourConnected. The
+ *  jump stops where one of its branches finds a jump point.
+ *
+ *  \param current   Origin of computed jump point
+ *  \param targets   Target coordinates, because targets are special jump points
+ *  \param direction Unit vector of the jump direction
+ *
+ *  \return          Jump point of current, NO_JUMP_POINT if there is none
+**/
+template<class Movement>
+cv::Vec2i BasicSearcher<Movement>::branchingJPS(cv::Vec2i current, const TargetSet &targets, const cv::Vec2i &direction) const{
+    const BitGrid &grid = this->data_->grid;
+    cv::Vec2i first, second;
+    Movement::branches(direction, first, second);
+    // While in range and not occupied
+    while( grid.isFree(current[0], current[1]) ){
+        JPSASTAR_STAT( ++this->stats_.scanned; )
+        // Long jumps must not delay a stopped query
+        if( this->next_check_ <= ++this->scanned_ && this->limitReached() )
+            return NO_JUMP_POINT;
+        // Check if target reached
+        if( targets.contains(current[0], current[1]) )
+            return current;
+        // Pixels next to a change of the costs are expanded without pruning
+        if( !this->isUniform(current) )
+            return current;
+        // Check for forced neighbors
+        if( Movement::hasForced(grid, current, direction) ){
+            JPSASTAR_STAT( ++this->stats_.forced; )
+            return current;
+            }
+        // Check for jump points of the branches
+        if( this->straightJPS(current, targets, first) != NO_JUMP_POINT )
+            return current;
+        if( this->straightJPS(current, targets, second) != NO_JUMP_POINT )
+            return current;
+        if( !Movement::canStep(grid, current, direction) )
+            break;
+        current += direction;
+        }
+    return NO_JUMP_POINT;
+    }
+
+
+/**
+ *  Computes jump distances of all pixels of the searched map (JPS+)
+ *
+ *  Uses the same forced neighbor rules as the online search. Takes
+ *  O(rows * cols) time and 16 byte per pixel.
+ *
+ *  \param jumps Receives the jump distances
+**/
+template<class Movement>
+void BasicSearcher<Movement>::buildJumpTable(JumpTable &jumps) const{
+    const int cols = this->data_->grid.cols();
+    const int rows = this->data_->grid.rows();
+    jumps.assign(cols, rows);
+    // Bit i is set if a straight jump point follows in direction i
+    std::vector<uchar> straight_jp(size_t(cols) * rows, 0);
+    // Distances of the previous and current row, the distance of a pixel depends on the next pixel in direction
+    std::vector<int> previous(cols), current(cols);
+    // Straight directions first, diagonal jump points depend on them
+    static const int order[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    for(int i = 0; i < 8 ;++i){
+        const int dir = order[i];
+        const cv::Vec2i &direction = JumpTable::DIRECTIONS[dir];
+        for(int row = 0; row < rows ;++row){
+            int y = direction[1] > 0 ? rows - 1 - row : row;
+            std::swap(previous, current);
+            for(int col = 0; col < cols ;++col){
+                int x = direction[0] > 0 ? cols - 1 - col : col;
+                cv::Vec2i next(x + direction[0], y + direction[1]);
+                int distance;
+                if( !this->data_->grid.isFree(next[0], next[1]) )
+                    distance = 0;
+                else if( this->isJumpPoint(next, dir, straight_jp[next[1] * cols + next[0]]) )
+                    distance = 1;
+                else{
+                    int next_distance = direction[1] == 0 ? current[next[0]] : previous[next[0]];
+                    distance = 0 < next_distance ? next_distance + 1 : next_distance - 1;
+                    }
+                current[x] = distance;
+                jumps.setDistance(y * cols + x, dir, distance);
+                if(0 < distance && dir % 2 == 0)
+                    straight_jp[y * cols + x] |= 1 << dir;
+                }
+            }
+        }
+    }
+
+
+/**
+ *  Generates list of waypoints using the parent indices of the search arena
+ *
+ *  Target cell is included in the resulting list.
+ *
+ *  \param target Cell index of the last waypoint
+ *
+ *  \return       List of waypoints from start cell to target cell
+**/
+template<class Movement>
+std::list<cv::Vec2i> BasicSearcher<Movement>::buildPath(int target){
+    JPSASTAR_STAT( std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    std::list<cv::Vec2i> path;
+    for(int cell = target; cell != -1; cell = this->arena_.cell(cell).parent){
+        path.push_front( cv::Vec2i(cell % this->data_->grid.cols(), cell / this->data_->grid.cols()) );
+        }
+    // The backward search continues the path from the meeting cell to the target
+    if(target == this->meeting_){
+        for(int cell = this->reverse_arena_.cell(target).parent; cell != -1; cell = this->reverse_arena_.cell(cell).parent)
+            path.push_back( cv::Vec2i(cell % this->data_->grid.cols(), cell / this->data_->grid.cols()) );
+        }
+    JPSASTAR_STAT( this->stats_.path_ns += elapsedNs(begin); )
+    return path;
+    }
+
+
+/**
+ *  Writes waypoints to a vector using the parent indices of the search arena
+ *
+ *  \param target Cell index of the last waypoint
+ *  \param path   Receives the waypoints from start cell to target cell
+**/
+template<class Movement>
+void BasicSearcher<Movement>::buildPath(int target, std::vector<cv::Vec2i> &path){
+    JPSASTAR_STAT( std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    size_t first = path.size();
+    for(int cell = target; cell != -1; cell = this->arena_.cell(cell).parent){
+        path.push_back( cv::Vec2i(cell % this->data_->grid.cols(), cell / this->data_->grid.cols()) );
+        }
+    std::reverse(path.begin() + first, path.end());
+    // The backward search continues the path from the meeting cell to the target
+    if(target == this->meeting_){
+        for(int cell = this->reverse_arena_.cell(target).parent; cell != -1; cell = this->reverse_arena_.cell(cell).parent)
+            path.push_back( cv::Vec2i(cell % this->data_->grid.cols(), cell / this->data_->grid.cols()) );
+        }
+    JPSASTAR_STAT( this->stats_.path_ns += elapsedNs(begin); )
+    }
+
+
+/**
+ *  Throws if a pixel isn't on the map of the current query
+ *
+ *  \param vec  (x,y) of the checked pixel
+ *  \param name Role of the pixel used in the exception message
+ *
+ *  \throws     NotOnMap is thrown if vec isn't on the map.
+**/
+template<class Movement>
+void BasicSearcher<Movement>::checkOnMap(const cv::Vec2i &vec, const std::string &name) const{
+    ::checkOnMap(this->data_->grid, vec, name);
+    }
+
+
+/**
+ *  Returns unoccupied pixel coordintaes which can be reached from a given pixel in one step
+ *
+ *  \param current Center pixel
+ *
+ *  \return        List of unoccupied neighbors allowed by the movement model
+**/
+template<class Movement>
+Neighbors BasicSearcher<Movement>::connected(const cv::Vec2i &current) const{
+    Neighbors neighbors;
+    for(int y = current[1] - 1; y <= current[1] + 1 ;++y){
+        for(int x = current[0] - 1; x <= current[0] + 1 ;++x){
+            // Range and occupancy check
+            if(   (x != current[0] || y != current[1]) && this->data_->grid.isFree(x, y)
+               && Movement::canStep(this->data_->grid, current, cv::Vec2i(x - current[0], y - current[1])) )
+                neighbors.push_back( cv::Vec2i(x, y) );
+            }
+        }
+    return neighbors;
+    }
+
+
+/**
+ *  Estimates the costs between two pixels
+ *
+ *  Takes the larger one of the estimate of the movement model and the
+ *  landmark bound, if the snapshot has landmarks.
+ *
+ *  \param a (x,y) of the first pixel
+ *  \param b (x,y) of the second pixel
+ *
+ *  \return  Lower bound of the costs from a to b
+**/
+template<class Movement>
+float BasicSearcher<Movement>::estimate(const cv::Vec2i &a, const cv::Vec2i &b) const{
+    const float estimate = Movement::estimate(a, b);
+    const LandmarkTable *landmarks = this->data_->landmarks.get();
+    if(landmarks == NULL)
+        return estimate;
+    const int cols = this->data_->grid.cols();
+    return std::max( estimate, landmarks->lowerBound(a[1] * cols + a[0], b[1] * cols + b[0]) );
+    }
+
+
+/**
+ *  Runs jump point search A* from start to the targets in targets_
+ *
+ *  Targets are reached in order of their path costs. The search stops
+ *  once limit targets are reached or all targets are reached. Afterwards
+ *  remaining_ holds the targets which were not reached, sorted by rows,
+ *  and the paths of all other targets can be built from the arena.
+ *
+ *  \param start (x,y) of the start point in map coordinates, must be on the map
+ *  \param limit Number of targets after which the search stops, 0 for all
+ *
+ *  \return      Cell index of the last reached target, -1 if no target was reached
+**/
+template<class Movement>
+int BasicSearcher<Movement>::expand(const cv::Vec2i &start, size_t limit){
+    JPSASTAR_STAT( this->stats_ = SearchStats();
+                   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    const int cols = this->data_->grid.cols();
+    const TargetSet &targets = this->targets_;
+    SearchArena &arena = this->arena_;
+    arena.reset(this->data_->grid.rows() * cols);
+    this->remaining_ = targets.targets();
+    this->meeting_ = -1;
+    JPSASTAR_STAT( this->stats_.setup_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+    if(limit == 0 || targets.size() < limit)
+        limit = targets.size();
+
+    int last_reached = -1;
+    size_t reached = 0;
+    int start_cell = start[1] * cols + start[0];
+    arena.cell(start_cell).g_value = 0.0;
+    arena.push(start_cell, this->weight_ * this->heuristic(start));
+    JPSASTAR_STAT( this->stats_.pushed = 1;
+                   this->stats_.open_peak = 1; )
+    while(!arena.empty() && reached < limit){
+        if( this->limited_ && this->limitReached() )
+            break;
+        int current = arena.pop();
+        ++this->popped_;
+        CellState &current_state = arena.cell(current);
+        cv::Vec2i current_vec(current % cols, current / cols);
+        if(this->limited_)
+            this->trackClosest(current, current_vec);
+        JPSASTAR_STAT( ++this->stats_.popped;
+                       if(this->trace_){
+                           cv::Vec2i parent = NO_JUMP_POINT;
+                           if(current_state.parent != -1)
+                               parent = cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+                           this->trace_(current_vec, parent, current_state.g_value);
+                           } )
+        // Check if a target was reached, the search continues through it
+        if( targets.contains(current_vec[0], current_vec[1]) ){
+            std::vector<cv::Vec2i>::iterator it = std::find(this->remaining_.begin(), this->remaining_.end(), current_vec);
+            // Rounding errors may reopen a reached target
+            if( it != this->remaining_.end() ){
+                last_reached = current;
+                ++reached;
+                *it = this->remaining_.back();
+                this->remaining_.pop_back();
+                }
+            if(reached == limit)
+                break;
+            // Estimates of open cells may point to the reached target
+            arena.rekey([this, cols](int cell){
+                return this->arena_.cell(cell).g_value + this->weight_ * this->heuristic( cv::Vec2i(cell % cols, cell / cols) ); });
+            }
+
+        // Get successors via pruning and jump point search
+        cv::Vec2i direction(0, 0);
+        if(current_state.parent != -1)
+            direction = current_vec - cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+        cv::Vec2i jp_vec;
+        Neighbors pruned = this->prunedNeighbors(current_vec, direction);
+        for(const cv::Vec2i *it = pruned.begin(); it != pruned.end() ;++it){
+            // Do Jump Point Search for neighbor
+            jp_vec = this->jumpPoint(current_vec, *it, targets);
+            if(jp_vec == NO_JUMP_POINT)
+                continue;
+            // Do regular A* stuff for neighbors
+            float g_neighbor = current_state.g_value + this->moveCosts(current_vec, jp_vec);
+            int jp_cell = jp_vec[1] * cols + jp_vec[0];
+            CellState &jp_state = arena.cell(jp_cell);
+            if(jp_state.g_value <= g_neighbor)
+                continue;
+            jp_state.g_value = g_neighbor;
+            jp_state.parent = current;
+            // Closed cells are reopened if a shorter way was found
+            if(arena.isOpen(jp_cell)){
+                arena.update(jp_cell, g_neighbor + this->weight_ * this->heuristic(jp_vec));
+                JPSASTAR_STAT( ++this->stats_.updated; )
+                }
+            else{
+                arena.push(jp_cell, g_neighbor + this->weight_ * this->heuristic(jp_vec));
+                JPSASTAR_STAT( ++this->stats_.pushed;
+                               this->stats_.open_peak = std::max(this->stats_.open_peak, arena.size()); )
+                }
+            }
+        }
+    std::sort(this->remaining_.begin(), this->remaining_.end(), rowMajorLess);
+    JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin); )
+    return last_reached;
+    }
+
+
+/**
+ *  Expands the best open node of one direction of a bidirectional search
+ *
+ *  Jump points already reached by the other direction join both paths,
+ *  the cheapest joined path is kept in best and meeting.
+ *
+ *  \param arena   Search state of the expanded direction, must not be empty
+ *  \param other   Search state of the opposite direction
+ *  \param targets Start of the opposite direction, jumps stop there
+ *  \param goal    Pixel the expanded direction searches for, used by the heuristic
+ *  \param best    Costs of the cheapest joined path
+ *  \param meeting Cell where the cheapest joined path meets
+**/
+template<class Movement>
+void BasicSearcher<Movement>::expandFrontier(SearchArena &arena,
+                                             SearchArena &other,
+                                             const TargetSet &targets,
+                                             const cv::Vec2i &goal,
+                                             float &best,
+                                             int &meeting){
+    const int cols = this->data_->grid.cols();
+    int current = arena.pop();
+    ++this->popped_;
+    CellState &current_state = arena.cell(current);
+    cv::Vec2i current_vec(current % cols, current / cols);
+    // Partial paths run from the start, so only the forward search counts
+    if(this->limited_ && &arena == &this->arena_)
+        this->trackClosest(current, current_vec);
+    JPSASTAR_STAT( ++this->stats_.popped;
+                   if(this->trace_){
+                       cv::Vec2i parent = NO_JUMP_POINT;
+                       if(current_state.parent != -1)
+                           parent = cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+                       this->trace_(current_vec, parent, current_state.g_value);
+                       } )
+    cv::Vec2i direction(0, 0);
+    if(current_state.parent != -1)
+        direction = current_vec - cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+    Neighbors pruned = this->prunedNeighbors(current_vec, direction);
+    for(const cv::Vec2i *it = pruned.begin(); it != pruned.end() ;++it){
+        cv::Vec2i jp_vec = this->jumpPoint(current_vec, *it, targets);
+        if(jp_vec == NO_JUMP_POINT)
+            continue;
+        float g_neighbor = current_state.g_value + this->moveCosts(current_vec, jp_vec);
+        int jp_cell = jp_vec[1] * cols + jp_vec[0];
+        CellState &jp_state = arena.cell(jp_cell);
+        if(jp_state.g_value <= g_neighbor)
+            continue;
+        jp_state.g_value = g_neighbor;
+        jp_state.parent = current;
+        if(arena.isOpen(jp_cell)){
+            arena.update(jp_cell, g_neighbor + this->weight_ * this->estimate(jp_vec, goal));
+            JPSASTAR_STAT( ++this->stats_.updated; )
+            }
+        else{
+            arena.push(jp_cell, g_neighbor + this->weight_ * this->estimate(jp_vec, goal));
+            JPSASTAR_STAT( ++this->stats_.pushed;
+                           this->stats_.open_peak = std::max(this->stats_.open_peak, arena.size() + other.size()); )
+            }
+        // Both directions reached the jump point
+        float joined = g_neighbor + other.cell(jp_cell).g_value;
+        if(joined < best){
+            best = joined;
+            meeting = jp_cell;
+            }
+        }
+    }
+
+
+/**
+ *  Gernerates path from start to target using a grid map
+ *
+ *  This function uses the jump point search A* algorithm described in
+ *  "Online Graph Pruning for Pathfinding On Grid Maps" by Daniel
+ *  Harabor and Alban Grastien.
+ *  The grid map has to be an 8 bit grey scale image. Values below 255
+ *  are considered to be occupied. And cells/pixels with a value of
+ *  255 is considered to be free space and therefore usable for
+ *  navigation. The query runs on the map of the engine at the time the
+ *  query starts.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *
+ *  \return       Waypoints from start (excluded) to target (included). Empty if no path was found,
+ *                the partial path if a limit stopped the query and partial paths are requested.
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+template<class Movement>
+std::list<cv::Vec2i> BasicSearcher<Movement>::findPath(cv::Vec2i start, cv::Vec2i target){
+    if(this->engine_ != NULL)
+        this->data_ = this->engine_->snapshot();
+    this->resetLimits();
+    int reached = this->search(start, target);
+    // No path found
+    if(reached == -1){
+        if(this->stopped_ != SearchLimits::NONE && this->closest_ != -1)
+            return this->buildPath(this->closest_);
+        return std::list<cv::Vec2i>();
+        }
+    if( !this->smoothing_ || !this->data_->costs.empty() )
+        return this->buildPath(reached);
+    std::vector<cv::Vec2i> path;
+    this->buildPath(reached, path);
+    this->smoothPath(path);
+    return std::list<cv::Vec2i>(path.begin(), path.end());
+    }
+
+
+/**
+ *  Gernerates path from start to target without allocating memory for the result
+ *
+ *  Same as findPath(cv::Vec2i, cv::Vec2i), but the waypoints are written
+ *  to a caller owned buffer. Once the buffer and the internal search state
+ *  have grown large enough, a query does not allocate any memory.
+ *
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
+ *  \param path   Is cleared and receives the waypoints from start to target, or the
+ *                partial path if a limit stopped the query and partial paths are requested
+ *
+ *  \return       True if a path was found, false if there is none or a limit stopped the query
+ *
+ *  \throws       NotOnMap is thrown if start or target isn't on the map.
+**/
+template<class Movement>
+bool BasicSearcher<Movement>::findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path){
+    path.clear();
+    if(this->engine_ != NULL)
+        this->data_ = this->engine_->snapshot();
+    this->resetLimits();
+    int reached = this->search(start, target);
+    if(reached == -1){
+        if(this->stopped_ != SearchLimits::NONE && this->closest_ != -1)
+            this->buildPath(this->closest_, path);
+        return false;
+        }
+    this->buildPath(reached, path);
+    if( this->smoothing_ && this->data_->costs.empty() )
+        this->smoothPath(path);
+    return true;
+    }
+
+
+/**
+ *  Generates a path quickly and improves it until a limit is reached (ARA*)
+ *
+ *  Implements Anytime Repairing A* as described in "ARA*: Anytime A*
+ *  with Provable Bounds on Sub-Optimality" by Maxim Likhachev, Geoff
+ *  Gordon and Sebastian Thrun. The first search uses the weight of the
+ *  searcher, every following search a smaller one until the path is known
+ *  to be a shortest one. All searches share the arena, a following search
+ *  only rekeys the open list and continues where the last one stopped.
+ *  Unlike ARA*, pixels whose costs drop after their expansion are reopened
+ *  at once, since the jump points they lead to depend on their parent.
+ *  Bidirectional and any-angle search are not used.
+ *
+ *  \param start      (x,y) of the start point in map coordinates
+ *  \param target     (x,y) of the target point in map coordinates
+ *  \param path       Is cleared and receives the waypoints of the best path found
+ *  \param bound      Receives the factor by which the path may cost more than a shortest path
+ *  \param deadline   Time after which no further node is expanded
+ *  \param max_popped Number of expanded nodes after which the query stops, 0 for no limit
+ *
+ *  \return           True if a path was found, false if there is none or the first search was stopped
+ *                    by a limit of this call or of the searcher
+ *
+ *  \throws           NotOnMap is thrown if start or target isn't on the map.
+**/
+template<class Movement>
+bool BasicSearcher<Movement>::findPathAnytime(const cv::Vec2i &start,
+                                              const cv::Vec2i &target,
+                                              std::vector<cv::Vec2i> &path,
+                                              float &bound,
+                                              const std::chrono::steady_clock::time_point &deadline,
+                                              size_t max_popped){
+    path.clear();
+    bound = std::numeric_limits<float>::infinity();
+    if(this->engine_ != NULL)
+        this->data_ = this->engine_->snapshot();
+    this->checkOnMap(start, "Start");
+    this->checkOnMap(target, "Target");
+    this->resetLimits();
+    JPSASTAR_STAT( this->stats_ = SearchStats(); )
+    if( !reachable(*this->data_, start, target) )
+        return false;
+    JPSASTAR_STAT( std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    const int cols = this->data_->grid.cols();
+    SearchArena &arena = this->arena_;
+    arena.reset(this->data_->grid.rows() * cols);
+    this->targets_.assign(&target, 1);
+    this->remaining_ = this->targets_.targets();
+    this->meeting_ = -1;
+    JPSASTAR_STAT( this->stats_.setup_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+
+    const int start_cell = start[1] * cols + start[0];
+    const int target_cell = target[1] * cols + target[0];
+    float weight = this->weight_;
+    float finished_weight = std::numeric_limits<float>::infinity();
+    size_t popped = 0;
+    arena.cell(start_cell).g_value = 0.0;
+    arena.push(start_cell, weight * this->heuristic(start));
+    JPSASTAR_STAT( this->stats_.pushed = 1;
+                   this->stats_.open_peak = 1; )
+    while(true){
+        bool finished = this->improvePath(target_cell, weight, deadline, max_popped, popped);
+        float g_target = arena.cell(target_cell).g_value;
+        if(finished)
+            finished_weight = weight;
+        if( finished_weight == std::numeric_limits<float>::infinity() || g_target == std::numeric_limits<float>::infinity() )
+            break;
+        // Every cheaper path runs through an open pixel
+        float lowest = arena.lowest([this, cols](int cell){
+            return this->arena_.cell(cell).g_value + this->heuristic( cv::Vec2i(cell % cols, cell / cols) ); });
+        bound = std::min(finished_weight, g_target <= lowest ? 1.0f : g_target / lowest);
+        if(!finished || bound <= 1.0f)
+            break;
+
+        // The next search continues from the open list of the last one
+        weight = std::max( 1.0f, std::min(weight - 0.5f, bound) );
+        arena.rekey([this, cols, weight](int cell){
+            return this->arena_.cell(cell).g_value + weight * this->heuristic( cv::Vec2i(cell % cols, cell / cols) ); });
+        }
+    JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin); )
+    if( bound == std::numeric_limits<float>::infinity() )
+        return false;
+    this->remaining_.clear();
+    this->buildPath(target_cell, path);
+    if( this->smoothing_ && this->data_->costs.empty() )
+        this->smoothPath(path);
+    return true;
+    }
+
+
+/**
+ *  Generates paths from start to several targets with a single search
+ *
+ *  All targets are checked during the jump point search, so the search
+ *  costs about as much as a query of the farthest reached target. Targets
+ *  are reached in order of their path costs, with limit the search stops
+ *  at the closest limit targets.
+ *
+ *  \param start   (x,y) of the start point in map coordinates
+ *  \param targets (x,y) of the target points in map coordinates
+ *  \param batch   Receives one path per target, empty if the target wasn't reached
+ *  \param limit   Number of targets after which the search stops, 0 for all
+ *
+ *  \return        Number of targets with a path, a stopped query keeps the paths found before
+ *
+ *  \throws        NotOnMap is thrown if start or a target isn't on the map.
+**/
+template<class Movement>
+size_t BasicSearcher<Movement>::findPaths(const cv::Vec2i &start,
+                                          const std::vector<cv::Vec2i> &targets,
+                                          PathBatch &batch,
+                                          size_t limit){
+    if(this->engine_ != NULL)
+        this->data_ = this->engine_->snapshot();
+    this->resetLimits();
+    this->checkOnMap(start, "Start");
+    // Unreachable targets would keep the search running until it explored the whole component
+    this->reachable_.clear();
+    for(size_t i = 0; i < targets.size() ;++i){
+        this->checkOnMap(targets[i], "Target");
+        if( reachable(*this->data_, start, targets[i]) )
+            this->reachable_.push_back(targets[i]);
+        }
+    this->targets_.assign(this->reachable_.data(), this->reachable_.size());
+    JPSASTAR_STAT( this->stats_ = SearchStats(); )
+    if( !this->reachable_.empty() )
+        this->expand(start, limit);
+
+    size_t found = 0;
+    batch.offsets.assign(1, 0);
+    batch.waypoints.clear();
+    for(size_t i = 0; i < targets.size() ;++i){
+        if( this->reached(targets[i]) ){
+            this->buildPath(targets[i][1] * this->data_->grid.cols() + targets[i][0], batch.waypoints);
+            ++found;
+            }
+        batch.offsets.push_back( batch.waypoints.size() );
+        }
+    return found;
+    }
+
+
+/**
+ *  Estimates the remaining costs of a pixel
+ *
+ *  Distance of the movement model to the closest target which is not
+ *  reached yet. Takes O(k) time for k remaining targets.
+ *
+ *  \param vec (x,y) of the pixel
+ *
+ *  \return    Lower bound of the costs from vec to any remaining target
+**/
+template<class Movement>
+float BasicSearcher<Movement>::heuristic(const cv::Vec2i &vec) const{
+    float closest = std::numeric_limits<float>::infinity();
+    for(size_t i = 0; i < this->remaining_.size() ;++i)
+        closest = std::min( closest, this->estimate(vec, this->remaining_[i]) );
+    return closest;
+    }
+
+
+/**
+ *  Runs one search of findPathAnytime
  *
- *  Target node is included in the resulting list.
+ *  Expands nodes like expand until no open f value is below the costs of
+ *  the target, so the path to the target costs at most weight times as
+ *  much as a shortest path.
  *
- *  \param target Last waypoint node
+ *  \param target_cell Cell index of the target
+ *  \param weight      Factor of the heuristic in the f values of the open list
+ *  \param deadline    Time after which no further node is expanded
+ *  \param max_popped  Number of expanded nodes of all searches after which the search stops, 0 for no limit
+ *  \param popped      Number of nodes expanded by all searches so far, is increased
  *
- *  \return       List of waypoints from start node to target node
+ *  \return            True if the search finished, false if a limit stopped it
 **/
-std::list<cv::Vec2i> JPSAStar::buildPath(const Node &target) const{
-    std::list<cv::Vec2i> path;
-    path.push_front(target.vector);
-    Node *parent = target.parent;
-    while(parent != NULL){
-        path.push_front(parent->vector);
-        parent = parent->parent;
+template<class Movement>
+bool BasicSearcher<Movement>::improvePath(int target_cell,
+                                          float weight,
+                                          const std::chrono::steady_clock::time_point &deadline,
+                                          size_t max_popped,
+                                          size_t &popped){
+    const int cols = this->data_->grid.cols();
+    SearchArena &arena = this->arena_;
+    while( !arena.empty() && arena.topValue() < arena.cell(target_cell).g_value ){
+        if(   (max_popped != 0 && max_popped <= popped) || deadline <= std::chrono::steady_clock::now()
+           || (this->limited_ && this->limitReached()) )
+            return false;
+        int current = arena.pop();
+        ++popped;
+        ++this->popped_;
+        CellState &current_state = arena.cell(current);
+        cv::Vec2i current_vec(current % cols, current / cols);
+        JPSASTAR_STAT( ++this->stats_.popped;
+                       if(this->trace_){
+                           cv::Vec2i parent = NO_JUMP_POINT;
+                           if(current_state.parent != -1)
+                               parent = cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+                           this->trace_(current_vec, parent, current_state.g_value);
+                           } )
+        cv::Vec2i direction(0, 0);
+        if(current_state.parent != -1)
+            direction = current_vec - cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+        Neighbors pruned = this->prunedNeighbors(current_vec, direction);
+        for(const cv::Vec2i *it = pruned.begin(); it != pruned.end() ;++it){
+            cv::Vec2i jp_vec = this->jumpPoint(current_vec, *it, this->targets_);
+            if(jp_vec == NO_JUMP_POINT)
+                continue;
+            float g_neighbor = current_state.g_value + this->moveCosts(current_vec, jp_vec);
+            int jp_cell = jp_vec[1] * cols + jp_vec[0];
+            CellState &jp_state = arena.cell(jp_cell);
+            if(jp_state.g_value <= g_neighbor)
+                continue;
+            jp_state.g_value = g_neighbor;
+            jp_state.parent = current;
+            // Closed cells are reopened if a shorter way was found
+            if(arena.isOpen(jp_cell)){
+                arena.update(jp_cell, g_neighbor + weight * this->heuristic(jp_vec));
+                JPSASTAR_STAT( ++this->stats_.updated; )
+                }
+            else{
+                arena.push(jp_cell, g_neighbor + weight * this->heuristic(jp_vec));
+                JPSASTAR_STAT( ++this->stats_.pushed;
+                               this->stats_.open_peak = std::max(this->stats_.open_peak, arena.size()); )
+                }
+            }
         }
-    return path;
+    return true;
     }
 
 
 /**
- *  Returns 8-connected unoccupied pixel coordintaes to a given node
+ *  Checks if the next pixel in a direction is a jump point (JPS+)
+ *
+ *  A diagonal jump stops at pixels with diagonal forced neighbors and at
+ *  pixels from which a straight jump point follows in one of the two
+ *  straight components of the direction.
  *
- *  \param current Center node
+ *  \param next        Free pixel that is checked
+ *  \param dir         Index of the direction in JumpTable::DIRECTIONS
+ *  \param straight_jp Bit i is set if a straight jump point follows next in direction i
  *
- *  \return        List of 8-connected unoccupied neighbors
+ *  \return            True if a jump in direction dir stops at next
 **/
-std::list<cv::Vec2i> JPSAStar::connected(Node &current) const{
-    std::list<cv::Vec2i> neighbors;
-    bool x_p_one = false;
-    bool x_m_one = false;
-    std::vector<int> connected_idxs;
-    // Range and occupancy checks
-    if(current.vector[0] + 1 < this->map_.cols){
-        x_p_one = true;
-        if(0 < this->map_.at<uchar>(current.vector[1], current.vector[0] + 1))
-            neighbors.push_back( cv::Vec2i(current.vector[0] + 1, current.vector[1]) );
-        }
-    if(0 <= current.vector[0] - 1){
-        x_m_one = true;
-        if(0 < this->map_.at<uchar>(current.vector[1], current.vector[0] - 1))
-            neighbors.push_back( cv::Vec2i(current.vector[0] - 1, current.vector[1]) );
-        }
-    if(current.vector[1] + 1 < this->map_.rows){
-        if( 0 < this->map_.at<uchar>(current.vector[1] + 1, current.vector[0]) )
-            neighbors.push_back( cv::Vec2i(current.vector[0], current.vector[1] + 1) );
-        if( x_p_one && 0 < this->map_.at<uchar>(current.vector[1] + 1, current.vector[0] + 1) )
-            neighbors.push_back( cv::Vec2i(current.vector[0] + 1, current.vector[1] + 1) );
-        if( x_m_one && 0 < this->map_.at<uchar>(current.vector[1] + 1, current.vector[0] - 1) )
-            neighbors.push_back( cv::Vec2i(current.vector[0] - 1, current.vector[1] + 1) );
-        }
-    if(0 <= current.vector[1] - 1){
-        if( 0 < this->map_.at<uchar>(current.vector[1] - 1, current.vector[0]) )
-            neighbors.push_back( cv::Vec2i(current.vector[0], current.vector[1] - 1) );
-        if( x_p_one && 0 < this->map_.at<uchar>(current.vector[1] - 1, current.vector[0] + 1) )
-            neighbors.push_back( cv::Vec2i(current.vector[0] + 1, current.vector[1] - 1) );
-        if( x_m_one && 0 < this->map_.at<uchar>(current.vector[1] - 1, current.vector[0] - 1) )
-            neighbors.push_back( cv::Vec2i(current.vector[0] - 1, current.vector[1] - 1) );
-        }
-    return neighbors;
+template<class Movement>
+bool BasicSearcher<Movement>::isJumpPoint(const cv::Vec2i &next, int dir, int straight_jp) const{
+    const cv::Vec2i &direction = JumpTable::DIRECTIONS[dir];
+    const BitGrid &grid = this->data_->grid;
+    if(direction[0] == 0 || direction[1] == 0)
+        return Movement::hasForced(grid, next, direction);
+    const int dir_x = JumpTable::direction( cv::Vec2i(direction[0], 0) );
+    const int dir_y = JumpTable::direction( cv::Vec2i(0, direction[1]) );
+    return    Movement::hasForced(grid, next, direction)
+           || Movement::hasForced( grid, next, cv::Vec2i(direction[0], 0) )
+           || Movement::hasForced( grid, next, cv::Vec2i(0, direction[1]) )
+           || (straight_jp & ((1 << dir_x) | (1 << dir_y)));
+    }
+
+
+/**
+ *  Computes jump point of given coodinates
+ *
+ *  \param parent  Parent of current
+ *  \param current Origin of computed jump point
+ *  \param target  Target coordinates, because the target is a special jump point
+ *
+ *  \return        Jump point of current, NO_JUMP_POINT if there is none
+**/
+template<class Movement>
+cv::Vec2i BasicSearcher<Movement>::jumpPoint(const cv::Vec2i &parent, const cv::Vec2i &current, const cv::Vec2i &target) const{
+    TargetSet targets;
+    targets.assign(&target, 1);
+    return this->jumpPoint(parent, current, targets);
+    }
+
+
+/**
+ *  Computes jump point of given coodinates
+ *
+ *  \param parent  Parent of current
+ *  \param current Origin of computed jump point
+ *  \param targets Target coordinates, because targets are special jump points
+ *
+ *  \return        Jump point of current, NO_JUMP_POINT if there is none
+**/
+template<class Movement>
+cv::Vec2i BasicSearcher<Movement>::jumpPoint(const cv::Vec2i &parent, const cv::Vec2i &current, const TargetSet &targets) const{
+    JPSASTAR_STAT( ++this->stats_.jumps; )
+    cv::Vec2i direction = current - parent;
+    if(direction[0] != 0) direction[0] = direction[0] / abs(direction[0]);
+    if(direction[1] != 0) direction[1] = direction[1] / abs(direction[1]);
+
+    cv::Vec2i origin = current - direction;
+    if(   Movement::JUMP_TABLE && !this->data_->jumps.empty() && this->data_->costs.empty()
+       && this->data_->grid.isInside(origin[0], origin[1]) )
+        return this->tableJumpPoint(origin, direction, targets);
+    if( Movement::isBranching(direction) )
+        return this->branchingJPS(current, targets, direction);
+    else
+        return this->straightJPS(current, targets, direction);
     }
 
 
 /**
- *  Computes forced neighbors of diagonally expanded node
+ *  Checks the limits of the current query
  *
- *  \param current   Parent of computed neighbors
- *  \param direction Vector pointing in diagonal direction: (1,1), (-1,1), (-1,-1) or (1,-1)
+ *  Once a limit is reached, stopped_ keeps it and every later check fails
+ *  at once, also the checks within jump scans.
  *
- *  \return          Forced neighbors of current
+ *  \return True if the query has to stop
 **/
-std::list<cv::Vec2i> JPSAStar::diagonalForced(const cv::Vec2i &current, const cv::Vec2i &direction) const{
-    std::list<cv::Vec2i> forced;
-    int x_forced = current[0] + direction[0];
-    int y_forced = current[1] + direction[1];
-    if(   0 <= x_forced && x_forced < this->map_.cols
-       && this->map_.at<uchar>(current[1] - direction[1], current[0]) == 0
-       && 0 < this->map_.at<uchar>(current[1] - direction[1], x_forced) ){
-        forced.push_back( cv::Vec2i(x_forced, current[1] - direction[1]) );
+template<class Movement>
+bool BasicSearcher<Movement>::limitReached() const{
+    const SearchLimits &limits = this->limits_;
+    if(this->stopped_ == SearchLimits::NONE){
+        if( limits.cancel != NULL && limits.cancel->load(std::memory_order_relaxed) )
+            this->stopped_ = SearchLimits::CANCELLED;
+        else if(limits.max_popped != 0 && limits.max_popped <= this->popped_)
+            this->stopped_ = SearchLimits::POPPED;
+        else if(limits.max_scanned != 0 && limits.max_scanned <= this->scanned_)
+            this->stopped_ = SearchLimits::SCANNED;
+        else if( limits.deadline != std::chrono::steady_clock::time_point::max()
+                 && limits.deadline <= std::chrono::steady_clock::now() )
+            this->stopped_ = SearchLimits::DEADLINE;
         }
-    if(   0 <= y_forced && y_forced < this->map_.rows
-       && this->map_.at<uchar>(current[1], current[0] - direction[0]) == 0
-       && 0 < this->map_.at<uchar>(y_forced, current[0] - direction[0]) ){
-        forced.push_back( cv::Vec2i(current[0] - direction[0], y_forced) );
+    if(this->stopped_ != SearchLimits::NONE){
+        this->next_check_ = 0;
+        return true;
         }
-    return forced;
+    this->next_check_ = this->scanned_ + SearchLimits::CHECK_INTERVAL;
+    if(limits.max_scanned != 0 && limits.max_scanned < this->next_check_)
+        this->next_check_ = limits.max_scanned;
+    return false;
     }
 
 
 /**
- *  Computes diagonal jump point in direction of given direction
+ *  Returns the costs of the move from a jump point to its successor
  *
- *  \param current   Origin of computed jump point
- *  \param target    Target coordinates, because the target is a special jump point
- *  \param direction Vector pointing in diagonal direction: (1,1), (-1,1), (-1,-1) or (1,-1)
+ *  Jumps only pass uniform pixels, which have the costs of their
+ *  neighbors on the line. So all pixels after from cost the same as to
+ *  and the move takes O(1) time instead of summing up every step.
  *
- *  \return          Jump point of current
+ *  \param from Expanded pixel
+ *  \param to   Jump point found in a straight or diagonal direction of from
+ *
+ *  \return     Costs of the line from from to to, its Euclidean length without costs
 **/
-cv::Vec2i* JPSAStar::diagonalJPS(cv::Vec2i current, const cv::Vec2i &target, const cv::Vec2i &direction) const{
-    cv::Vec2i *jps_vec;
-    // While in range and not occupied
-    while(   0 < current[0] && current[0] < this->map_.cols
-          && 0 < current[1] && current[1] < this->map_.rows
-          && 0 < this->map_.at<uchar>(current[1], current[0])){
-        // Check if target reached
-        if(current[0] == target[0] && current[1] == target[1])
-            return new cv::Vec2i(current);
-        // Check for diagonal forced neighbors
-        if( !this->diagonalForced(current, direction).empty() )
-            return new cv::Vec2i(current);
-        // Check for straight x and y jump points
-        jps_vec = this->straightJPS(current, target, cv::Vec2i(direction[0], 0));
-        if(jps_vec){
-            delete jps_vec;
-            return new cv::Vec2i(current);
-            }
-        jps_vec = this->straightJPS(current, target, cv::Vec2i(0, direction[1]));
-        if(jps_vec){
-            delete jps_vec;
-            return new cv::Vec2i(current);
-            }
-        current += direction;
+template<class Movement>
+float BasicSearcher<Movement>::moveCosts(const cv::Vec2i &from, const cv::Vec2i &to) const{
+    const float length = this->distance(from, to);
+    const cv::Mat &costs = this->data_->costs;
+    if( costs.empty() )
+        return length;
+    const int steps = std::max( std::abs(to[0] - from[0]), std::abs(to[1] - from[1]) );
+    const float to_costs = costs.at<float>(to[1], to[0]);
+    return length / steps * (0.5f * (costs.at<float>(from[1], from[0]) + to_costs) + (steps - 1) * to_costs);
+    }
+
+
+/**
+ *  Prunes neighbors according to the direction of expansion of a give node
+ *
+ *  \param current Center node for which neighbors will be generated
+ *
+ *  \return        Pruned neighbors of current
+**/
+template<class Movement>
+Neighbors BasicSearcher<Movement>::prunedNeighbors(const Node &current) const{
+    // Check for start node
+    if(current.parent == NULL)
+        return this->prunedNeighbors(current.vector, cv::Vec2i(0, 0));
+    return this->prunedNeighbors(current.vector, current.vector - current.parent->vector);
+    }
+
+
+/**
+ *  Prunes neighbors according to the direction of expansion of a given pixel
+ *
+ *  \param current   Center pixel for which neighbors will be generated
+ *  \param direction Vector from the parent to current, (0,0) if current has no parent
+ *
+ *  \return          Pruned neighbors of current
+**/
+template<class Movement>
+Neighbors BasicSearcher<Movement>::prunedNeighbors(const cv::Vec2i &current, cv::Vec2i direction) const{
+    // Check for start node and pixels next to a change of the costs
+    if( (direction[0] == 0 && direction[1] == 0) || !this->isUniform(current) ){
+        return this->connected(current);
         }
-    return NULL;
+    Neighbors pruned;
+    if(direction[0] != 0) direction[0] = direction[0] / abs(direction[0]);
+    if(direction[1] != 0) direction[1] = direction[1] / abs(direction[1]);
+    Movement::prune(this->data_->grid, current, direction, pruned);
+    return pruned;
     }
 
 
 /**
- *  Gernerates path from start to target using a grid map
+ *  Checks if the last search reached a target
  *
- *  This function uses the jump point search A* algorithm described in
- *  "Online Graph Pruning for Pathfinding On Grid Maps" by Daniel
- *  Harabor and Alban Grastien.
- *  The grid map has to be an 8 bit grey scale image. Values below 255
- *  are considered to be occupied. And cells/pixels with a value of
- *  255 is considered to be free space and therefore usable for
- *  navigation.
+ *  \param target (x,y) of the target
+ *
+ *  \return       True if target is a target of the last search and was reached
+**/
+template<class Movement>
+bool BasicSearcher<Movement>::reached(const cv::Vec2i &target) const{
+    return    this->targets_.contains(target[0], target[1])
+           && !std::binary_search(this->remaining_.begin(), this->remaining_.end(), target, rowMajorLess);
+    }
+
+
+/**
+ *  Resets the counters checked against the limits at the start of a query
+**/
+template<class Movement>
+void BasicSearcher<Movement>::resetLimits(){
+    this->stopped_ = SearchLimits::NONE;
+    this->popped_ = 0;
+    this->scanned_ = 0;
+    this->next_check_ = std::numeric_limits<size_t>::max();
+    if(this->limited_){
+        this->next_check_ = SearchLimits::CHECK_INTERVAL;
+        if(this->limits_.max_scanned != 0 && this->limits_.max_scanned < this->next_check_)
+            this->next_check_ = this->limits_.max_scanned;
+        }
+    this->closest_ = -1;
+    this->closest_estimate_ = std::numeric_limits<float>::infinity();
+    }
+
+
+/**
+ *  Runs jump point search A* from start to target in the search arena
  *
- *  \param start  (x,y) of the start point in this->map_ coordinates
- *  \param target (x,y) of the target point in this->map_ coordinates
+ *  \param start  (x,y) of the start point in map coordinates
+ *  \param target (x,y) of the target point in map coordinates
  *
- *  \return       Waypoints from start (excluded) to target (included). Empty if no path was found.
+ *  \return       Cell index of the target, -1 if no path was found
  *
  *  \throws       NotOnMap is thrown if start or target isn't on the map.
 **/
-std::list<cv::Vec2i> JPSAStar::findPath(cv::Vec2i start, cv::Vec2i target) const{
-    // Throw exception if start or target is out of map range
-    if(   start[0] < 0 || this->map_.size().width < start[0]
-       || start[1] < 0 || this->map_.size().height < start[1] )
-        throw NotOnMap( std::string("[JPSAStar] Start vector (")
-                      + std::to_string(start[0]) + "," + std::to_string(start[1])
-                      + ") out of map range ("
-                      + std::to_string(this->map_.size().width) + "," + std::to_string(this->map_.size().height)
-                      + ")" );
-    if(   target[0] < 0 || this->map_.size().width < target[0]
-       || target[1] < 0 || this->map_.size().height < target[1] )
-        throw NotOnMap( std::string("[JPSAStar] Target vector (")
-                      + std::to_string(target[0]) + "," + std::to_string(target[1])
-                      + ") out of map range ("
-                      + std::to_string(this->map_.size().width) + "," + std::to_string(this->map_.size().height)
-                      + ")" );
+template<class Movement>
+int BasicSearcher<Movement>::search(const cv::Vec2i &start, const cv::Vec2i &target){
+    this->checkOnMap(start, "Start");
+    this->checkOnMap(target, "Target");
+    if( !reachable(*this->data_, start, target) ){
+        JPSASTAR_STAT( this->stats_ = SearchStats(); )
+        return -1;
+        }
+    if( this->any_angle_ && this->data_->costs.empty() )
+        return this->searchAnyAngle(start, target);
+    // Searches may leave an occupied start but never enter an occupied pixel, so
+    // the backward search only mirrors the forward search between free pixels
+    if( this->bidirectional_ && this->data_->grid.isFree(start[0], start[1]) && this->data_->grid.isFree(target[0], target[1]) )
+        return this->searchBidirectional(start, target);
+    this->targets_.assign(&target, 1);
+    return this->expand(start, 1);
+    }
 
-    std::list<cv::Vec2i> ret;
-    MinHeap open_queue;
-    VecSet closed_set;
-
-    Node *current = new Node(start, NULL, 0.0, this->distance(start, target));
-    open_queue.insert( std::pair<float, Node*>(current->g_value, current) );
-    while(!open_queue.empty()){
-        current = open_queue.begin()->second;
-        open_queue.erase( open_queue.begin() );
-        // Check if target was reached
-        if( current->vector[0] == target[0] && current->vector[1] == target[1] ){
-            ret = this->buildPath(*current);
-            break;
-            }
-        closed_set.insert(current);
 
-        // Get successors via pruning and jump point search
-        cv::Vec2i *jump_point;
-        MinHeap::iterator in_open;
-        VecSet::iterator in_closed;
-        std::list<cv::Vec2i> pruned = this->prunedNeighbors(*current);
-        std::list<cv::Vec2i>::iterator it, end;
-        Node *jp_node;
-        for(it=pruned.begin(),end=pruned.end(); it != end ;++it){
-            // Do Jump Point Search for neighbor
-            jump_point = this->jumpPoint(current->vector, *it, target);
-            if(jump_point != NULL){
-                jp_node = new Node(*jump_point, NULL);
-                // Do regular A* stuff for neighbors
-                float g_neighbor = current->g_value + this->distance(current->vector, *jump_point);
-                in_closed = closed_set.find(jp_node);
-                // Search vor jump point in closed_set
-                in_open = open_queue.end();
-                // Search vor jump point in open_queue
-                for(MinHeap::iterator ith=open_queue.begin(); ith != open_queue.end() ;++ith){
-                    if(ith->second->vector[0] == jp_node->vector[0] && ith->second->vector[1] == jp_node->vector[1]){
-                        in_open = ith;
-                        break;
-                        }
-                    }
-                if( in_closed != closed_set.end() && (*in_closed)->g_value <= g_neighbor){
-                    if( (*in_closed)->g_value <= g_neighbor )
-                        continue;
-                    else{
-                        delete *in_closed;
-                        closed_set.erase(in_closed);
+/**
+ *  Runs Lazy Theta* from start to target in the search arena
+ *
+ *  A* on all neighbors allowed by the movement model, but a neighbor
+ *  takes the parent of the expanded pixel as its parent, assuming that it
+ *  can see the neighbor. The line of sight is checked once the neighbor
+ *  is expanded. If it is blocked, the cheapest expanded neighbor becomes
+ *  the parent instead. So every expansion takes one line of sight check
+ *  and the parent links form an any-angle path.
+ *
+ *  \param start  (x,y) of the start point in map coordinates, must be on the map
+ *  \param target (x,y) of the target point in map coordinates, must be on the map
+ *
+ *  \return       Cell index of the target, -1 if no path was found
+**/
+template<class Movement>
+int BasicSearcher<Movement>::searchAnyAngle(const cv::Vec2i &start, const cv::Vec2i &target){
+    JPSASTAR_STAT( this->stats_ = SearchStats();
+                   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    const BitGrid &grid = this->data_->grid;
+    const int cols = grid.cols();
+    SearchArena &arena = this->arena_;
+    arena.reset(grid.rows() * cols);
+    this->targets_.assign(&target, 1);
+    this->remaining_ = this->targets_.targets();
+    this->meeting_ = -1;
+    JPSASTAR_STAT( this->stats_.setup_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+
+    const int start_cell = start[1] * cols + start[0];
+    const int target_cell = target[1] * cols + target[0];
+    arena.cell(start_cell).g_value = 0.0;
+    arena.push( start_cell, Movement::estimate(start, target) );
+    JPSASTAR_STAT( this->stats_.pushed = 1;
+                   this->stats_.open_peak = 1; )
+    while( !arena.empty() ){
+        if( this->limited_ && this->limitReached() )
+            break;
+        int current = arena.pop();
+        ++this->popped_;
+        CellState &current_state = arena.cell(current);
+        cv::Vec2i current_vec(current % cols, current / cols);
+        // A single step needs no check, this also lets the search leave an occupied start
+        if(current_state.parent != -1){
+            cv::Vec2i parent_vec(current_state.parent % cols, current_state.parent / cols);
+            cv::Vec2i step = current_vec - parent_vec;
+            if(   1 < std::max(std::abs(step[0]), std::abs(step[1]))
+               || !Movement::canStep(grid, parent_vec, step) ){
+                JPSASTAR_STAT( ++this->stats_.sight_checks; )
+                if( !Movement::lineOfSight(grid, parent_vec, current_vec) ){
+                    current_state.g_value = std::numeric_limits<float>::infinity();
+                    Neighbors neighbors = this->connected(current_vec);
+                    for(const cv::Vec2i *it = neighbors.begin(); it != neighbors.end() ;++it){
+                        int cell = (*it)[1] * cols + (*it)[0];
+                        if( !arena.isClosed(cell) )
+                            continue;
+                        float g_value = arena.cell(cell).g_value + this->distance(*it, current_vec);
+                        if(g_value < current_state.g_value){
+                            current_state.g_value = g_value;
+                            current_state.parent = cell;
+                            }
                         }
                     }
-                if( in_open != open_queue.end() && g_neighbor < in_open->second->g_value){
-                    delete in_open->second;
-                    open_queue.erase(in_open);
-                    in_open = open_queue.end();
-                    }
-                if( in_open == open_queue.end() ){
-                    jp_node->g_value = g_neighbor;
-                    jp_node->f_value = g_neighbor + this->distance(jp_node->vector, target);
-                    jp_node->parent = current;
-                    open_queue.insert( std::pair<float, Node*>(jp_node->f_value, jp_node) );
-                    }
-                delete jump_point;
+                }
+            }
+        if(this->limited_)
+            this->trackClosest(current, current_vec);
+        JPSASTAR_STAT( ++this->stats_.popped;
+                       if(this->trace_){
+                           cv::Vec2i parent = NO_JUMP_POINT;
+                           if(current_state.parent != -1)
+                               parent = cv::Vec2i(current_state.parent % cols, current_state.parent / cols);
+                           this->trace_(current_vec, parent, current_state.g_value);
+                           } )
+        if(current == target_cell){
+            this->remaining_.clear();
+            JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin); )
+            return current;
+            }
+
+        // Neighbors inherit the parent of current
+        const int parent = current_state.parent == -1 ? current : current_state.parent;
+        const cv::Vec2i parent_vec(parent % cols, parent / cols);
+        const float parent_g = arena.cell(parent).g_value;
+        Neighbors neighbors = this->connected(current_vec);
+        for(const cv::Vec2i *it = neighbors.begin(); it != neighbors.end() ;++it){
+            int cell = (*it)[1] * cols + (*it)[0];
+            if( arena.isClosed(cell) )
+                continue;
+            float g_neighbor = parent_g + this->distance(parent_vec, *it);
+            CellState &state = arena.cell(cell);
+            if(state.g_value <= g_neighbor)
+                continue;
+            state.g_value = g_neighbor;
+            state.parent = parent;
+            if(arena.isOpen(cell)){
+                arena.update(cell, g_neighbor + Movement::estimate(*it, target));
+                JPSASTAR_STAT( ++this->stats_.updated; )
+                }
+            else{
+                arena.push(cell, g_neighbor + Movement::estimate(*it, target));
+                JPSASTAR_STAT( ++this->stats_.pushed;
+                               this->stats_.open_peak = std::max(this->stats_.open_peak, arena.size()); )
                 }
             }
         }
-    // Clean up
-    MinHeap::iterator mh_it = open_queue.begin(), mh_end = open_queue.end();
-    for(; mh_it != mh_end;++mh_it){
-        delete mh_it->second;
+    JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin); )
+    return -1;
+    }
+
+
+/**
+ *  Runs jump point search A* from start and from target at once
+ *
+ *  Each open list holds a node of a shortest path whose f value is at
+ *  most the costs of that path. So once the smallest f value of either
+ *  direction is not below the cheapest joined path, that path is a
+ *  shortest one. With a weight w, f values are at most w times the costs
+ *  of that path, so the joined path costs at most w times as much. The
+ *  direction with the larger smallest f value is expanded next, as it is
+ *  closer to this bound. Usually that is the direction whose heuristic is
+ *  misled less by dead ends. The forward search keeps its state in
+ *  arena_, the backward search in reverse_arena_.
+ *
+ *  \param start  (x,y) of the start point in map coordinates, must be free
+ *  \param target (x,y) of the target point in map coordinates, must be free
+ *
+ *  \return       Cell index where the paths of both directions join, -1 if no path was found
+**/
+template<class Movement>
+int BasicSearcher<Movement>::searchBidirectional(const cv::Vec2i &start, const cv::Vec2i &target){
+    JPSASTAR_STAT( this->stats_ = SearchStats();
+                   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    const int cols = this->data_->grid.cols();
+    this->arena_.reset(this->data_->grid.rows() * cols);
+    this->reverse_arena_.reset(this->data_->grid.rows() * cols);
+    this->targets_.assign(&target, 1);
+    this->reverse_targets_.assign(&start, 1);
+    this->remaining_ = this->targets_.targets();
+    JPSASTAR_STAT( this->stats_.setup_ns = elapsedNs(begin);
+                   begin = std::chrono::steady_clock::now(); )
+
+    float best = std::numeric_limits<float>::infinity();
+    int meeting = -1;
+    const int start_cell = start[1] * cols + start[0];
+    const int target_cell = target[1] * cols + target[0];
+    this->arena_.cell(start_cell).g_value = 0.0;
+    this->arena_.push( start_cell, this->weight_ * this->estimate(start, target) );
+    this->reverse_arena_.cell(target_cell).g_value = 0.0;
+    this->reverse_arena_.push( target_cell, this->weight_ * this->estimate(start, target) );
+    JPSASTAR_STAT( this->stats_.pushed = 2;
+                   this->stats_.open_peak = 2; )
+    if(start_cell == target_cell){
+        best = 0.0;
+        meeting = start_cell;
         }
-    VecSet::iterator vs_it = closed_set.begin(), vs_end = closed_set.end();
-    for(; vs_it != vs_end ;++vs_it){
-        delete *vs_it;
+    while( !this->arena_.empty() && !this->reverse_arena_.empty() ){
+        if( best <= this->arena_.topValue() || best <= this->reverse_arena_.topValue() )
+            break;
+        // A joined path is not known to be a shortest one before the loop ends
+        if( this->limited_ && this->limitReached() ){
+            meeting = -1;
+            break;
+            }
+        if( this->reverse_arena_.topValue() <= this->arena_.topValue() )
+            this->expandFrontier(this->arena_, this->reverse_arena_, this->targets_, target, best, meeting);
+        else
+            this->expandFrontier(this->reverse_arena_, this->arena_, this->reverse_targets_, start, best, meeting);
         }
-    // No path found
-    return ret;
+    if(meeting != -1)
+        this->remaining_.clear();
+    this->meeting_ = meeting;
+    JPSASTAR_STAT( this->stats_.search_ns = elapsedNs(begin); )
+    return meeting;
     }
 
 
 /**
  *  Constructor
  *
- *  The grid map has to be an 8 bit grey scale image. Values below 255
- *  are considered to be occupied. And a cells/pixels with a value of
- *  255 is considered to be free space and therefore usable for
- *  navigation.
+ *  \param engine Engine whose map is searched, must outlive the searcher
+**/
+template<class Movement>
+BasicSearcher<Movement>::BasicSearcher(const JPSAStar &engine)
+    : engine_(&engine), data_(engine.snapshot()), bidirectional_(false), meeting_(-1), smoothing_(false), any_angle_(false), weight_(1.0f),
+      limited_(false), stopped_(SearchLimits::NONE), popped_(0), scanned_(0), next_check_(std::numeric_limits<size_t>::max()),
+      closest_(-1), closest_estimate_(std::numeric_limits<float>::infinity()){
+    }
+
+
+/**
+ *  Constructor for searchers working on a map which is not published yet
  *
- *  \param map 8 bit grey scale image
+ *  All queries search data.
+ *
+ *  \param data Map snapshot that is searched
 **/
-JPSAStar::JPSAStar(cv::Mat map) : map_(map){
+template<class Movement>
+BasicSearcher<Movement>::BasicSearcher(const std::shared_ptr<const MapData> &data)
+    : engine_(NULL), data_(data), bidirectional_(false), meeting_(-1), smoothing_(false), any_angle_(false), weight_(1.0f),
+      limited_(false), stopped_(SearchLimits::NONE), popped_(0), scanned_(0), next_check_(std::numeric_limits<size_t>::max()),
+      closest_(-1), closest_estimate_(std::numeric_limits<float>::infinity()){
     }
 
+
 /**
- *  Computes jump point of given coodinates
+ *  Sets the limits of the following queries
  *
- *  \param parent  Parent of current
- *  \param current Origin of computed jump point
- *  \param target  Target coordinates, because the target is a special jump point
+ *  The cancellation flag may be set by any thread, the query stops within
+ *  one expansion or CHECK_INTERVAL scanned pixels. A stopped query finds
+ *  no path, stopped tells which limit was reached.
  *
- *  \return        Jump point of current
+ *  \param limits Deadline, budgets and cancellation flag of the queries
 **/
-cv::Vec2i* JPSAStar::jumpPoint(const cv::Vec2i &parent, const cv::Vec2i &current, const cv::Vec2i &target) const{
-    cv::Vec2i direction = current - parent;
-    if(direction[0] != 0) direction[0] = direction[0] / abs(direction[0]);
-    if(direction[1] != 0) direction[1] = direction[1] / abs(direction[1]);
+template<class Movement>
+void BasicSearcher<Movement>::setLimits(const SearchLimits &limits){
+    this->limits_ = limits;
+    this->limited_ =    limits.deadline != std::chrono::steady_clock::time_point::max()
+                     || limits.max_popped != 0
+                     || limits.max_scanned != 0
+                     || limits.cancel != NULL;
+    }
 
-    if(direction[0] != 0 && direction[1] != 0)
-        return this->diagonalJPS(current, target, direction);
-    else
-        return this->straightJPS(current, target, direction);
+
+/**
+ *  Sets the factor of the heuristic of jump point searches (weighted A*)
+ *
+ *  Weights above 1 make the search greedier. It expands fewer nodes, but
+ *  paths may cost up to weight times as much as a shortest path. Used by
+ *  findPath and findPaths, and as first weight of findPathAnytime.
+ *  Lazy Theta* ignores it.
+ *
+ *  \param weight Factor of the heuristic, 1 for shortest paths
+ *
+ *  \throws       std::invalid_argument is thrown if weight is below 1 or not finite.
+**/
+template<class Movement>
+void BasicSearcher<Movement>::setWeight(float weight){
+    if( !(1.0f <= weight) || weight == std::numeric_limits<float>::infinity() )
+        throw std::invalid_argument("[JPSAStar] Weight has to be finite and at least 1");
+    this->weight_ = weight;
     }
 
 
 /**
- *  Returns a clone of the map
+ *  Removes waypoints which the previous kept waypoint can see past
  *
- *  \return Clone of internally used map
+ *  Walks the path once and keeps a waypoint only if the line from the
+ *  last kept waypoint to the next one is blocked. This takes one line of
+ *  sight check per waypoint, each checks a word of the bit grid at once.
+ *
+ *  \param path Waypoints which are shortened in place
 **/
-cv::Mat JPSAStar::map() const{
-    return this->map_.clone();
+template<class Movement>
+void BasicSearcher<Movement>::smoothPath(std::vector<cv::Vec2i> &path) const{
+    if(path.size() < 3)
+        return;
+    JPSASTAR_STAT( std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(); )
+    size_t kept = 0;
+    for(size_t i = 1; i + 1 < path.size() ;++i){
+        JPSASTAR_STAT( ++this->stats_.sight_checks; )
+        if( !Movement::lineOfSight(this->data_->grid, path[kept], path[i + 1]) )
+            path[++kept] = path[i];
+        }
+    path[++kept] = path.back();
+    path.resize(kept + 1);
+    JPSASTAR_STAT( this->stats_.path_ns += elapsedNs(begin); )
     }
 
 
 /**
- *  Prunes 8-connected neighbors according to the direction of expansion of a give node
+ *  Computes straight jump point in direction of given direction
  *
- *  \param current Center node for which neighbors will be generated
+ *  \param current   Origin of computed jump point
+ *  \param targets   Target coordinates, because targets are special jump points
+ *  \param direction Vector pointing in straight direction: (1,0), (0,1), (-1,0) or (0,-1)
  *
- *  \return        Pruned neighbors of current
+ *  \return          Jump point of current, NO_JUMP_POINT if there is none
 **/
-std::list<cv::Vec2i> JPSAStar::prunedNeighbors(Node &current) const{
-    // Check for start node
-    if(current.parent == NULL){
-        return this->connected(current);
+template<class Movement>
+cv::Vec2i BasicSearcher<Movement>::straightJPS(cv::Vec2i current, const TargetSet &targets, const cv::Vec2i &direction) const{
+    if( !this->data_->grid.isFree(current[0], current[1]) )
+        return NO_JUMP_POINT;
+    // First pixel in direction which is occupied or has forced neighbors
+    cv::Vec2i stop = current;
+    cv::Vec2i target = current;
+    // First pixel which isn't uniform, the scan may stop earlier at corners of uniform regions
+    cv::Vec2i border = current;
+    const bool costs = !this->data_->costs.empty();
+    if(direction[0] != 0){
+        stop[0] = Movement::scanRow(this->data_->grid, current[0], current[1], direction[0]);
+        target[0] = targets.nextInRow(current[0], current[1], direction[0]);
+        if(costs)
+            border[0] = this->data_->uniform.scanRow(current[0], current[1], direction[0]);
         }
-    std::list<cv::Vec2i> pruned;
-    cv::Vec2i diff_vec = current.vector - current.parent->vector;
-    if(diff_vec[0] != 0) diff_vec[0] = diff_vec[0] / abs(diff_vec[0]);
-    if(diff_vec[1] != 0) diff_vec[1] = diff_vec[1] / abs(diff_vec[1]);
-    int x_nat = current.vector[0] + diff_vec[0];
-    int y_nat = current.vector[1] + diff_vec[1];
-    // Diagonal prune case
-    if(diff_vec[0] != 0 && diff_vec[1] != 0){
-        // Natural neighbors
-        if( 0 <= x_nat && x_nat < this->map_.cols && 0 < this->map_.at<uchar>(current.vector[1], x_nat) ){
-            pruned.push_back( cv::Vec2i(x_nat, current.vector[1]) );
-            }
-        if( 0 <= y_nat && y_nat < this->map_.rows && 0 < this->map_.at<uchar>(y_nat, current.vector[0]) ){
-            pruned.push_back( cv::Vec2i(current.vector[0], y_nat) );
-            }
-        if(   0 <= x_nat && x_nat < this->map_.cols
-           && 0 <= y_nat && y_nat < this->map_.rows
-           && 0 < this->map_.at<uchar>(y_nat, x_nat) ){
-            pruned.push_back( cv::Vec2i(x_nat, y_nat) );
-            }
-        // Forced neighbors
-        pruned.splice( pruned.end(), this->diagonalForced(current.vector, diff_vec) );
+    else{
+        stop[1] = Movement::scanColumn(this->data_->grid, current[0], current[1], direction[1]);
+        target[1] = targets.nextInColumn(current[0], current[1], direction[1]);
+        if(costs)
+            border[1] = this->data_->uniform.scanColumn(current[0], current[1], direction[1]);
         }
-    // Straight x prune case
-    else if(diff_vec[0] != 0){
-        // Natural neighbor
-        if( 0 <= x_nat && x_nat < this->map_.cols && 0 < this->map_.at<uchar>(current.vector[1], x_nat) ){
-            pruned.push_back( cv::Vec2i(x_nat, current.vector[1]) );
-            }
-        // Forced neighbors
-        pruned.splice( pruned.end(), this->straightForced(current.vector, diff_vec) );
+    // Check if a target is reached on the way
+    int to_target = (target[0] - current[0]) * direction[0] + (target[1] - current[1]) * direction[1];
+    int to_stop = (stop[0] - current[0]) * direction[0] + (stop[1] - current[1]) * direction[1];
+    int to_border = (border[0] - current[0]) * direction[0] + (border[1] - current[1]) * direction[1];
+    if(costs && to_border < to_stop){
+        stop = border;
+        to_stop = to_border;
+        }
+    JPSASTAR_STAT( this->stats_.scanned += to_stop + 1; )
+    this->scanned_ += to_stop + 1;
+    if(target[0] != -1 && target[1] != -1 && to_target < to_stop)
+        return target;
+    if( this->data_->grid.isFree(stop[0], stop[1]) ){
+        JPSASTAR_STAT( ++this->stats_.forced; )
+        return stop;
+        }
+    return NO_JUMP_POINT;
+    }
+
+
+/**
+ *  Looks up the jump point of a pixel in the precomputed jump distances
+ *
+ *  Gives the same result as jumpPoint, but in O(1) instead of scanning.
+ *  Targets are checked where they can be reached in a straight line.
+ *
+ *  \param origin    Pixel from which the jump starts, it is not checked itself
+ *  \param direction Unit vector of the jump direction
+ *  \param targets   Target coordinates, because targets are special jump points
+ *
+ *  \return          Jump point in direction, NO_JUMP_POINT if there is none
+**/
+template<class Movement>
+cv::Vec2i BasicSearcher<Movement>::tableJumpPoint(const cv::Vec2i &origin, const cv::Vec2i &direction, const TargetSet &targets) const{
+    cv::Vec2i current = origin + direction;
+    int distance = this->data_->jumps.distance( origin[1] * this->data_->grid.cols() + origin[0], JumpTable::direction(direction) );
+    JPSASTAR_STAT( ++this->stats_.scanned; )
+    ++this->scanned_;
+    bool diagonal = direction[0] != 0 && direction[1] != 0;
+    // Distance too long for the table, scan instead
+    if(distance == JumpTable::FAR)
+        return diagonal ? this->branchingJPS(current, targets, direction) : this->straightJPS(current, targets, direction);
+    // Number of free pixels in direction and steps to the jump point
+    int free_run = abs(distance);
+    int steps = 0 < distance ? distance : free_run + 1;
+    if(!diagonal){
+        cv::Vec2i target = current;
+        if(direction[0] != 0)
+            target[0] = targets.nextInRow(current[0], current[1], direction[0]);
+        else
+            target[1] = targets.nextInColumn(current[0], current[1], direction[1]);
+        int to_target = (target[0] - origin[0]) * direction[0] + (target[1] - origin[1]) * direction[1];
+        if(target[0] != -1 && target[1] != -1 && to_target <= free_run)
+            return target;
         }
-    // Straight y prune case
     else{
-        // Natural neighbor
-        if( 0 <= y_nat && y_nat < this->map_.rows && 0 < this->map_.at<uchar>(y_nat, current.vector[0]) ){
-            pruned.push_back( cv::Vec2i(current.vector[0], y_nat) );
+        // Targets are reachable straight from the pixel where the diagonal crosses their row or column
+        for(int y = targets.nextRow(origin[1], direction[1]); y != -1; y = targets.nextRow(y, direction[1])){
+            int to_row = (y - origin[1]) * direction[1];
+            if(steps <= to_row || free_run < to_row)
+                break;
+            cv::Vec2i crossing(origin[0] + to_row * direction[0], y);
+            cv::Vec2i jp = this->straightJPS(crossing, targets, cv::Vec2i(direction[0], 0));
+            if( jp != NO_JUMP_POINT && targets.contains(jp[0], jp[1]) ){
+                steps = to_row;
+                break;
+                }
+            }
+        for(int x = targets.nextColumn(origin[0], direction[0]); x != -1; x = targets.nextColumn(x, direction[0])){
+            int to_col = (x - origin[0]) * direction[0];
+            if(steps <= to_col || free_run < to_col)
+                break;
+            cv::Vec2i crossing(x, origin[1] + to_col * direction[1]);
+            cv::Vec2i jp = this->straightJPS(crossing, targets, cv::Vec2i(0, direction[1]));
+            if( jp != NO_JUMP_POINT && targets.contains(jp[0], jp[1]) ){
+                steps = to_col;
+                break;
+                }
             }
-        // Forced neighbors
-        pruned.splice( pruned.end(), this->straightForced(current.vector, diff_vec) );
         }
-    return pruned;
+    if(free_run < steps)
+        return NO_JUMP_POINT;
+    JPSASTAR_STAT( if(!diagonal) ++this->stats_.forced; )
+    return cv::Vec2i(origin[0] + steps * direction[0], origin[1] + steps * direction[1]);
     }
 
 
 /**
- *  Sets map used for path planning
+ *  Remembers an expanded pixel if it is the closest to the target so far
  *
- *  \param new_map Map used for path planning. Underlying cv::Mat data will not be dublicated.
+ *  Only done if partial paths are requested, the closest pixel is the end
+ *  of the partial path of a stopped query.
+ *
+ *  \param cell Cell index of the expanded pixel
+ *  \param vec  (x,y) of the expanded pixel
 **/
-void JPSAStar::setMap(cv::Mat new_map){
-    this->map_ = new_map;
+template<class Movement>
+void BasicSearcher<Movement>::trackClosest(int cell, const cv::Vec2i &vec){
+    if( !this->limits_.partial_path )
+        return;
+    float estimate = this->heuristic(vec);
+    if(estimate < this->closest_estimate_){
+        this->closest_ = cell;
+        this->closest_estimate_ = estimate;
+        }
     }
 
 
 /**
- *  Computes forced neighbors of straight expanded node
+ *  Updates the jump distances after a region of the searched map changed (JPS+)
  *
- *  \param current   Parent of computed neighbors
- *  \param direction Vector pointing in straight direction: (1,0), (0,1), (-1,0) or (0,-1)
+ *  A distance only depends on the next pixel in its direction and the
+ *  pixels around it. Distances of pixels next to the region are
+ *  recomputed, and every changed distance is propagated backwards along
+ *  its direction until a recomputed distance stays the same. Straight
+ *  directions come first, pixels whose straight jump point flag flipped
+ *  are rechecked by the diagonal directions. The grid has to be updated
+ *  already and distances must fit into 16 bit.
  *
- *  \return          Forced neighbors of current
+ *  \param jumps Jump distances of the map before the change
+ *  \param rect  Changed region, has to be on the map
 **/
-std::list<cv::Vec2i> JPSAStar::straightForced(const cv::Vec2i &current, const cv::Vec2i &direction) const{
-    std::list<cv::Vec2i> forced;
-    int x_forced, y_forced;
-    // Straight x forced search
-    if(direction[0] != 0){
-        x_forced = current[0] + direction[0];
-        if(0 <= x_forced && x_forced < this->map_.cols){
-            y_forced = current[1] - 1;
-            if(   -1 < y_forced
-               && this->map_.at<uchar>(y_forced, current[0]) == 0
-               && 0 < this->map_.at<uchar>(y_forced, x_forced) ){
-                forced.push_back( cv::Vec2i(x_forced, y_forced) );
-                }
-            y_forced = current[1] + 1;
-            if(   y_forced < this->map_.rows
-               && this->map_.at<uchar>(y_forced, current[0]) == 0
-               && 0 < this->map_.at<uchar>(y_forced, x_forced) ){
-                forced.push_back( cv::Vec2i(x_forced, y_forced) );
+template<class Movement>
+void BasicSearcher<Movement>::updateJumpTable(JumpTable &jumps, const cv::Rect &rect) const{
+    const BitGrid &grid = this->data_->grid;
+    const int cols = grid.cols();
+    // Pixels whose forced neighbor checks read a changed pixel
+    const int left = std::max(rect.x - 1, 0);
+    const int top = std::max(rect.y - 1, 0);
+    const int right = std::min(rect.x + rect.width + 1, cols);
+    const int bottom = std::min(rect.y + rect.height + 1, grid.rows());
+    // Pixels whose straight jump point flag flipped, per straight direction
+    std::vector<int> flipped[8];
+    std::vector<int> seeds;
+    static const int order[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    for(int i = 0; i < 8 ;++i){
+        const int dir = order[i];
+        const cv::Vec2i &direction = JumpTable::DIRECTIONS[dir];
+        const int dir_x = JumpTable::direction( cv::Vec2i(direction[0], 0) );
+        const int dir_y = JumpTable::direction( cv::Vec2i(0, direction[1]) );
+        seeds.clear();
+        for(int y = top; y < bottom ;++y){
+            for(int x = left; x < right ;++x){
+                if( grid.isInside(x - direction[0], y - direction[1]) )
+                    seeds.push_back( (y - direction[1]) * cols + x - direction[0] );
                 }
             }
-        }
-    // Straight y forced search
-    else{
-        y_forced = current[1] + direction[1];
-        if(0 <= y_forced && y_forced < this->map_.rows){
-            x_forced = current[0] - 1;
-            if(   -1 < x_forced
-               && this->map_.at<uchar>(current[1], x_forced) == 0
-               && 0 < this->map_.at<uchar>(y_forced, x_forced) ){
-                forced.push_back( cv::Vec2i(x_forced, y_forced) );
+        if(dir % 2 == 1){
+            for(int straight = 0; straight < 8 ;straight += 2){
+                if(straight != dir_x && straight != dir_y)
+                    continue;
+                for(size_t j = 0; j < flipped[straight].size() ;++j){
+                    int x = flipped[straight][j] % cols - direction[0];
+                    int y = flipped[straight][j] / cols - direction[1];
+                    if( grid.isInside(x, y) )
+                        seeds.push_back(y * cols + x);
+                    }
                 }
-            x_forced = current[0] + 1;
-            if(   x_forced < this->map_.cols
-               && this->map_.at<uchar>(current[1], x_forced) == 0
-               && 0 < this->map_.at<uchar>(y_forced, x_forced) ){
-                forced.push_back( cv::Vec2i(x_forced, y_forced) );
+            }
+        // Pixels closer to the end of the jump first, later seeds mostly stop at once
+        std::sort(seeds.begin(), seeds.end(), [cols, &direction](int a, int b){
+            return   (a % cols) * direction[0] + (a / cols) * direction[1]
+                   > (b % cols) * direction[0] + (b / cols) * direction[1]; });
+        for(size_t j = 0; j < seeds.size() ;++j){
+            cv::Vec2i current(seeds[j] % cols, seeds[j] / cols);
+            while( grid.isInside(current[0], current[1]) ){
+                cv::Vec2i next = current + direction;
+                int distance = 0;
+                if( grid.isFree(next[0], next[1]) ){
+                    const int next_cell = next[1] * cols + next[0];
+                    int straight_jp = 0;
+                    if(dir % 2 == 1){
+                        straight_jp |= 0 < jumps.distance(next_cell, dir_x) ? 1 << dir_x : 0;
+                        straight_jp |= 0 < jumps.distance(next_cell, dir_y) ? 1 << dir_y : 0;
+                        }
+                    if( this->isJumpPoint(next, dir, straight_jp) )
+                        distance = 1;
+                    else{
+                        int next_distance = jumps.distance(next_cell, dir);
+                        distance = 0 < next_distance ? next_distance + 1 : next_distance - 1;
+                        }
+                    }
+                const int cell = current[1] * cols + current[0];
+                const int previous = jumps.distance(cell, dir);
+                if(distance == previous)
+                    break;
+                jumps.setDistance(cell, dir, distance);
+                if( dir % 2 == 0 && (0 < distance) != (0 < previous) )
+                    flipped[dir].push_back(cell);
+                current -= direction;
                 }
             }
         }
-    return forced;
     }
 
 
+template class BasicSearcher<CornerCutting>;
+template class BasicSearcher<FourConnected>;
+template class BasicSearcher<NoCornerCutting>;
+
+
 /**
- *  Computes straight jump point in direction of given direction
+ *  Sets the targets, duplicates are removed
  *
- *  \param current   Origin of computed jump point
- *  \param target    Target coordinates, because the target is a special jump point
- *  \param direction Vector pointing in straight direction: (1,0), (0,1), (-1,0) or (0,-1)
+ *  \param targets (x,y) of the targets
+ *  \param count   Number of targets
+**/
+void TargetSet::assign(const cv::Vec2i *targets, size_t count){
+    this->by_row_.assign(targets, targets + count);
+    std::sort(this->by_row_.begin(), this->by_row_.end(), rowMajorLess);
+    this->by_row_.erase( std::unique(this->by_row_.begin(), this->by_row_.end()), this->by_row_.end() );
+    this->by_column_ = this->by_row_;
+    std::sort(this->by_column_.begin(), this->by_column_.end(), columnMajorLess);
+    }
+
+
+/**
+ *  Checks if a pixel is a target
+ *
+ *  \param x Column of the pixel
+ *  \param y Row of the pixel
  *
- *  \return          Jump point of current
+ *  \return  True if (x,y) is a target
 **/
-cv::Vec2i* JPSAStar::straightJPS(cv::Vec2i current, const cv::Vec2i &target, const cv::Vec2i &direction) const{
-    if(direction[0] != 0){
-        // While in range and not occupied
-        while( 0 < current[0] && current[0] < this->map_.cols && 0 < this->map_.at<uchar>(current[1], current[0]) ){
-            // Check if target reached
-            if(current[0] == target[0] && current[1] == target[1])
-                return new cv::Vec2i(current);
-            // Check for straight forced neighbors
-            if( !this->straightForced(current, direction).empty() )
-                return new cv::Vec2i(current);
-            current[0] += direction[0];
-            }
+bool TargetSet::contains(int x, int y) const{
+    return std::binary_search(this->by_row_.begin(), this->by_row_.end(), cv::Vec2i(x, y), rowMajorLess);
+    }
+
+
+/**
+ *  Finds the next column containing a target
+ *
+ *  \param x    Column to start from, it is not checked itself
+ *  \param step Search direction, 1 or -1
+ *
+ *  \return     Closest column with a target in step direction, -1 if there is none
+**/
+int TargetSet::nextColumn(int x, int step) const{
+    std::vector<cv::Vec2i>::const_iterator it;
+    if(0 < step){
+        it = std::upper_bound(this->by_column_.begin(), this->by_column_.end(),
+                              cv::Vec2i(x, std::numeric_limits<int>::max()), columnMajorLess);
+        return it != this->by_column_.end() ? (*it)[0] : -1;
         }
-    else{
-        // While in range and not occupied
-        while( 0 < current[1] && current[1] < this->map_.rows && 0 < this->map_.at<uchar>(current[1], current[0]) ){
-            // Check if target reached
-            if(current[0] == target[0] && current[1] == target[1])
-                return new cv::Vec2i(current);
-            // Check for straight forced neighbors
-            if( !this->straightForced(current, direction).empty() )
-                return new cv::Vec2i(current);
-            current[1] += direction[1];
-            }
-        }
-    return NULL;
+    it = std::lower_bound(this->by_column_.begin(), this->by_column_.end(),
+                          cv::Vec2i(x, std::numeric_limits<int>::min()), columnMajorLess);
+    return it != this->by_column_.begin() ? (*(it - 1))[0] : -1;
+    }
+
+
+/**
+ *  Finds the next target in a column
+ *
+ *  \param x    Column which is searched
+ *  \param y    Row to start from, it is checked itself
+ *  \param step Search direction, 1 or -1
+ *
+ *  \return     Row of the closest target in step direction, -1 if there is none
+**/
+int TargetSet::nextInColumn(int x, int y, int step) const{
+    std::vector<cv::Vec2i>::const_iterator it;
+    if(0 < step){
+        it = std::lower_bound(this->by_column_.begin(), this->by_column_.end(), cv::Vec2i(x, y), columnMajorLess);
+        return it != this->by_column_.end() && (*it)[0] == x ? (*it)[1] : -1;
+        }
+    it = std::upper_bound(this->by_column_.begin(), this->by_column_.end(), cv::Vec2i(x, y), columnMajorLess);
+    return it != this->by_column_.begin() && (*(it - 1))[0] == x ? (*(it - 1))[1] : -1;
+    }
+
+
+/**
+ *  Finds the next target in a row
+ *
+ *  \param x    Column to start from, it is checked itself
+ *  \param y    Row which is searched
+ *  \param step Search direction, 1 or -1
+ *
+ *  \return     Column of the closest target in step direction, -1 if there is none
+**/
+int TargetSet::nextInRow(int x, int y, int step) const{
+    std::vector<cv::Vec2i>::const_iterator it;
+    if(0 < step){
+        it = std::lower_bound(this->by_row_.begin(), this->by_row_.end(), cv::Vec2i(x, y), rowMajorLess);
+        return it != this->by_row_.end() && (*it)[1] == y ? (*it)[0] : -1;
+        }
+    it = std::upper_bound(this->by_row_.begin(), this->by_row_.end(), cv::Vec2i(x, y), rowMajorLess);
+    return it != this->by_row_.begin() && (*(it - 1))[1] == y ? (*(it - 1))[0] : -1;
+    }
+
+
+/**
+ *  Finds the next row containing a target
+ *
+ *  \param y    Row to start from, it is not checked itself
+ *  \param step Search direction, 1 or -1
+ *
+ *  \return     Closest row with a target in step direction, -1 if there is none
+**/
+int TargetSet::nextRow(int y, int step) const{
+    std::vector<cv::Vec2i>::const_iterator it;
+    if(0 < step){
+        it = std::upper_bound(this->by_row_.begin(), this->by_row_.end(),
+                              cv::Vec2i(std::numeric_limits<int>::max(), y), rowMajorLess);
+        return it != this->by_row_.end() ? (*it)[1] : -1;
+        }
+    it = std::lower_bound(this->by_row_.begin(), this->by_row_.end(),
+                          cv::Vec2i(std::numeric_limits<int>::min(), y), rowMajorLess);
+    return it != this->by_row_.begin() ? (*(it - 1))[1] : -1;
     }
@@ -18,16 +18,39 @@
 #ifndef JPSASTAR_HPP_NBO2KO09
 #define JPSASTAR_HPP_NBO2KO09
 
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <stdint.h>
 #include <stdexcept>
 #include <functional>
+#include <istream>
 #include <set>
+#include <limits>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <algorithm>
 #include <opencv2/opencv.hpp>
 
+/**
+ *  Wraps statements which fill SearchStats
+ *
+ *  Define JPSASTAR_NO_STATS to compile all counting, timing and tracing
+ *  out of the search.
+**/
+#ifndef JPSASTAR_NO_STATS
+#define JPSASTAR_STAT(...) __VA_ARGS__
+#else
+#define JPSASTAR_STAT(...)
+#endif
+
 namespace jpsastar{
     /** \mainpage JPSAStar-Project Documentation
      *  \section sec_over Overview
@@ -42,6 +65,12 @@ namespace jpsastar{
      *      your build setup and you are ready to go.
     **/
 
+    /**
+     *  Returned by the jump point functions if there is no jump point
+    **/
+    const cv::Vec2i NO_JUMP_POINT(-1, -1);
+
+
     /**
      *  A* node containing parent, g value, f value and pixel position
     **/
@@ -64,41 +93,1082 @@ namespace jpsastar{
         };
 
 
+    /**
+     *  Bit-packed occupancy grid
+     *
+     *  Every row of the map is stored as 64 bit words with one bit per
+     *  pixel, set if the pixel is free. A transposed copy stores the
+     *  columns the same way. Rows and columns are padded with occupied
+     *  pixels on all sides, so pixels outside the map read as occupied.
+     *  This allows straight jumps to skip over up to 64 pixels at once as
+     *  in block-based jump point search. Rows are packed from the map 16
+     *  or 32 pixels at a time with SSE2 or AVX2 where available, columns
+     *  are transposed from the rows in blocks of 64x64 bits.
+     *  The words either belong to the grid or are attached from a mapped
+     *  file. Copies and updates always own their words.
+    **/
+    class BitGrid{
+        public:
+        BitGrid() : cols_(0), rows_(0), row_words_(0), col_words_(0), row_bits_(NULL), col_bits_(NULL){};
+        BitGrid(const BitGrid &other);
+        explicit BitGrid(const cv::Mat &map) : row_bits_(NULL), col_bits_(NULL){ this->assign(map); };
+        void assign(const cv::Mat &map);
+        void attach(int cols, int rows, const uint64_t *words, const std::shared_ptr<const void> &owner);
+        int cols() const{ return this->cols_; };
+        uint64_t hash() const;
+        bool isFree(int x, int y) const{
+            return this->isInside(x, y) && ((this->row(y)[(x >> 6) + 1] >> (x & 63)) & 1);
+            };
+        bool isInside(int x, int y) const{ return 0 <= x && x < this->cols_ && 0 <= y && y < this->rows_; };
+        bool lineOfSight(const cv::Vec2i &from, const cv::Vec2i &to, bool corners) const;
+        BitGrid& operator=(const BitGrid &other);
+        int rows() const{ return this->rows_; };
+        int scanColumn(int x, int y, int step) const;
+        int scanColumnPastCorners(int x, int y, int step) const;
+        int scanRow(int x, int y, int step) const;
+        int scanRowPastCorners(int x, int y, int step) const;
+        void set(int x, int y, bool free);
+        void update(const cv::Mat &map, const cv::Rect &rect);
+        static size_t words(int cols, int rows);
+        void write(std::ostream &out) const;
+
+        private:
+        const uint64_t* column(int x) const{ return &this->col_bits_[1 + (x + 1) * this->col_words_]; };
+        static bool isSpanFree(const uint64_t *line, int begin, int end);
+        void own();
+        const uint64_t* row(int y) const{ return &this->row_bits_[1 + (y + 1) * this->row_words_]; };
+        template<bool CORNER_CUTTING>
+        static int scanBackward(const uint64_t *line, const uint64_t *side_a, const uint64_t *side_b, int from);
+        template<bool CORNER_CUTTING>
+        static int scanForward(const uint64_t *line, const uint64_t *side_a, const uint64_t *side_b, int from);
+        void updateColumns(const cv::Rect &rect);
+
+        int cols_;                           ///< Number of map columns
+        int rows_;                           ///< Number of map rows
+        int row_words_;                      ///< Words per padded row
+        int col_words_;                      ///< Words per padded column
+        std::vector<uint64_t> words_;        ///< Padded rows followed by padded columns if owned by the grid
+        const uint64_t *row_bits_;           ///< Padded rows, one bit per pixel
+        const uint64_t *col_bits_;           ///< Padded columns, one bit per pixel, follow the rows
+        std::shared_ptr<const void> owner_;  ///< Keeps attached words alive, empty if words_ is used
+        };
+
+
+    /**
+     *  Precomputed jump distances of every pixel in all 8 directions (JPS+)
+     *
+     *  A positive distance d means that the next jump point in a direction
+     *  is d pixels away. Otherwise -d free pixels follow until an occupied
+     *  pixel or the map border is reached. Distances are stored as 16 bit
+     *  values, longer ones are stored as FAR and have to be scanned.
+     *  Tables attached to a mapped file are read-only, setDistance needs a
+     *  table created by assign or a copy.
+    **/
+    class JumpTable{
+        public:
+        JumpTable() : distances_(NULL), cells_(0){};
+        JumpTable(const JumpTable &other);
+        void assign(int cols, int rows);
+        void attach(const int16_t *distances, size_t cells, const std::shared_ptr<const void> &owner);
+        size_t cells() const{ return this->cells_; };
+        void clear();
+        static int direction(const cv::Vec2i &vec);
+        int distance(int cell, int direction) const{ return this->distances_[size_t(cell) * 8 + direction]; };
+        bool empty() const{ return this->cells_ == 0; };
+        JumpTable& operator=(const JumpTable &other);
+        void setDistance(int cell, int direction, int distance){
+            this->owned_[size_t(cell) * 8 + direction] = abs(distance) < FAR_LIMIT ? distance : FAR;
+            };
+        void write(std::ostream &out) const;
+
+        static const int FAR = -32768;      ///< Stored if the distance does not fit into 16 bit
+        static const int FAR_LIMIT = 32768; ///< Absolute distances from here on are stored as FAR
+        static const cv::Vec2i DIRECTIONS[8]; ///< Direction vectors, straight ones have even indices
+
+        private:
+        std::vector<int16_t> owned_;        ///< Distances if owned by the table
+        const int16_t *distances_;          ///< 8 distances per cell, indexed by cell * 8 + direction
+        size_t cells_;                      ///< Number of cells
+        std::shared_ptr<const void> owner_; ///< Keeps attached distances alive, empty if owned_ is used
+        };
+
+
+    /**
+     *  Labels of the 8-connected components of the free pixels
+     *
+     *  Free pixels are connected like the moves of the search, so a path
+     *  between two free pixels exists if they have the same label.
+     *  Every pixel stores a raw label, 0 if it is occupied. Raw labels are
+     *  merged by a union-find forest whose roots are the labels of the
+     *  components. Map changes relabel only the pixels around a changed
+     *  region and the pixels of components split off by it, found by
+     *  searches from all sides of the region that stop once at most one
+     *  side is left unexplored. Labels attached from a mapped file are
+     *  roots, changes copy them first.
+    **/
+    class ComponentLabels{
+        public:
+        ComponentLabels() : labels_(NULL), cols_(0), cells_(0){};
+        ComponentLabels(const ComponentLabels &other);
+        void assign(const BitGrid &grid);
+        void attach(int cols, int rows, const uint32_t *labels, const std::shared_ptr<const void> &owner);
+        size_t cells() const{ return this->cells_; };
+        bool empty() const{ return this->cells_ == 0; };
+        uint32_t label(int x, int y) const{
+            uint32_t label = this->labels_[size_t(y) * this->cols_ + x];
+            if( !this->parents_.empty() )
+                while(this->parents_[label] != label)
+                    label = this->parents_[label];
+            return label;
+            };
+        ComponentLabels& operator=(const ComponentLabels &other);
+        void update(const BitGrid &grid, const cv::Rect &rect);
+        void write(std::ostream &out) const;
+
+        private:
+        uint32_t find(uint32_t label);
+        uint32_t newLabel();
+        void own();
+        void split(const BitGrid &grid, uint32_t root, std::vector< std::vector<int> > &queues);
+        uint32_t unite(uint32_t a, uint32_t b);
+
+        std::vector<uint32_t> owned_;       ///< Raw labels if owned by the object
+        const uint32_t *labels_;            ///< Raw label of each pixel in row-major order, 0 if occupied
+        int cols_;                          ///< Number of map columns
+        size_t cells_;                      ///< Number of pixels
+        std::vector<uint32_t> parents_;     ///< Parent of each raw label, roots are their own parent, empty if all labels are roots
+        std::vector<uint8_t> ranks_;        ///< Upper bound of the tree height of each root
+        std::shared_ptr<const void> owner_; ///< Keeps attached labels alive, empty if owned_ is used
+        };
+
+
+    struct MapData;
+
+
+    /**
+     *  Distances from a few landmark pixels to every pixel for the ALT heuristic
+     *
+     *  Implements the landmark heuristic of "Computing the Shortest Path:
+     *  A* Search Meets Graph Theory" by Andrew V. Goldberg and Chris
+     *  Harrelson. By the triangle inequality |d(L,a) - d(L,b)| is a lower
+     *  bound of d(a,b) for every landmark L, which follows walls and dead
+     *  ends the Euclidean distance knows nothing about. Landmarks are picked
+     *  farthest-point first in the largest component. Distances are those
+     *  of corner cutting moves with the costs of the map, so they bound the
+     *  distances of every movement model. Distances are stored in 16 bit
+     *  as multiples of a scale per landmark. Every step is rounded down to
+     *  the scale instead of the whole distance, so the stored distances are
+     *  the exact shortest distances of the rounded steps. They bound the
+     *  costs without leaving out a scale, and repair lowers them exactly
+     *  when pixels are freed. The distances of a pixel are stored next to
+     *  each other, so up to 32 landmarks are read with one cache line.
+    **/
+    class LandmarkTable{
+        public:
+        LandmarkTable() : distances_(NULL), cells_(0){};
+        LandmarkTable(const LandmarkTable &other);
+        void assign(const MapData &data, int count);
+        void attach(const char *landmarks,
+                    int count,
+                    const uint16_t *distances,
+                    size_t cells,
+                    const std::shared_ptr<const void> &owner);
+        size_t cells() const{ return this->cells_; };
+        void copyCells(const LandmarkTable &other, const std::vector<int> &cells);
+        int count() const{ return this->landmarks_.size(); };
+        const std::vector<int>& landmarks() const{ return this->landmarks_; };
+        /**
+         *  Lower bound of the costs between two pixels
+         *
+         *  \param a Cell index of the first pixel
+         *  \param b Cell index of the second pixel
+         *
+         *  \return  Largest bound of all landmarks which reach both pixels, 0 if there is none
+        **/
+        float lowerBound(int a, int b) const{
+            const size_t count = this->landmarks_.size();
+            const uint16_t *from = this->distances_ + a * count;
+            const uint16_t *to = this->distances_ + b * count;
+            float bound = 0.0f;
+            for(size_t i = 0; i < count ;++i){
+                const int steps = std::abs( int(from[i]) - int(to[i]) );
+                if(0 < steps && from[i] != UNREACHABLE && to[i] != UNREACHABLE)
+                    bound = std::max( bound, steps * this->scales_[i] );
+                }
+            return bound;
+            };
+        LandmarkTable& operator=(const LandmarkTable &other);
+        void repair(const MapData &data, const BitGrid &before, const cv::Rect &rect, std::vector<int> &changed);
+        void write(std::ostream &out) const;
+        void writeLandmarks(std::ostream &out) const;
+
+        static const uint16_t UNREACHABLE = 0xffff; ///< Stored for occupied pixels and pixels in other components
+
+        private:
+        void fill(const MapData &data, size_t landmark);
+        void spread(const MapData &data, size_t landmark, std::vector< std::pair<uint16_t, int> > &seeds, std::vector<int> *changed);
+
+        std::vector<int> landmarks_;        ///< Cell index of each landmark
+        std::vector<float> scales_;         ///< Costs of one unit of the stored distances of each landmark
+        std::vector<uint16_t> owned_;       ///< Distances if owned by the table
+        const uint16_t *distances_;         ///< Distances of all landmarks per cell, indexed by cell * count + landmark
+        size_t cells_;                      ///< Number of cells
+        std::shared_ptr<const void> owner_; ///< Keeps attached distances alive, empty if owned_ is used
+        };
+
+
+    /**
+     *  Fixed capacity list of neighbor pixels
+     *
+     *  A pixel has at most 8 neighbors, so the list lives on the stack and
+     *  never allocates memory.
+    **/
+    class Neighbors{
+        public:
+        Neighbors() : size_(0){};
+        const cv::Vec2i* begin() const{ return this->data_; };
+        bool empty() const{ return this->size_ == 0; };
+        const cv::Vec2i* end() const{ return this->data_ + this->size_; };
+        void push_back(const cv::Vec2i &vec){ this->data_[this->size_++] = vec; };
+        size_t size() const{ return this->size_; };
+
+        private:
+        cv::Vec2i data_[8]; ///< Neighbor pixels, only the first size_ are valid
+        int size_;          ///< Number of neighbors
+        };
+
+
+    /**
+     *  Per-cell A* state stored in a SearchArena
+     *
+     *  The f value is only needed while a cell is open and therefore kept
+     *  in the open list of the arena.
+    **/
+    struct CellState{
+        float g_value;       ///< G score representing the cost from the start point to the cell
+        int parent;          ///< Cell index from which this cell can be reached, -1 for the start cell
+        int heap_index;      ///< Position in the open list, OPEN_NONE or OPEN_CLOSED if not open
+        unsigned generation; ///< Query in which this state was written, older states are invalid
+
+        static const int OPEN_NONE = -1;   ///< Cell was not reached yet
+        static const int OPEN_CLOSED = -2; ///< Cell was already expanded
+        };
+
+
+    /**
+     *  Reusable per-cell search state with an indexed binary min heap as open list
+     *
+     *  States are stored densely and indexed by y * cols + x. Each query
+     *  increments a generation counter, so all states of the previous query
+     *  are invalidated in O(1). Cells are ordered in the open list by their
+     *  f value and every state knows its heap position, which makes
+     *  membership tests O(1) and decrease-key O(log n). Once the arena has
+     *  grown to the map size, queries do not allocate memory.
+    **/
+    class SearchArena{
+        public:
+        SearchArena() : generation_(0){};
+        CellState& cell(int cell){
+            CellState &state = this->cells_[cell];
+            if(state.generation != this->generation_){
+                state.g_value = std::numeric_limits<float>::infinity();
+                state.parent = -1;
+                state.heap_index = CellState::OPEN_NONE;
+                state.generation = this->generation_;
+                }
+            return state;
+            };
+        bool empty() const{ return this->heap_.empty(); };
+        bool isClosed(int cell) const{
+            return    this->cells_[cell].generation == this->generation_
+                   && this->cells_[cell].heap_index == CellState::OPEN_CLOSED; };
+        bool isOpen(int cell) const{
+            return this->cells_[cell].generation == this->generation_ && 0 <= this->cells_[cell].heap_index; };
+        /**
+         *  Smallest value of a functor over all open cells
+         *
+         *  \param value Functor returning the value of a cell index
+         *
+         *  \return      Smallest value, infinity if no cell is open
+        **/
+        template<typename Value>
+        float lowest(Value value) const{
+            float result = std::numeric_limits<float>::infinity();
+            for(size_t i = 0; i < this->heap_.size() ;++i)
+                result = std::min( result, value(this->heap_[i].cell) );
+            return result;
+            };
+        int pop();
+        void push(int cell, float f_value);
+        /**
+         *  Recomputes the f values of all open cells and restores the heap
+         *
+         *  \param f_value Functor returning the new f value of a cell index
+        **/
+        template<typename FValue>
+        void rekey(FValue f_value){
+            for(size_t i = 0; i < this->heap_.size() ;++i)
+                this->heap_[i].f_value = f_value(this->heap_[i].cell);
+            for(size_t i = this->heap_.size() / 2; 0 < i ;--i)
+                this->siftDown(i - 1);
+            };
+        void reset(int cells);
+        size_t size() const{ return this->heap_.size(); };
+        float topValue() const{ return this->heap_.front().f_value; };
+        void update(int cell, float f_value);
+
+        private:
+        /**
+         *  Open list entry caching the f value of its cell
+        **/
+        struct Entry{
+            float f_value; ///< F score representing the heuristic enhanced costs from start to target
+            int cell;      ///< Map cell index
+            };
+
+        void siftDown(size_t pos);
+        void siftUp(size_t pos);
+
+        std::vector<CellState> cells_; ///< Search state of each map cell
+        std::vector<Entry> heap_;      ///< Binary heap of open cells
+        unsigned generation_;          ///< Generation of the current query
+        };
+
+
+    /**
+     *  Work counters and timings of the last query of a Searcher
+     *
+     *  All fields stay 0 if the library is compiled with JPSASTAR_NO_STATS.
+    **/
+    struct SearchStats{
+        SearchStats() : pushed(0), updated(0), popped(0), open_peak(0), jumps(0), scanned(0), forced(0),
+                        sight_checks(0), setup_ns(0), search_ns(0), path_ns(0){};
+
+        size_t pushed;       ///< Nodes added to the open list
+        size_t updated;      ///< Open nodes whose costs were lowered
+        size_t popped;       ///< Nodes taken from the open list and expanded
+        size_t open_peak;    ///< Largest size of the open list
+        size_t jumps;        ///< Calls of jumpPoint
+        size_t scanned;      ///< Pixels passed by jump point scans and jump table lookups
+        size_t forced;       ///< Jump points found because of forced neighbors
+        size_t sight_checks; ///< Line of sight checks of path smoothing and any-angle search
+        int64_t setup_ns;    ///< Time spent resetting the search state
+        int64_t search_ns;   ///< Time spent in the open list loop
+        int64_t path_ns;     ///< Time spent building paths from parent links
+        };
+
+
+    /**
+     *  Limits of the queries of a Searcher
+     *
+     *  A query stops once any limit is reached and Searcher::stopped tells
+     *  which one. The default values disable all limits. Limits are checked
+     *  before every expansion, jump scans check them every CHECK_INTERVAL
+     *  pixels, so a stopped query returns within one expansion.
+    **/
+    struct SearchLimits{
+        SearchLimits() : deadline(std::chrono::steady_clock::time_point::max()), max_popped(0), max_scanned(0),
+                         cancel(NULL), partial_path(false){};
+
+        static const int NONE = 0;                 ///< The query was not stopped
+        static const int DEADLINE = 1;             ///< The deadline passed
+        static const int POPPED = 2;               ///< max_popped nodes were expanded
+        static const int SCANNED = 3;              ///< max_scanned pixels were scanned
+        static const int CANCELLED = 4;            ///< The cancellation flag was set
+        static const size_t CHECK_INTERVAL = 1024; ///< Scanned pixels between two checks within jump scans
+
+        std::chrono::steady_clock::time_point deadline; ///< Time after which the query stops
+        size_t max_popped;                              ///< Expanded nodes after which the query stops, 0 for no limit
+        size_t max_scanned;                             ///< Scanned pixels after which the query stops, 0 for no limit
+        const std::atomic<bool> *cancel;                ///< The query stops once the flag is set, NULL for none
+        bool partial_path;                              ///< A stopped findPath returns the path to the expanded pixel closest to the target
+        };
+
+
+    /**
+     *  Callback invoked for every expanded node
+     *
+     *  Receives the expanded pixel, its parent (NO_JUMP_POINT for the
+     *  start) and its costs from the start.
+    **/
+    typedef std::function<void(const cv::Vec2i &node, const cv::Vec2i &parent, float g_value)> TraceCallback;
+
+
+    /**
+     *  Immutable snapshot of a map and all data derived from it
+     *
+     *  A new snapshot is created on every map change. Searchers keep the
+     *  snapshot they started a query with, so a map can be replaced while
+     *  queries are running.
+    **/
+    struct MapData{
+        MapData() : version(0){};
+
+        cv::Mat map;                                    ///< Image used to calcutale the path, must be 8-Bit grey scale
+        BitGrid grid;                                   ///< Bit-packed occupancy of map used by the search
+        JumpTable jumps;                                ///< Jump distances of grid, empty if not preprocessed
+        ComponentLabels components;                     ///< Connected components of grid
+        cv::Mat costs;                                  ///< 32 bit float costs of crossing each pixel, empty if all pixels cost 1
+        BitGrid uniform;                                ///< Free pixels whose free neighbors have the same costs, empty without costs
+        uint64_t version;                               ///< Number of snapshots published by the engine before this one
+        std::shared_ptr<const void> file;               ///< Mapped file the map and the costs point into, empty if they own their pixels
+        std::shared_ptr<const LandmarkTable> landmarks; ///< Landmark distances of the ALT heuristic, NULL if not built
+        };
+
+
+    /**
+     *  Start and target of one query of a batch
+    **/
+    struct PathQuery{
+        PathQuery(){};
+        PathQuery(const cv::Vec2i &start, const cv::Vec2i &target) : start(start), target(target){};
+
+        cv::Vec2i start;  ///< (x,y) of the start point in map coordinates
+        cv::Vec2i target; ///< (x,y) of the target point in map coordinates
+        };
+
+
+    /**
+     *  Paths of a batch of queries stored in one contiguous buffer
+     *
+     *  The path of query i are the waypoints from offsets[i] to
+     *  offsets[i+1], ordered like the result of findPath. The path is empty
+     *  if no path was found or start or target isn't on the map.
+    **/
+    struct PathBatch{
+        const cv::Vec2i* begin(size_t query) const{ return this->waypoints.data() + this->offsets[query]; };
+        bool empty(size_t query) const{ return this->offsets[query] == this->offsets[query + 1]; };
+        const cv::Vec2i* end(size_t query) const{ return this->waypoints.data() + this->offsets[query + 1]; };
+        size_t size() const{ return this->offsets.empty() ? 0 : this->offsets.size() - 1; };
+
+        std::vector<size_t> offsets;      ///< First waypoint of each path, the extra last entry marks the end
+        std::vector<cv::Vec2i> waypoints; ///< Waypoints of all paths
+        };
+
+
+    /**
+     *  Set of target pixels of a query
+     *
+     *  Targets are kept sorted by rows and by columns, so the jump point
+     *  search finds the next target on a line in O(log k) for k targets.
+    **/
+    class TargetSet{
+        public:
+        void assign(const cv::Vec2i *targets, size_t count);
+        bool contains(int x, int y) const;
+        const std::vector<cv::Vec2i>& targets() const{ return this->by_row_; };
+        int nextColumn(int x, int step) const;
+        int nextInColumn(int x, int y, int step) const;
+        int nextInRow(int x, int y, int step) const;
+        int nextRow(int y, int step) const;
+        size_t size() const{ return this->by_row_.size(); };
+
+        private:
+        std::vector<cv::Vec2i> by_row_;    ///< Targets sorted by y, then x, without duplicates
+        std::vector<cv::Vec2i> by_column_; ///< Targets sorted by x, then y, without duplicates
+        };
+
+
+    /**
+     *  Movement model of 8-connected searches which may cut corners of obstacles
+     *
+     *  A diagonal step only needs a free destination pixel. Straight steps
+     *  cost 1 and diagonal steps sqrt(2) (octile). This is the model of
+     *  JPSAStar and the only one using precomputed jump distances (JPS+).
+     *  Movement models are passed to BasicSearcher as template parameter,
+     *  so the jump loops are compiled for each model.
+    **/
+    struct CornerCutting{
+        static const bool JUMP_TABLE = true; ///< Jumps may use the jump distances of the map
+
+        static void branches(const cv::Vec2i &direction, cv::Vec2i &first, cv::Vec2i &second){
+            first = cv::Vec2i(direction[0], 0);
+            second = cv::Vec2i(0, direction[1]);
+            };
+        static bool canStep(const BitGrid&, const cv::Vec2i&, const cv::Vec2i&){ return true; };
+        static float estimate(const cv::Vec2i &a, const cv::Vec2i &b){
+            return sqrt( pow(a[0] - b[0], 2) + pow(a[1] - b[1], 2) ); };
+        static bool hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction);
+        static bool isBranching(const cv::Vec2i &direction){ return direction[0] != 0 && direction[1] != 0; };
+        static bool lineOfSight(const BitGrid &grid, const cv::Vec2i &from, const cv::Vec2i &to){
+            return grid.lineOfSight(from, to, false); };
+        static void prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned);
+        static int scanColumn(const BitGrid &grid, int x, int y, int step){ return grid.scanColumn(x, y, step); };
+        static int scanRow(const BitGrid &grid, int x, int y, int step){ return grid.scanRow(x, y, step); };
+        };
+
+
+    /**
+     *  Movement model of 8-connected searches which must not cut corners of obstacles
+     *
+     *  A diagonal step needs both pixels next to it to be free. Straight
+     *  steps cost 1 and diagonal steps sqrt(2).
+    **/
+    struct NoCornerCutting{
+        static const bool JUMP_TABLE = false; ///< Jumps may use the jump distances of the map
+
+        static void branches(const cv::Vec2i &direction, cv::Vec2i &first, cv::Vec2i &second){
+            first = cv::Vec2i(direction[0], 0);
+            second = cv::Vec2i(0, direction[1]);
+            };
+        static bool canStep(const BitGrid &grid, const cv::Vec2i &from, const cv::Vec2i &direction){
+            return    direction[0] == 0 || direction[1] == 0
+                   || (grid.isFree(from[0] + direction[0], from[1]) && grid.isFree(from[0], from[1] + direction[1])); };
+        static float estimate(const cv::Vec2i &a, const cv::Vec2i &b){
+            return sqrt( pow(a[0] - b[0], 2) + pow(a[1] - b[1], 2) ); };
+        static bool hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction);
+        static bool isBranching(const cv::Vec2i &direction){ return direction[0] != 0 && direction[1] != 0; };
+        static bool lineOfSight(const BitGrid &grid, const cv::Vec2i &from, const cv::Vec2i &to){
+            return grid.lineOfSight(from, to, true); };
+        static void prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned);
+        static int scanColumn(const BitGrid &grid, int x, int y, int step){ return grid.scanColumnPastCorners(x, y, step); };
+        static int scanRow(const BitGrid &grid, int x, int y, int step){ return grid.scanRowPastCorners(x, y, step); };
+        };
+
+
+    /**
+     *  Movement model of 4-connected searches
+     *
+     *  Only straight steps of costs 1 are allowed. Shortest paths are
+     *  canonical if they move horizontally first, so horizontal jumps
+     *  branch into vertical ones like diagonal jumps of 8-connected models.
+    **/
+    struct FourConnected{
+        static const bool JUMP_TABLE = false; ///< Jumps may use the jump distances of the map
+
+        static void branches(const cv::Vec2i&, cv::Vec2i &first, cv::Vec2i &second){
+            first = cv::Vec2i(0, 1);
+            second = cv::Vec2i(0, -1);
+            };
+        static bool canStep(const BitGrid&, const cv::Vec2i&, const cv::Vec2i &direction){
+            return direction[0] == 0 || direction[1] == 0; };
+        static float estimate(const cv::Vec2i &a, const cv::Vec2i &b){
+            return abs(a[0] - b[0]) + abs(a[1] - b[1]); };
+        static bool hasForced(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction);
+        static bool isBranching(const cv::Vec2i &direction){ return direction[0] != 0; };
+        static bool lineOfSight(const BitGrid &grid, const cv::Vec2i &from, const cv::Vec2i &to){
+            return (from[0] == to[0] || from[1] == to[1]) && grid.lineOfSight(from, to, false); };
+        static void prune(const BitGrid &grid, const cv::Vec2i &current, const cv::Vec2i &direction, Neighbors &pruned);
+        static int scanColumn(const BitGrid &grid, int x, int y, int step){ return grid.scanColumnPastCorners(x, y, step); };
+        static int scanRow(const BitGrid &grid, int x, int y, int step){ return grid.scanRowPastCorners(x, y, step); };
+        };
+
+
+    class JPSAStar;
+
+
+    /**
+     *  Query context running jump point search A* on the map of a JPSAStar engine
+     *
+     *  Holds the scratch space of the search, so a searcher must only be
+     *  used by one thread at a time. Any number of searchers can run
+     *  queries on the same engine concurrently, also while its map is
+     *  replaced. Each query uses the map snapshot that is current when the
+     *  query starts.
+     *  The movement model is one of CornerCutting, NoCornerCutting and
+     *  FourConnected. Searcher is the searcher of the CornerCutting model
+     *  used by JPSAStar. Reachability checks use the 8-connected component
+     *  labels of the map, other models may still fail to find a path.
+     *  Paths consist of straight and diagonal lines between jump points.
+     *  With smoothing, waypoints which the previous waypoint can see past
+     *  are removed. The any-angle mode runs Lazy Theta* instead, whose
+     *  lines may run in any direction. Both keep paths on maps with costs
+     *  as they are, since an any-angle line would cross pixels of other
+     *  costs than the path was optimised for.
+     *  A heuristic weight above 1 trades path costs for speed. The anytime
+     *  query starts with it and lowers it while time is left.
+     *  SearchLimits bound the time and work of a query and let other
+     *  threads cancel it.
+    **/
+    template<class Movement>
+    class BasicSearcher{
+        public:
+        explicit BasicSearcher(const JPSAStar &engine);
+        bool anyAngle() const{ return this->any_angle_; };
+        bool bidirectional() const{ return this->bidirectional_; };
+        std::list<cv::Vec2i> findPath(cv::Vec2i start, cv::Vec2i target);
+        bool findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path);
+        bool findPathAnytime(const cv::Vec2i &start,
+                             const cv::Vec2i &target,
+                             std::vector<cv::Vec2i> &path,
+                             float &bound,
+                             const std::chrono::steady_clock::time_point &deadline,
+                             size_t max_popped = 0);
+        size_t findPaths(const cv::Vec2i &start,
+                         const std::vector<cv::Vec2i> &targets,
+                         PathBatch &batch,
+                         size_t limit = 0);
+        void setAnyAngle(bool enabled){ this->any_angle_ = enabled; };
+        const SearchLimits& limits() const{ return this->limits_; };
+        void setBidirectional(bool enabled){ this->bidirectional_ = enabled; };
+        void setLimits(const SearchLimits &limits);
+        void setSmoothing(bool enabled){ this->smoothing_ = enabled; };
+        void setTrace(const TraceCallback &trace){ this->trace_ = trace; };
+        void setWeight(float weight);
+        bool smoothing() const{ return this->smoothing_; };
+        const SearchStats& stats() const{ return this->stats_; };
+        int stopped() const{ return this->stopped_; };
+        float weight() const{ return this->weight_; };
+
+        private:
+        friend class ClusterGraph;
+        friend class JPSAStar;
+        friend class PathCache;
+        friend class QueryPool;
+
+        explicit BasicSearcher(const std::shared_ptr<const MapData> &data);
+        cv::Vec2i branchingJPS(cv::Vec2i current,
+                               const TargetSet &targets,
+                               const cv::Vec2i &direction) const;
+        void buildJumpTable(JumpTable &jumps) const;
+        std::list<cv::Vec2i> buildPath(int target);
+        void buildPath(int target, std::vector<cv::Vec2i> &path);
+        void checkOnMap(const cv::Vec2i &vec, const std::string &name) const;
+        Neighbors connected(const cv::Vec2i &current) const;
+        float distance(const cv::Vec2i &a, const cv::Vec2i &b) const{
+            return sqrt( pow(a[0] - b[0], 2) + pow(a[1] - b[1], 2) ); };
+        float estimate(const cv::Vec2i &a, const cv::Vec2i &b) const;
+        int expand(const cv::Vec2i &start, size_t limit);
+        void expandFrontier(SearchArena &arena,
+                            SearchArena &other,
+                            const TargetSet &targets,
+                            const cv::Vec2i &goal,
+                            float &best,
+                            int &meeting);
+        float heuristic(const cv::Vec2i &vec) const;
+        bool improvePath(int target_cell,
+                         float weight,
+                         const std::chrono::steady_clock::time_point &deadline,
+                         size_t max_popped,
+                         size_t &popped);
+        bool isJumpPoint(const cv::Vec2i &next, int dir, int straight_jp) const;
+        bool isUniform(const cv::Vec2i &vec) const{
+            return this->data_->costs.empty() || this->data_->uniform.isFree(vec[0], vec[1]); };
+        cv::Vec2i jumpPoint(const cv::Vec2i &parent,
+                            const cv::Vec2i &current,
+                            const cv::Vec2i &target) const;
+        cv::Vec2i jumpPoint(const cv::Vec2i &parent,
+                            const cv::Vec2i &current,
+                            const TargetSet &targets) const;
+        bool limitReached() const;
+        float moveCosts(const cv::Vec2i &from, const cv::Vec2i &to) const;
+        Neighbors prunedNeighbors(const Node &current) const;
+        Neighbors prunedNeighbors(const cv::Vec2i &current, cv::Vec2i direction) const;
+        bool reached(const cv::Vec2i &target) const;
+        void resetLimits();
+        int search(const cv::Vec2i &start, const cv::Vec2i &target);
+        int searchAnyAngle(const cv::Vec2i &start, const cv::Vec2i &target);
+        int searchBidirectional(const cv::Vec2i &start, const cv::Vec2i &target);
+        void smoothPath(std::vector<cv::Vec2i> &path) const;
+        cv::Vec2i tableJumpPoint(const cv::Vec2i &origin,
+                                 const cv::Vec2i &direction,
+                                 const TargetSet &targets) const;
+        cv::Vec2i straightJPS(cv::Vec2i current,
+                              const TargetSet &targets,
+                              const cv::Vec2i &direction) const;
+        void trackClosest(int cell, const cv::Vec2i &vec);
+        void updateJumpTable(JumpTable &jumps, const cv::Rect &rect) const;
+
+        const JPSAStar *engine_;              ///< Engine providing the map, NULL for unpublished maps
+        std::shared_ptr<const MapData> data_; ///< Map snapshot of the current query
+        SearchArena arena_;                   ///< Search state reused between queries
+        TargetSet targets_;                   ///< Targets of the current query
+        std::vector<cv::Vec2i> remaining_;    ///< Targets not reached yet, used by the heuristic
+        std::vector<cv::Vec2i> reachable_;    ///< Targets of findPaths in the component of the start
+        mutable SearchStats stats_;           ///< Counters of the current query
+        TraceCallback trace_;                 ///< Called for every expanded node if set
+        bool bidirectional_;                  ///< findPath searches from start and target at once
+        int meeting_;                         ///< Cell where the last bidirectional search joined its paths, -1 otherwise
+        SearchArena reverse_arena_;           ///< Search state of the backward search from the target
+        TargetSet reverse_targets_;           ///< Start of the current query, the target of the backward search
+        bool smoothing_;                      ///< findPath removes waypoints which can be seen past
+        bool any_angle_;                      ///< findPath runs Lazy Theta* instead of jump point search
+        float weight_;                        ///< Factor of the heuristic in the f values of jump point searches
+        SearchLimits limits_;                 ///< Limits of every query
+        bool limited_;                        ///< limits_ sets at least one limit
+        mutable int stopped_;                 ///< Limit which stopped the current query, SearchLimits::NONE otherwise
+        size_t popped_;                       ///< Nodes expanded by the current query
+        mutable size_t scanned_;              ///< Pixels scanned by the current query
+        mutable size_t next_check_;           ///< Value of scanned_ at which jump scans check the limits next
+        int closest_;                         ///< Expanded cell closest to the target, -1 if partial paths are off
+        float closest_estimate_;              ///< Heuristic of closest_
+        };
+
+
+    typedef BasicSearcher<CornerCutting> Searcher;
+
+
+    /**
+     *  Work-stealing thread pool answering batches of queries on the map of a JPSAStar engine
+     *
+     *  Queries sharing a start are grouped and answered by the same worker.
+     *  The groups are split evenly between the workers. A worker running
+     *  out of groups steals half of the remaining groups of another worker.
+     *  Every worker keeps its Searcher, so search state is reused across
+     *  batches. The calling thread acts as the first worker.
+     *  Only one batch can run at a time.
+    **/
+    class QueryPool{
+        public:
+        explicit QueryPool(const JPSAStar &engine, unsigned threads = 0);
+        ~QueryPool();
+        void findPaths(const PathQuery *queries, size_t count, PathBatch &batch);
+        void findPaths(const std::vector<PathQuery> &queries, PathBatch &batch);
+        unsigned threads() const{ return this->workers_.size(); };
+
+        private:
+        /**
+         *  Location of the path of one query in the waypoints of a worker
+        **/
+        struct Result{
+            unsigned worker; ///< Worker that found the path
+            size_t begin;    ///< First waypoint in the buffer of the worker
+            size_t size;     ///< Number of waypoints, 0 if no path was found
+            };
+
+        /**
+         *  Search state and share of the groups of one worker
+        **/
+        struct Worker{
+            explicit Worker(const JPSAStar &engine) : searcher(engine), begin(0), end(0){};
+
+            Searcher searcher;                ///< Searcher reused for all queries of the worker
+            std::vector<cv::Vec2i> targets;   ///< Targets of the current group
+            std::vector<cv::Vec2i> waypoints; ///< Paths found by the worker in the current batch
+            std::mutex mutex;                 ///< Guards begin and end
+            size_t begin;                     ///< First group which is not taken yet
+            size_t end;                       ///< End of the groups assigned to the worker
+            };
+
+        QueryPool(const QueryPool &);
+        QueryPool& operator=(const QueryPool &);
+        bool nextGroup(unsigned worker, size_t &group);
+        void run(unsigned worker);
+        void solveGroup(unsigned worker, size_t group);
+        void work(unsigned worker);
+
+        const JPSAStar *engine_;                         ///< Engine providing the map
+        std::vector<std::unique_ptr<Worker> > workers_;  ///< State of each worker, index 0 is the caller
+        std::vector<std::thread> threads_;               ///< Threads running workers 1 to n-1
+        std::mutex mutex_;                               ///< Guards generation_, busy_ and stop_
+        std::condition_variable start_;                  ///< Signals a new batch or shutdown
+        std::condition_variable done_;                   ///< Signals that all threads finished the batch
+        unsigned generation_;                            ///< Incremented for every batch
+        unsigned busy_;                                  ///< Threads still working on the batch
+        bool stop_;                                      ///< Threads terminate if true
+
+        std::shared_ptr<const MapData> data_;            ///< Map snapshot of the current batch
+        const PathQuery *queries_;                       ///< Queries of the current batch
+        std::vector<size_t> order_;                      ///< Query indices sorted by start and target
+        std::vector<size_t> groups_;                     ///< First index in order_ of each group, plus order_ size
+        std::vector<Result> results_;                    ///< Path location of each query
+        };
+
+
+    /**
+     *  Search state of a cell in the D* Lite search of a Replanner
+    **/
+    struct ReplanState{
+        uint32_t g_value;    ///< Costs from the cell to the target found by the last expansion
+        uint32_t rhs;        ///< One step lookahead of g_value through the best neighbor
+        int parent;          ///< Next cell on the way to the target, -1 if there is none
+        int heap_index;      ///< Position in the open list, OPEN_NONE if not open
+        unsigned generation; ///< Search in which this state was written, older states are invalid
+        };
+
+
+    /**
+     *  Persistent planner which repairs its last search when start or map change (D* Lite)
+     *
+     *  Implements D* Lite as described in "D* Lite" by Sven Koenig and
+     *  Maxim Likhachev. The search runs from the target to the start on
+     *  the 8-connected grid and keeps all costs between calls. Moving the
+     *  start only shifts the keys of the open list, changed pixels only
+     *  reopen their neighbors, so a replan costs time in the size of the
+     *  change instead of the path length. Changing the target or a map
+     *  change older than the history of the engine starts a new search.
+     *  Costs are integers, a straight step costs 70 and a diagonal one 99
+     *  times the mean costs of both pixels set by JPSAStar::setCosts,
+     *  so keys of cells on equally long paths tie exactly. Float costs
+     *  break these ties by rounding errors and end the search too early.
+     *  Jump point pruning is not used, its jumps can't be repaired locally.
+     *  One planner per robot, a planner must not be shared between threads.
+    **/
+    class Replanner{
+        public:
+        explicit Replanner(const JPSAStar &engine);
+        bool findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path);
+        const SearchStats& stats() const{ return this->stats_; };
+
+        private:
+        /**
+         *  Open list entry, keys are compared lexicographically
+        **/
+        struct Entry{
+            uint64_t k1; ///< Minimum of g_value and rhs plus the estimate to the start
+            uint32_t k2; ///< Minimum of g_value and rhs
+            int cell;    ///< Map cell index
+            bool operator<(const Entry &rhs) const{
+                return this->k1 < rhs.k1 || (this->k1 == rhs.k1 && this->k2 < rhs.k2); };
+            };
+
+        bool buildPath(std::vector<cv::Vec2i> &path) const;
+        ReplanState& cell(int cell){
+            ReplanState &state = this->cells_[cell];
+            if(state.generation != this->generation_){
+                state.g_value = COST_INFINITE;
+                state.rhs = COST_INFINITE;
+                state.parent = -1;
+                state.heap_index = CellState::OPEN_NONE;
+                state.generation = this->generation_;
+                }
+            return state;
+            };
+        void computePath();
+        Entry key(int cell);
+        static uint32_t octile(const cv::Vec2i &a, const cv::Vec2i &b);
+        void remove(size_t pos);
+        void reset(const cv::Vec2i &start, const cv::Vec2i &target);
+        void siftDown(size_t pos);
+        void siftUp(size_t pos);
+        uint32_t stepCosts(int from, int to) const;
+        void updateRhs(int cell);
+        void updateVertex(int cell);
+
+        static const uint32_t COST_INFINITE = 0xffffffff; ///< Costs of unreachable cells
+        static const uint32_t COST_STRAIGHT = 70;         ///< Costs of a straight step
+        static const uint32_t COST_DIAGONAL = 99;         ///< Costs of a diagonal step, about 70 * sqrt(2)
+
+        const JPSAStar *engine_;              ///< Engine providing the map
+        std::shared_ptr<const MapData> data_; ///< Map snapshot the costs belong to
+        std::vector<ReplanState> cells_;      ///< Search state of each map cell
+        std::vector<Entry> heap_;             ///< Binary heap of open cells
+        unsigned generation_;                 ///< Generation of the current search
+        cv::Vec2i start_;                     ///< Start of the last query
+        cv::Vec2i target_;                    ///< Target of the current search
+        uint64_t key_offset_;                 ///< Sum of the estimates between all starts of the search, km of D* Lite
+        SearchStats stats_;                   ///< Counters of the last query
+        };
+
+
+    /**
+     *  Hierarchical abstraction of a map for long queries (HPA*)
+     *
+     *  Implements HPA* as described in "Near Optimal Hierarchical
+     *  Path-Finding" by Adi Botea, Martin Mueller and Jonathan Schaeffer.
+     *  The map is split into square clusters. Entrances are placed on
+     *  free runs along the cluster borders, costs and waypoints between
+     *  all entrances of a cluster are precomputed with the jump point
+     *  search. Long queries search the graph of entrances and only refine
+     *  the segments to the first and from the last entrance with a jump
+     *  point search in the start and target cluster. Paths are near
+     *  optimal. Queries within touching clusters or shorter than two
+     *  clusters use findPath, as the detour through the entrances would
+     *  be large compared to their length. Map changes reported by the
+     *  engine rebuild only the clusters around them.
+     *  A graph must not be shared between threads.
+    **/
+    class ClusterGraph{
+        public:
+        explicit ClusterGraph(const JPSAStar &engine, int cluster_size = 64);
+        int clusterSize() const{ return this->cluster_size_; };
+        bool findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path);
+        void load(std::istream &in);
+        size_t nodes() const{ return this->offsets_.back(); };
+        void save(std::ostream &out) const;
+
+        private:
+        /**
+         *  Entrances of a cluster and the paths between them
+        **/
+        struct Cluster{
+            int side_begin[5];             ///< First node of the left, right, top and bottom side, the last entry is the node count
+            std::vector<cv::Vec2i> nodes;  ///< Pixel of each entrance node
+            std::vector<float> costs;      ///< Costs between all nodes indexed by from * nodes + to, infinity if not connected
+            PathBatch paths;               ///< Waypoints between all nodes, same index as costs
+            };
+
+        ClusterGraph(const ClusterGraph &);
+        ClusterGraph& operator=(const ClusterGraph &);
+        void build(int cluster);
+        cv::Rect clusterRect(int cluster) const;
+        void connect(int cluster, const cv::Vec2i &pixel, std::vector<float> &costs, PathBatch &paths);
+        void entrances(int cluster, int side, std::vector<cv::Vec2i> &pixels) const;
+        cv::Vec2i focus(int cluster);
+        int neighbor(int cluster, int side) const;
+        void rebuild();
+        void sync();
+
+        const JPSAStar *engine_;                ///< Engine providing the map
+        std::shared_ptr<const MapData> data_;   ///< Map snapshot the clusters belong to
+        int cluster_size_;                      ///< Width and height of the clusters in pixels
+        int clusters_x_;                        ///< Number of cluster columns
+        int clusters_y_;                        ///< Number of cluster rows
+        std::vector<Cluster> clusters_;         ///< Clusters in row-major order
+        std::vector<int> offsets_;              ///< Id of the first node of each cluster, the extra last entry is the node count
+        Searcher searcher_;                     ///< Answers queries the graph does not cover
+        SearchArena arena_;                     ///< Search state of the graph of entrances
+        std::vector<float> start_costs_;        ///< Costs from the start to the nodes of its cluster
+        std::vector<float> target_costs_;       ///< Costs from the nodes of its cluster to the target
+        PathBatch start_paths_;                 ///< Waypoints from the start to the nodes of its cluster
+        PathBatch target_paths_;                ///< Waypoints from the target to the nodes of its cluster
+        std::shared_ptr<MapData> cluster_data_; ///< Pixels of the cluster searched by cluster_searcher_, reused for every cluster
+        Searcher cluster_searcher_;             ///< Searches within one cluster for build and connect
+        std::vector<cv::Vec2i> local_;          ///< Nodes of the cluster in the coordinates of cluster_data_
+        };
+
+
+    /**
+     *  Cache of query results for traffic between few frequent locations
+     *
+     *  Found paths are kept in a least recently used list of bounded
+     *  memory. For hub pixels like docks and pickup stations a shortest
+     *  path tree is computed once. Its first moves toward the hub are run
+     *  length encoded per row, so paths to and from a hub are read
+     *  without a search. Before a cached path is used, it is checked
+     *  against the regions changed since it was found. A change can only
+     *  block the path or open a shorter one inside the ellipse of pixels
+     *  whose distances to start and target sum up to at most the path
+     *  length, paths whose ellipse isn't touched stay valid.
+     *  A cache must not be shared between threads.
+    **/
+    class PathCache{
+        public:
+        explicit PathCache(const JPSAStar &engine, size_t max_bytes = 16 << 20);
+        void addHub(const cv::Vec2i &hub);
+        size_t bytes() const{ return this->bytes_ + this->hub_bytes_; };
+        void clear();
+        bool findPath(const cv::Vec2i &start, const cv::Vec2i &target, std::vector<cv::Vec2i> &path);
+        size_t hits() const{ return this->hits_; };
+        size_t misses() const{ return this->misses_; };
+
+        private:
+        /**
+         *  Path of one query in the least recently used list
+        **/
+        struct Entry{
+            cv::Vec2i start;             ///< Start of the query
+            cv::Vec2i target;            ///< Target of the query
+            std::vector<cv::Vec2i> path; ///< Waypoints from start to target
+            float length;                ///< Costs of the path
+            uint64_t version;            ///< Map version the path was last checked against
+            };
+
+        /**
+         *  Shortest path tree of a hub
+        **/
+        struct Hub{
+            cv::Vec2i pixel;               ///< Root of the tree
+            cv::Size size;                 ///< Size of the map the tree was computed on
+            std::vector<uint32_t> runs;    ///< Runs of equal moves per row, column << 4 | direction, NO_MOVE if unreachable
+            std::vector<size_t> row_runs;  ///< First run of each row, the extra last entry is the number of runs
+            uint64_t version;              ///< Map version up to which the changes are collected in changed
+            std::vector<cv::Rect> changed; ///< Regions changed since the tree was computed
+            };
+
+        typedef std::list<Entry> EntryList;
+        typedef std::pair<uint64_t, uint64_t> Key;
+
+        bool affected(uint64_t from, uint64_t to, const cv::Vec2i &start, const cv::Vec2i &target, float length);
+        void buildHub(Hub &hub);
+        static bool crosses(const std::vector<cv::Rect> &regions, const cv::Vec2i &start, const cv::Vec2i &target, float length);
+        static size_t entryBytes(const Entry &entry){
+            // Waypoints and the nodes of the list and the index
+            return sizeof(Entry) + entry.path.capacity() * sizeof(cv::Vec2i) + sizeof(Key) + 8 * sizeof(void*); };
+        bool hubPath(Hub &hub, const cv::Vec2i &from, std::vector<cv::Vec2i> &path);
+        static uint64_t key(const cv::Vec2i &pixel){ return uint64_t(uint32_t(pixel[0])) << 32 | uint32_t(pixel[1]); };
+        static int move(const Hub &hub, int x, int y);
+        void store(const cv::Vec2i &start, const cv::Vec2i &target, const std::vector<cv::Vec2i> &path, const MapData &data);
+        static bool walk(const Hub &hub, const cv::Vec2i &from, std::vector<cv::Vec2i> &path);
+
+        static const uint32_t NO_MOVE = 8;     ///< Move of the hub itself and of pixels that can't reach it
+        static const size_t HUB_CHANGES = 256; ///< Changed regions a tree collects before it is computed again
+
+        const JPSAStar *engine_;                   ///< Engine providing the map
+        Searcher searcher_;                        ///< Answers queries which are not cached
+        SearchArena arena_;                        ///< Search state of the shortest path trees
+        size_t max_bytes_;                         ///< Memory limit of the cached paths
+        size_t bytes_;                             ///< Memory used by cached paths
+        size_t hub_bytes_;                         ///< Memory used by the trees of the hubs
+        size_t hits_;                              ///< Queries answered from the cache
+        size_t misses_;                            ///< Queries answered by a search
+        EntryList entries_;                        ///< Cached paths, most recently used first
+        std::map<Key, EntryList::iterator> index_; ///< Cached path of each start and target
+        std::map<uint64_t, Hub> hubs_;             ///< Trees of the hubs by pixel
+        std::vector<cv::Rect> regions_;            ///< Changed regions, reused between checks
+        };
+
+
     /**
      *  Interface class that uses jump point search A* for path finding
      *
      *  This class uses the jump point search A* algorithm described in
      *  "Online Graph Pruning for Pathfinding On Grid Maps" by Daniel
      *  Harabor and Alban Grastien.
+     *  All member functions are thread-safe. findPath of the engine
+     *  serializes concurrent queries, for parallel queries every thread
+     *  creates its own Searcher.
     **/
     class JPSAStar{
         public:
         JPSAStar(cv::Mat map);
+        explicit JPSAStar(const std::string &file);
+        bool changes(uint64_t from, uint64_t to, std::vector<cv::Rect> &regions) const;
+        cv::Mat costs() const;
         std::list<cv::Vec2i> findPath(cv::Vec2i start, cv::Vec2i target) const;
+        bool findPath(const cv::Vec2i &start,
+                      const cv::Vec2i &target,
+                      std::vector<cv::Vec2i> &path,
+                      SearchStats *stats = NULL) const;
+        void findPaths(const PathQuery *queries, size_t count, PathBatch &batch) const;
+        size_t findPaths(const cv::Vec2i &start,
+                         const std::vector<cv::Vec2i> &targets,
+                         PathBatch &batch,
+                         size_t limit = 0) const;
+        void findPaths(const std::vector<PathQuery> &queries, PathBatch &batch) const;
+        static cv::Mat greyCosts(const cv::Mat &map);
+        bool isPreprocessed() const;
+        void load(const std::string &file);
         cv::Mat map() const;
+        void preprocess();
+        void save(const std::string &file) const;
+        void setAnyAngle(bool enabled);
+        void setBidirectional(bool enabled);
+        void setCell(int x, int y, bool occupied);
+        void setCosts(const cv::Mat &costs);
+        void setLandmarks(int count);
         void setMap(cv::Mat new_map);
+        void setSmoothing(bool enabled);
+        void setWeight(float weight);
+        std::shared_ptr<const MapData> snapshot() const;
+        void updateRegion(const cv::Rect &rect, const cv::Mat &patch);
 
         private:
-        std::list<cv::Vec2i> buildPath(const Node &target) const;
-        std::list<cv::Vec2i> connected(Node &current) const;
-        std::list<cv::Vec2i> diagonalForced(const cv::Vec2i &current,
-                                            const cv::Vec2i &direction) const;
-        cv::Vec2i* diagonalJPS(cv::Vec2i current,
-                               const cv::Vec2i &target,
-                               const cv::Vec2i &direction) const;
-        float distance(const cv::Vec2i &a, const cv::Vec2i &b) const{
-            return sqrt( pow(a[0] - b[0], 2) + pow(a[1] - b[1], 2) ); };
-        cv::Vec2i* jumpPoint(const cv::Vec2i &parent,
-                             const cv::Vec2i &current,
-                             const cv::Vec2i &target) const;
-        std::list<cv::Vec2i> prunedNeighbors(Node &current) const;
-        std::list<cv::Vec2i> straightForced(const cv::Vec2i &current,
-                                            const cv::Vec2i &direction) const;
-        cv::Vec2i* straightJPS(cv::Vec2i current,
-                               const cv::Vec2i &target,
-                               const cv::Vec2i &direction) const;
+        JPSAStar(const JPSAStar &);
+        JPSAStar& operator=(const JPSAStar &);
+        static std::shared_ptr<MapData> createMapData(cv::Mat map, bool preprocess);
+        static std::shared_ptr<MapData> mapFile(const std::string &file);
+        void publish(const std::shared_ptr<MapData> &data, const cv::Rect &changed);
 
-        cv::Mat map_; ///< Image used to calcutale the path, must be 8-Bit grey scale
+        static const size_t HISTORY = 64;             ///< Number of changed regions kept for Replanner
+        static const uint32_t FILE_MAGIC = 0x4d53504a; ///< First word of map files
+        static const uint32_t FILE_VERSION = 2;        ///< Format version of map files
+
+        std::shared_ptr<const MapData> data_;            ///< Current map snapshot, only accessed atomically
+        bool preprocessed_;                              ///< Jump distances are computed for every new map
+        int landmarks_;                                  ///< Number of landmarks picked for every new map, 0 for none
+        mutable std::mutex update_mutex_;                ///< Serializes map changes
+        mutable std::mutex searcher_mutex_;              ///< Serializes queries of searcher_
+        mutable Searcher searcher_;                      ///< Searcher used by findPath
+        mutable std::mutex pool_mutex_;                  ///< Serializes batches of pool_
+        mutable std::unique_ptr<QueryPool> pool_;        ///< Thread pool used by findPaths, created on first use
+        std::shared_ptr<MapData> front_;                 ///< Current snapshot if it was created by updateRegion
+        std::shared_ptr<MapData> spare_;                 ///< Previous snapshot reused by the next updateRegion
+        cv::Rect stale_;                                 ///< Region updated in front_ but not in spare_
+        std::shared_ptr<LandmarkTable> front_landmarks_; ///< Landmark table repaired last by updateRegion
+        std::shared_ptr<LandmarkTable> spare_landmarks_; ///< Table front_landmarks_ was repaired from, reused by the next repair
+        std::vector<int> stale_landmarks_;               ///< Cells changed in front_landmarks_ but not in spare_landmarks_
+        std::vector<cv::Rect> history_;                  ///< Changed region of each recent version, indexed by version % HISTORY
         };
 
     /**
@@ -108,18 +1178,6 @@ namespace jpsastar{
         public:
         NotOnMap(const std::string &what) : std::out_of_range(what){};
         };
-
-    typedef std::multimap< float, Node* > MinHeap;
-    struct VecCmp{
-        bool operator()(const Node *lhs, const Node *rhs) const{
-            if(lhs->vector[0] < rhs->vector[0])
-                return true;
-            else if(lhs->vector[0] == rhs->vector[0])
-                return lhs->vector[1] < rhs->vector[1];
-            return false;
-            }
-        };
-    typedef std::set<Node*, VecCmp> VecSet;
     }
 
 #endif /* end of include guard: JPSASTAR_HPP_NBO2KO09 */
@@ -0,0 +1,1268 @@
+/*----------------------------------------------------------------------------#
+#    Copyright 2013 Julian Weitz                                              #
+#                                                                             #
+#    This program is free software: you can redistribute it and/or modify     #
+#    it under the terms of the GNU General Public License as published by     #
+#    the Free Software Foundation, either version 3 of the License, or        #
+#    any later version.                                                       #
+#                                                                             #
+#    This program is distributed in the hope that it will be useful,          #
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of           #
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            #
+#    GNU General Public License for more details.                             #
+#                                                                             #
+#    You should have received a copy of the GNU General Public License        #
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.    #
+# ---------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+// Only glibc tells the size of a malloc block, elsewhere the peak column stays empty
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define BENCH_HEAP_PEAK
+#endif
+#include <opencv2/opencv.hpp>
+#include "jpsastar/JPSAStar.hpp"
+
+
+static std::atomic<size_t> allocations(0);     ///< Number of calls to operator new
+static std::atomic<size_t> heap_in_use(0);     ///< Bytes currently allocated with operator new
+static std::atomic<size_t> heap_high_water(0); ///< Largest value of heap_in_use since the last reset
+
+/**
+ *  Size of a block of malloc
+ *
+ *  \param ptr Memory returned by malloc
+ *
+ *  \return    Usable bytes of the block, 0 where the C library can't tell
+**/
+static size_t blockSize(void *ptr){
+#if defined(BENCH_HEAP_PEAK)
+    return malloc_usable_size(ptr);
+#else
+    return 0;
+#endif
+    }
+
+
+/**
+ *  Allocates memory and counts it
+ *
+ *  The size is taken from blockSize instead of a header in front of
+ *  the block, so blocks stay plain malloc blocks and free and every
+ *  overload of operator delete agree on their size.
+ *
+ *  \param size      Number of bytes
+ *  \param alignment Alignment of the memory, 0 for the alignment of malloc
+ *
+ *  \return          Allocated memory, NULL if malloc failed
+**/
+static void* allocate(std::size_t size, std::size_t alignment = 0){
+    void *ptr = NULL;
+    if(alignment == 0)
+        ptr = std::malloc(size == 0 ? 1 : size);
+    else if( posix_memalign(&ptr, std::max(sizeof(void*), alignment), size == 0 ? 1 : size) != 0 )
+        ptr = NULL;
+    if(ptr == NULL)
+        return NULL;
+    ++allocations;
+    size_t in_use = heap_in_use += blockSize(ptr);
+    size_t high_water = heap_high_water;
+    while( high_water < in_use && !heap_high_water.compare_exchange_weak(high_water, in_use) );
+    return ptr;
+    }
+
+
+/**
+ *  Frees memory of allocate and uncounts it
+ *
+ *  \param ptr Memory returned by allocate or NULL
+**/
+static void release(void *ptr){
+    if(ptr == NULL)
+        return;
+    heap_in_use -= blockSize(ptr);
+    std::free(ptr);
+    }
+
+
+void* operator new(std::size_t size){
+    void *ptr = allocate(size);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+    }
+
+
+void* operator new[](std::size_t size){
+    return operator new(size);
+    }
+
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept{
+    return allocate(size);
+    }
+
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept{
+    return allocate(size);
+    }
+
+
+void operator delete(void *ptr) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete[](void *ptr) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept{
+    release(ptr);
+    }
+
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *ptr, std::size_t) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete[](void *ptr, std::size_t) noexcept{
+    release(ptr);
+    }
+#endif
+
+
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment){
+    void *ptr = allocate( size, std::size_t(alignment) );
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+    }
+
+
+void* operator new[](std::size_t size, std::align_val_t alignment){
+    return operator new(size, alignment);
+    }
+
+
+void operator delete(void *ptr, std::align_val_t) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete[](void *ptr, std::align_val_t) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept{
+    release(ptr);
+    }
+
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept{
+    release(ptr);
+    }
+#endif
+
+
+/**
+ *  Map of the corpus with the queries run on it
+**/
+struct Scenario{
+    std::string name;                         ///< Name printed in the report
+    cv::Mat map;                              ///< 8 bit grey scale map, 255 is free
+    std::vector<jpsastar::PathQuery> queries; ///< Queries run on the map
+    };
+
+
+/**
+ *  Generates a square map with randomly placed single pixel obstacles
+ *
+ *  \param size    Width and height of the map
+ *  \param density Fraction of occupied pixels
+ *  \param seed    Seed of the random generator, same seed same map
+ *
+ *  \return        8 bit grey scale map
+**/
+static cv::Mat randomMap(int size, double density, unsigned seed){
+    cv::Mat map(size, size, CV_8UC1, cv::Scalar(255));
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for(int y = 0; y < size ;++y){
+        for(int x = 0; x < size ;++x){
+            if(uniform(rng) < density)
+                map.at<uchar>(y, x) = 0;
+            }
+        }
+    map.at<uchar>(0, 0) = 255;
+    map.at<uchar>(size - 1, size - 1) = 255;
+    return map;
+    }
+
+
+/**
+ *  Generates a perfect maze with a recursive backtracker
+ *
+ *  \param size     Width and height of the map
+ *  \param corridor Width of the corridors, walls are 1 pixel wide
+ *  \param seed     Seed of the random generator, same seed same map
+ *
+ *  \return         8 bit grey scale map
+**/
+static cv::Mat mazeMap(int size, int corridor, unsigned seed){
+    cv::Mat map(size, size, CV_8UC1, cv::Scalar(0));
+    const int pitch = corridor + 1;
+    const int cells = (size - 1) / pitch;
+    const int dx[4] = {1, 0, -1, 0};
+    const int dy[4] = {0, 1, 0, -1};
+    std::mt19937 rng(seed);
+    std::vector<bool> visited(cells * cells, false);
+    std::vector<int> stack(1, 0);
+    visited[0] = true;
+    map(cv::Rect(1, 1, corridor, corridor)).setTo( cv::Scalar(255) );
+    while(!stack.empty()){
+        int cx = stack.back() % cells;
+        int cy = stack.back() / cells;
+        int options[4];
+        int count = 0;
+        for(int d = 0; d < 4 ;++d){
+            int nx = cx + dx[d];
+            int ny = cy + dy[d];
+            if(0 <= nx && nx < cells && 0 <= ny && ny < cells && !visited[ny * cells + nx])
+                options[count++] = d;
+            }
+        if(count == 0){
+            stack.pop_back();
+            continue;
+            }
+        int d = options[rng() % count];
+        int nx = cx + dx[d];
+        int ny = cy + dy[d];
+        visited[ny * cells + nx] = true;
+        stack.push_back(ny * cells + nx);
+        // Carve the next cell and the wall between both cells
+        int x = 1 + std::min(cx, nx) * pitch;
+        int y = 1 + std::min(cy, ny) * pitch;
+        map(cv::Rect(x, y, dx[d] != 0 ? 2 * corridor + 1 : corridor,
+                           dy[d] != 0 ? 2 * corridor + 1 : corridor)).setTo( cv::Scalar(255) );
+        }
+    return map;
+    }
+
+
+/**
+ *  Generates square rooms connected by doors
+ *
+ *  \param size Width and height of the map
+ *  \param room Width and height of the rooms, walls are 1 pixel wide
+ *  \param seed Seed of the random generator, same seed same map
+ *
+ *  \return     8 bit grey scale map
+**/
+static cv::Mat roomsMap(int size, int room, unsigned seed){
+    cv::Mat map(size, size, CV_8UC1, cv::Scalar(255));
+    const int pitch = room + 1;
+    const int door = std::max(1, room / 4);
+    std::mt19937 rng(seed);
+    for(int wall = room; wall < size ;wall += pitch){
+        map(cv::Rect(wall, 0, 1, size)).setTo( cv::Scalar(0) );
+        map(cv::Rect(0, wall, size, 1)).setTo( cv::Scalar(0) );
+        }
+    // Every room gets a door to its right and lower neighbor with probability 3/4
+    for(int y = 0; y < size ;y += pitch){
+        for(int x = 0; x < size ;x += pitch){
+            if(x + room < size && rng() % 4 != 0){
+                int offset = rng() % (room - door + 1);
+                int height = std::min(door, size - y - offset);
+                if(0 < height)
+                    map(cv::Rect(x + room, y + offset, 1, height)).setTo( cv::Scalar(255) );
+                }
+            if(y + room < size && rng() % 4 != 0){
+                int offset = rng() % (room - door + 1);
+                int width = std::min(door, size - x - offset);
+                if(0 < width)
+                    map(cv::Rect(x + offset, y + room, width, 1)).setTo( cv::Scalar(255) );
+                }
+            }
+        }
+    return map;
+    }
+
+
+/**
+ *  Loads a map in the format of the MovingAI benchmark sets
+ *
+ *  '.', 'G' and 'S' are free, all other terrain is occupied.
+ *
+ *  \param file Path of the .map file
+ *
+ *  \return     8 bit grey scale map
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be parsed.
+**/
+static cv::Mat loadMovingAIMap(const std::string &file){
+    std::ifstream in(file.c_str());
+    if(!in)
+        throw std::runtime_error("Can't open " + file);
+    std::string key;
+    int width = -1;
+    int height = -1;
+    while(in >> key && key != "map"){
+        if(key == "height")
+            in >> height;
+        else if(key == "width")
+            in >> width;
+        else if(key == "type")
+            in >> key;
+        }
+    if(key != "map" || width <= 0 || height <= 0)
+        throw std::runtime_error("Missing header in " + file);
+    cv::Mat map(height, width, CV_8UC1, cv::Scalar(0));
+    std::string line;
+    for(int y = 0; y < height ;++y){
+        if( !(in >> line) || int(line.size()) < width )
+            throw std::runtime_error("Truncated map in " + file);
+        for(int x = 0; x < width ;++x){
+            if(line[x] == '.' || line[x] == 'G' || line[x] == 'S')
+                map.at<uchar>(y, x) = 255;
+            }
+        }
+    return map;
+    }
+
+
+/**
+ *  Loads the queries of a MovingAI scenario file
+ *
+ *  \param file Path of the .scen file
+ *
+ *  \return     Start and target of each scenario line
+ *
+ *  \throws     std::runtime_error is thrown if the file can't be opened.
+**/
+static std::vector<jpsastar::PathQuery> loadMovingAIScenario(const std::string &file){
+    std::ifstream in(file.c_str());
+    if(!in)
+        throw std::runtime_error("Can't open " + file);
+    std::vector<jpsastar::PathQuery> queries;
+    std::string line;
+    while( std::getline(in, line) ){
+        std::istringstream fields(line);
+        int bucket, width, height, sx, sy, tx, ty;
+        std::string map;
+        // The version line doesn't match and is skipped
+        if(fields >> bucket >> map >> width >> height >> sx >> sy >> tx >> ty)
+            queries.push_back( jpsastar::PathQuery(cv::Vec2i(sx, sy), cv::Vec2i(tx, ty)) );
+        }
+    return queries;
+    }
+
+
+/**
+ *  Labels the 8-connected free regions of a map
+ *
+ *  Diagonal moves between two occupied pixels are allowed, like in the search.
+ *
+ *  \param map 8 bit grey scale map
+ *
+ *  \return    Region of each pixel in row major order, -1 for occupied pixels
+**/
+static std::vector<int> labelRegions(const cv::Mat &map){
+    std::vector<int> labels(map.rows * map.cols, -1);
+    std::vector<int> stack;
+    int next = 0;
+    for(int start = 0; start < int(labels.size()) ;++start){
+        if(labels[start] != -1 || map.at<uchar>(start / map.cols, start % map.cols) != 255)
+            continue;
+        labels[start] = next;
+        stack.push_back(start);
+        while(!stack.empty()){
+            int cx = stack.back() % map.cols;
+            int cy = stack.back() / map.cols;
+            stack.pop_back();
+            for(int y = std::max(0, cy - 1); y <= std::min(map.rows - 1, cy + 1) ;++y){
+                for(int x = std::max(0, cx - 1); x <= std::min(map.cols - 1, cx + 1) ;++x){
+                    int neighbor = y * map.cols + x;
+                    if(labels[neighbor] == -1 && map.at<uchar>(y, x) == 255){
+                        labels[neighbor] = next;
+                        stack.push_back(neighbor);
+                        }
+                    }
+                }
+            }
+        ++next;
+        }
+    return labels;
+    }
+
+
+/**
+ *  Draws queries between random free pixels of the same region
+ *
+ *  \param map   8 bit grey scale map
+ *  \param count Number of queries
+ *  \param seed  Seed of the random generator, same seed same queries
+ *
+ *  \return      Queries which all have a path, empty if the map has no free pixel
+**/
+static std::vector<jpsastar::PathQuery> randomQueries(const cv::Mat &map, int count, unsigned seed){
+    std::vector<int> labels = labelRegions(map);
+    std::vector<int> free_cells;
+    for(size_t i = 0; i < labels.size() ;++i){
+        if(labels[i] != -1)
+            free_cells.push_back(i);
+        }
+    std::vector<jpsastar::PathQuery> queries;
+    if(free_cells.empty())
+        return queries;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, free_cells.size() - 1);
+    for(int attempt = 0; int(queries.size()) < count && attempt < 100 * count ;++attempt){
+        int start = free_cells[pick(rng)];
+        int target = free_cells[pick(rng)];
+        if(labels[start] != labels[target])
+            continue;
+        queries.push_back( jpsastar::PathQuery(cv::Vec2i(start % map.cols, start / map.cols),
+                                               cv::Vec2i(target % map.cols, target / map.cols)) );
+        }
+    return queries;
+    }
+
+
+/**
+ *  Creates the synthetic map corpus
+ *
+ *  Maps and queries only depend on size and count, so runs are comparable.
+ *
+ *  \param size  Width and height of the maps
+ *  \param count Number of queries per map
+ *
+ *  \return      Open field, random obstacles at 10, 20 and 30 percent, mazes and rooms
+**/
+static std::vector<Scenario> syntheticCorpus(int size, int count){
+    std::vector<Scenario> corpus(9);
+    corpus[0].name = "open";
+    corpus[0].map = cv::Mat(size, size, CV_8UC1, cv::Scalar(255));
+    corpus[1].name = "random10";
+    corpus[1].map = randomMap(size, 0.1, 42);
+    corpus[2].name = "random20";
+    corpus[2].map = randomMap(size, 0.2, 43);
+    corpus[3].name = "random30";
+    corpus[3].map = randomMap(size, 0.3, 44);
+    corpus[4].name = "maze1";
+    corpus[4].map = mazeMap(size, 1, 42);
+    corpus[5].name = "maze8";
+    corpus[5].map = mazeMap(size, 8, 42);
+    corpus[6].name = "rooms8";
+    corpus[6].map = roomsMap(size, 8, 42);
+    corpus[7].name = "rooms32";
+    corpus[7].map = roomsMap(size, 32, 42);
+    corpus[8].name = "rooms128";
+    corpus[8].map = roomsMap(size, 128, 42);
+    for(size_t i = 0; i < corpus.size() ;++i)
+        corpus[i].queries = randomQueries(corpus[i].map, count, 7 + i);
+    return corpus;
+    }
+
+
+/**
+ *  Returns the Euclidean length of a path
+ *
+ *  \param path Waypoints of the path
+ *
+ *  \return     Sum of the distances between consecutive waypoints
+**/
+static double pathLength(const std::vector<cv::Vec2i> &path){
+    double length = 0.0;
+    for(size_t i = 1; i < path.size() ;++i)
+        length += std::hypot(path[i][0] - path[i - 1][0], path[i][1] - path[i - 1][1]);
+    return length;
+    }
+
+
+/**
+ *  Returns the nearest rank percentile of sorted samples
+ *
+ *  \param sorted   Samples in ascending order, must not be empty
+ *  \param fraction Value between 0 and 1
+ *
+ *  \return         Smallest sample which is larger or equal to fraction of all samples
+**/
+static double percentile(const std::vector<double> &sorted, double fraction){
+    size_t rank = size_t( std::ceil(fraction * sorted.size()) );
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+
+/**
+ *  Runs the queries of a scenario and prints one report line
+ *
+ *  Latency is measured per query. Expanded nodes and scanned pixels are
+ *  averaged over all queries. Peak is the largest amount of heap memory
+ *  allocated by the queries on top of the memory of the engine, it is
+ *  left out where the C library can't tell the size of blocks.
+ *
+ *  \param scenario      Map and queries
+ *  \param preprocess    Build the JPS+ jump table before querying
+ *  \param bidirectional Search from start and target at once
+**/
+static void runScenario(const Scenario &scenario, bool preprocess, bool bidirectional){
+    if(scenario.queries.empty()){
+        std::printf("%-10s %5dx%-5d no queries\n", scenario.name.c_str(), scenario.map.cols, scenario.map.rows);
+        return;
+        }
+    jpsastar::JPSAStar algo(scenario.map);
+    if(preprocess)
+        algo.preprocess();
+    std::vector<double> latencies;
+    latencies.reserve(scenario.queries.size());
+    size_t baseline = heap_in_use;
+    heap_high_water = baseline;
+
+    jpsastar::Searcher searcher(algo);
+    searcher.setBidirectional(bidirectional);
+    std::vector<cv::Vec2i> path;
+    double expanded = 0.0;
+    double scanned = 0.0;
+    for(size_t i = 0; i < scenario.queries.size() ;++i){
+        auto begin = std::chrono::steady_clock::now();
+        searcher.findPath(scenario.queries[i].start, scenario.queries[i].target, path);
+        auto end = std::chrono::steady_clock::now();
+        latencies.push_back( std::chrono::duration<double, std::micro>(end - begin).count() );
+        expanded += searcher.stats().popped;
+        scanned += searcher.stats().scanned;
+        }
+    double total = 0.0;
+    for(size_t i = 0; i < latencies.size() ;++i)
+        total += latencies[i];
+    std::sort(latencies.begin(), latencies.end());
+    double count = latencies.size();
+    std::printf("%-10s %5dx%-5d %7zu %10.1f %9.1f %9.1f %9.1f %9.1f %10.0f %10.0f",
+                scenario.name.c_str(), scenario.map.cols, scenario.map.rows, latencies.size(),
+                count / total * 1e6, percentile(latencies, 0.5), percentile(latencies, 0.9),
+                percentile(latencies, 0.99), latencies.back(), expanded / count, scanned / count);
+#if defined(BENCH_HEAP_PEAK)
+    std::printf(" %9.0f\n", double(heap_high_water - baseline) / 1024.0);
+#else
+    std::printf(" %9s\n", "-");
+#endif
+    }
+
+
+/**
+ *  Runs all scenarios and prints a report table
+ *
+ *  \param corpus        Maps and queries
+ *  \param preprocess    Build the JPS+ jump tables before querying
+ *  \param bidirectional Search from start and target at once
+**/
+static void benchCorpus(const std::vector<Scenario> &corpus, bool preprocess, bool bidirectional){
+    std::printf("%-10s %11s %7s %10s %9s %9s %9s %9s %10s %10s %9s\n",
+                "map", "size", "queries", "queries/s", "p50 us", "p90 us", "p99 us", "max us",
+                "expanded", "scanned", "peak KiB");
+    for(size_t i = 0; i < corpus.size() ;++i)
+        runScenario(corpus[i], preprocess, bidirectional);
+    }
+
+
+/**
+ *  Measures query time against map size for the single threaded engine
+ *
+ *  \param max_size   Largest width and height, sizes double starting at 64
+ *  \param density    Fraction of occupied pixels
+ *  \param preprocess Build the JPS+ jump table before querying
+**/
+static void benchSizes(int max_size, double density, bool preprocess){
+    std::printf("%-10s %12s %10s %14s %18s %14s\n",
+                "map", "free cells", "queries", "ms/query", "ns/(n log2 n)", "allocs/query");
+    for(int size = 64; size <= max_size; size *= 2){
+        cv::Mat map = randomMap(size, density, 42);
+        jpsastar::JPSAStar algo(map);
+        if(preprocess)
+            algo.preprocess();
+        double cells = cv::countNonZero(map);
+        int queries = std::max(1, (1 << 20) / (size * size));
+        size_t waypoints = 0;
+        std::vector<cv::Vec2i> path;
+        // Warm up search state of the instance and path buffer
+        algo.findPath(cv::Vec2i(0, 0), cv::Vec2i(size - 1, size - 1), path);
+        size_t allocations_before = allocations;
+        auto begin = std::chrono::steady_clock::now();
+        for(int i = 0; i < queries ;++i){
+            algo.findPath(cv::Vec2i(0, 0), cv::Vec2i(size - 1, size - 1), path);
+            waypoints += path.size();
+            }
+        auto end = std::chrono::steady_clock::now();
+        double allocs = double(allocations - allocations_before) / queries;
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count() / queries;
+        std::printf("%4dx%-5d %12.0f %10d %14.3f %18.3f %14.1f%s\n", size, size, cells, queries,
+                    ns / 1e6, ns / (cells * std::log2(cells)), allocs, waypoints ? "" : " (no path)");
+        }
+    }
+
+
+/**
+ *  Compares single queries with batch queries of the thread pool
+ *
+ *  \param size    Width and height of the map
+ *  \param density Fraction of occupied pixels
+ *  \param count   Number of queries, every 8th query shares its start with the previous one
+**/
+static void benchBatch(int size, double density, int count){
+    cv::Mat map = randomMap(size, density, 42);
+    jpsastar::JPSAStar algo(map);
+    std::vector<jpsastar::PathQuery> queries;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> coordinate(0, size - 1);
+    for(int i = 0; i < count ;++i){
+        cv::Vec2i start(coordinate(rng), coordinate(rng));
+        if(i % 8 == 7)
+            start = queries.back().start;
+        queries.push_back( jpsastar::PathQuery(start, cv::Vec2i(coordinate(rng), coordinate(rng))) );
+        }
+
+    std::vector<cv::Vec2i> path;
+    auto begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < count ;++i)
+        algo.findPath(queries[i].start, queries[i].target, path);
+    double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    jpsastar::PathBatch batch;
+    algo.findPaths(queries, batch);  // Starts the pool
+    begin = std::chrono::steady_clock::now();
+    algo.findPaths(queries, batch);
+    double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::printf("%-10s %10s %14s\n", "mode", "queries", "queries/s");
+    std::printf("%-10s %10d %14.1f\n", "findPath", count, count / single);
+    std::printf("%-10s %10d %14.1f\n", "findPaths", count, count / batched);
+    }
+
+
+/**
+ *  Compares single queries to several targets with one multi-target search
+ *
+ *  \param size    Width and height of the map
+ *  \param density Fraction of occupied pixels
+ *  \param count   Number of targets
+**/
+static void benchTargets(int size, double density, int count){
+    cv::Mat map = randomMap(size, density, 42);
+    jpsastar::JPSAStar algo(map);
+    std::vector<cv::Vec2i> targets;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> coordinate(0, size - 1);
+    for(int i = 0; i < count ;++i)
+        targets.push_back( cv::Vec2i(coordinate(rng), coordinate(rng)) );
+    cv::Vec2i start(size / 2, size / 2);
+
+    std::vector<cv::Vec2i> path;
+    algo.findPath(start, targets[0], path);
+    auto begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < count ;++i)
+        algo.findPath(start, targets[i], path);
+    double single = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    jpsastar::PathBatch batch;
+    begin = std::chrono::steady_clock::now();
+    size_t found = algo.findPaths(start, targets, batch);
+    double multi = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    std::printf("%-10s %10s %10s %14s\n", "mode", "targets", "reached", "ms");
+    std::printf("%-10s %10d %10s %14.3f\n", "findPath", count, "", single);
+    std::printf("%-10s %10d %10zu %14.3f\n", "findPaths", count, found, multi);
+    }
+
+
+/**
+ *  Compares a Replanner with a new findPath per step for a robot moving to
+ *  the far corner while random pixels change
+ *
+ *  \param size    Width and height of the map
+ *  \param density Fraction of occupied pixels
+ *  \param steps   Number of moves of the robot
+ *  \param changes Number of pixels changed before every move
+**/
+static void benchReplan(int size, double density, int steps, int changes){
+    cv::Mat map = randomMap(size, density, 42);
+    jpsastar::JPSAStar algo(map);
+    jpsastar::Replanner replanner(algo);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> coordinate(0, size - 1);
+    cv::Vec2i start(0, 0);
+    const cv::Vec2i target(size - 1, size - 1);
+    std::vector<cv::Vec2i> path;
+    double replan_ms = 0, find_ms = 0, first_ms = 0;
+    size_t popped = 0;
+    int replans = 0, queries = 0;
+    for(int step = 0; step <= steps ;++step){
+        auto begin = std::chrono::steady_clock::now();
+        bool found = replanner.findPath(start, target, path);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if(step == 0)
+            first_ms = ms;
+        else{
+            replan_ms += ms;
+            popped += replanner.stats().popped;
+            ++replans;
+            }
+        std::vector<cv::Vec2i> fresh;
+        begin = std::chrono::steady_clock::now();
+        algo.findPath(start, target, fresh);
+        find_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        ++queries;
+        if(!found || path.size() < 2)
+            break;
+        // One pixel along the path, then the map changes
+        cv::Vec2i direction = path[1] - path[0];
+        start += cv::Vec2i( (0 < direction[0]) - (direction[0] < 0), (0 < direction[1]) - (direction[1] < 0) );
+        for(int i = 0; i < changes ;++i){
+            int x = coordinate(rng);
+            int y = coordinate(rng);
+            if( cv::Vec2i(x, y) != start && cv::Vec2i(x, y) != target )
+                algo.setCell(x, y, rng() % 2 == 0);
+            }
+        }
+    std::printf("%-12s %10s %14s %14s\n", "mode", "steps", "ms/step", "popped/step");
+    std::printf("%-12s %10d %14.3f %14s\n", "first", 1, first_ms, "");
+    std::printf("%-12s %10d %14.3f %14.1f\n", "replan", replans, replan_ms / std::max(1, replans),
+                double(popped) / std::max(1, replans));
+    std::printf("%-12s %10d %14.3f %14s\n", "findPath", queries, find_ms / queries, "");
+    }
+
+
+/**
+ *  Compares a PathCache with findPath under skewed traffic on a rooms map
+ *
+ *  Half of the queries start or end at a hub, the other half repeat 200
+ *  frequent pairs.
+ *
+ *  \param size  Width and height of the map
+ *  \param hubs  Number of hubs
+ *  \param count Number of queries
+**/
+static void benchCache(int size, int hubs, int count){
+    cv::Mat map = roomsMap(size, 32, 42);
+    jpsastar::JPSAStar algo(map);
+    jpsastar::PathCache cache(algo);
+    std::vector<jpsastar::PathQuery> pairs = randomQueries(map, 200 + hubs, 9);
+    auto begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < hubs ;++i)
+        cache.addHub(pairs[200 + i].start);
+    double hub_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::vector<jpsastar::PathQuery> others = randomQueries(map, count, 11);
+    std::vector<jpsastar::PathQuery> queries;
+    std::mt19937 rng(13);
+    for(int i = 0; i < count ;++i){
+        if(i % 2 == 0)
+            queries.push_back( jpsastar::PathQuery(pairs[200 + rng() % hubs].start, others[i].target) );
+        else
+            queries.push_back( pairs[rng() % 200] );
+        }
+    std::vector<cv::Vec2i> path;
+    double cache_ms = 0, find_ms = 0;
+    for(size_t i = 0; i < queries.size() ;++i){
+        begin = std::chrono::steady_clock::now();
+        cache.findPath(queries[i].start, queries[i].target, path);
+        cache_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        begin = std::chrono::steady_clock::now();
+        algo.findPath(queries[i].start, queries[i].target, path);
+        find_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+    std::printf("%d hubs built in %.1f ms, %.1f KiB, %.1f %% hits\n", hubs, hub_ms, cache.bytes() / 1024.0,
+                100.0 * cache.hits() / std::max<size_t>(1, cache.hits() + cache.misses()));
+    std::printf("%-12s %10s %14s\n", "mode", "queries", "ms/query");
+    std::printf("%-12s %10zu %14.4f\n", "cache", queries.size(), cache_ms / queries.size());
+    std::printf("%-12s %10zu %14.4f\n", "findPath", queries.size(), find_ms / queries.size());
+    }
+
+
+/**
+ *  Compares queries without costs, with zones of equal costs and with
+ *  different costs on every pixel on a rooms map
+ *
+ *  Zones are squares costing 1 to 4 on a base of 2 with lanes of costs
+ *  1 through the map. Noise costs leave no uniform pixels, so every
+ *  expanded pixel runs like A* without pruning.
+ *
+ *  \param size  Width and height of the map
+ *  \param count Number of queries
+**/
+static void benchCosts(int size, int count){
+    cv::Mat map = roomsMap(size, 32, 42);
+    std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+    cv::Mat zones(size, size, CV_32FC1, cv::Scalar(2.0));
+    cv::Mat noise(size, size, CV_32FC1);
+    std::mt19937 rng(5);
+    for(int y = 0; y < size ;++y){
+        for(int x = 0; x < size ;++x){
+            float &cost = zones.at<float>(y, x);
+            if(x % 128 < 2 || y % 128 < 2)
+                cost = 1.0;
+            else if( (x / 48 + y / 48) % 3 == 0 )
+                cost = 1.0 + (x / 48 * 7 + y / 48 * 3) % 4;
+            noise.at<float>(y, x) = 1.0 + (rng() % 1000) / 1000.0;
+            }
+        }
+    const char *names[3] = { "none", "zones", "noise" };
+    const cv::Mat costs[3] = { cv::Mat(), zones, noise };
+    jpsastar::JPSAStar algo(map);
+    std::vector<cv::Vec2i> path;
+    std::printf("%-12s %10s %14s %14s\n", "costs", "queries", "ms/query", "expanded");
+    for(int i = 0; i < 3 ;++i){
+        algo.setCosts(costs[i]);
+        double ms = 0, expanded = 0;
+        for(size_t q = 0; q < queries.size() ;++q){
+            jpsastar::SearchStats stats;
+            auto begin = std::chrono::steady_clock::now();
+            algo.findPath(queries[q].start, queries[q].target, path, &stats);
+            ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            expanded += stats.popped;
+            }
+        std::printf("%-12s %10zu %14.3f %14.1f\n", names[i], queries.size(), ms / queries.size(), expanded / queries.size());
+        }
+    }
+
+
+/**
+ *  Compares raw jump point paths with smoothed paths and any-angle search
+ *
+ *  \param size  Width and height of the maps
+ *  \param count Number of queries per map
+**/
+static void benchSmoothing(int size, int count){
+    const char *maps[2] = { "random", "rooms" };
+    const char *modes[3] = { "raw", "smoothed", "any-angle" };
+    for(int i = 0; i < 2 ;++i){
+        cv::Mat map = i == 0 ? randomMap(size, 0.2, 42) : roomsMap(size, 32, 42);
+        std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+        jpsastar::JPSAStar algo(map);
+        std::printf("%s map\n", maps[i]);
+        std::printf("%-12s %10s %12s %12s %12s %12s %12s\n", "path", "queries", "ms/query", "expanded", "sight", "waypoints", "length");
+        for(int mode = 0; mode < 3 ;++mode){
+            jpsastar::Searcher searcher(algo);
+            searcher.setSmoothing(mode == 1);
+            searcher.setAnyAngle(mode == 2);
+            std::vector<cv::Vec2i> path;
+            double ms = 0, expanded = 0, sight = 0, waypoints = 0, length = 0;
+            for(size_t q = 0; q < queries.size() ;++q){
+                auto begin = std::chrono::steady_clock::now();
+                searcher.findPath(queries[q].start, queries[q].target, path);
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                expanded += searcher.stats().popped;
+                sight += searcher.stats().sight_checks;
+                waypoints += path.size();
+                length += pathLength(path);
+                }
+            std::printf("%-12s %10zu %12.3f %12.1f %12.1f %12.1f %12.1f\n", modes[mode], queries.size(), ms / queries.size(),
+                        expanded / queries.size(), sight / queries.size(), waypoints / queries.size(), length / queries.size());
+            }
+        }
+    }
+
+
+/**
+ *  Runs queries with a searcher of a movement model and prints the averages
+ *
+ *  \param name    Name of the movement model in the output
+ *  \param algo    Engine whose map is searched
+ *  \param queries Queries which are run
+**/
+template<class Movement>
+static void runMovement(const char *name, const jpsastar::JPSAStar &algo, const std::vector<jpsastar::PathQuery> &queries){
+    jpsastar::BasicSearcher<Movement> searcher(algo);
+    std::vector<cv::Vec2i> path;
+    double ms = 0, expanded = 0, length = 0;
+    size_t found = 0;
+    for(size_t q = 0; q < queries.size() ;++q){
+        auto begin = std::chrono::steady_clock::now();
+        if( searcher.findPath(queries[q].start, queries[q].target, path) ){
+            ++found;
+            length += pathLength(path);
+            }
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        expanded += searcher.stats().popped;
+        }
+    std::printf("%-16s %10zu %10zu %14.3f %14.1f %14.1f\n", name, queries.size(), found,
+                ms / queries.size(), expanded / queries.size(), length / std::max<size_t>(found, 1));
+    }
+
+
+/**
+ *  Compares the movement models on a random and a rooms map
+ *
+ *  \param size  Width and height of the maps
+ *  \param count Number of queries per map
+**/
+static void benchMovement(int size, int count){
+    const char *maps[2] = { "random", "rooms" };
+    for(int i = 0; i < 2 ;++i){
+        cv::Mat map = i == 0 ? randomMap(size, 0.2, 42) : roomsMap(size, 32, 42);
+        std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+        jpsastar::JPSAStar algo(map);
+        std::printf("%s map\n", maps[i]);
+        std::printf("%-16s %10s %10s %14s %14s %14s\n", "movement", "queries", "found", "ms/query", "expanded", "length");
+        runMovement<jpsastar::CornerCutting>("corner-cutting", algo, queries);
+        runMovement<jpsastar::NoCornerCutting>("no-corner-cut", algo, queries);
+        runMovement<jpsastar::FourConnected>("4-connected", algo, queries);
+        }
+    }
+
+
+/**
+ *  Compares weighted searches and anytime searches with a deadline with shortest paths
+ *
+ *  The excess is the mean extra length of the paths over the shortest paths.
+ *
+ *  \param size  Width and height of the maps
+ *  \param count Number of queries per map
+**/
+static void benchWeight(int size, int count){
+    const char *maps[2] = { "random", "rooms" };
+    const float weights[4] = { 1.0f, 1.5f, 2.0f, 3.0f };
+    const double deadlines[3] = { 0.1, 0.5, 2.0 };
+    for(int i = 0; i < 2 ;++i){
+        cv::Mat map = i == 0 ? randomMap(size, 0.2, 42) : roomsMap(size, 32, 42);
+        std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+        jpsastar::JPSAStar algo(map);
+        jpsastar::Searcher searcher(algo);
+        std::vector<cv::Vec2i> path;
+        std::vector<double> shortest(queries.size(), 0.0);
+        for(size_t q = 0; q < queries.size() ;++q)
+            if( searcher.findPath(queries[q].start, queries[q].target, path) )
+                shortest[q] = pathLength(path);
+        std::printf("%s map\n", maps[i]);
+        std::printf("%-16s %10s %10s %12s %12s %12s %12s\n", "search", "queries", "found", "ms/query", "expanded", "bound", "excess %");
+        for(int w = 0; w < 4 ;++w){
+            searcher.setWeight(weights[w]);
+            double ms = 0, expanded = 0, excess = 0;
+            size_t found = 0;
+            for(size_t q = 0; q < queries.size() ;++q){
+                auto begin = std::chrono::steady_clock::now();
+                if( searcher.findPath(queries[q].start, queries[q].target, path) ){
+                    ++found;
+                    excess += pathLength(path) / std::max(shortest[q], 1e-9) - 1.0;
+                    }
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                expanded += searcher.stats().popped;
+                }
+            char name[32];
+            std::snprintf(name, sizeof(name), "weight %.1f", weights[w]);
+            std::printf("%-16s %10zu %10zu %12.3f %12.1f %12.2f %12.2f\n", name, queries.size(), found, ms / queries.size(),
+                        expanded / queries.size(), weights[w], 100.0 * excess / std::max<size_t>(found, 1));
+            }
+        searcher.setWeight(3.0f);
+        for(int d = 0; d < 3 ;++d){
+            double ms = 0, expanded = 0, bounds = 0, excess = 0;
+            size_t found = 0;
+            for(size_t q = 0; q < queries.size() ;++q){
+                float bound;
+                auto begin = std::chrono::steady_clock::now();
+                auto deadline = begin + std::chrono::microseconds( static_cast<int64_t>(deadlines[d] * 1000) );
+                if( searcher.findPathAnytime(queries[q].start, queries[q].target, path, bound, deadline) ){
+                    ++found;
+                    bounds += bound;
+                    excess += pathLength(path) / std::max(shortest[q], 1e-9) - 1.0;
+                    }
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                expanded += searcher.stats().popped;
+                }
+            char name[32];
+            std::snprintf(name, sizeof(name), "anytime %.1fms", deadlines[d]);
+            std::printf("%-16s %10zu %10zu %12.3f %12.1f %12.2f %12.2f\n", name, queries.size(), found, ms / queries.size(),
+                        expanded / queries.size(), bounds / std::max<size_t>(found, 1), 100.0 * excess / std::max<size_t>(found, 1));
+            }
+        }
+    }
+
+
+/**
+ *  Compares searches with and without landmarks on a random, a rooms and a maze map
+ *
+ *  \param size      Width and height of the maps
+ *  \param count     Number of queries per map
+ *  \param landmarks Number of landmarks
+**/
+static void benchLandmarks(int size, int count, int landmarks){
+    const char *maps[3] = { "random", "rooms", "maze" };
+    for(int i = 0; i < 3 ;++i){
+        cv::Mat map = i == 0 ? randomMap(size, 0.2, 42) : (i == 1 ? roomsMap(size, 32, 42) : mazeMap(size, 4, 42));
+        std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+        jpsastar::JPSAStar algo(map);
+        std::printf("%s map\n", maps[i]);
+        std::printf("%-16s %10s %10s %10s %12s %12s %12s\n", "heuristic", "build ms", "MB", "found", "ms/query", "expanded", "length");
+        for(int enabled = 0; enabled < 2 ;++enabled){
+            auto begin = std::chrono::steady_clock::now();
+            algo.setLandmarks(enabled ? landmarks : 0);
+            const double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            std::shared_ptr<const jpsastar::MapData> data = algo.snapshot();
+            const double mb = data->landmarks ? data->landmarks->cells() * data->landmarks->count() * 2 / 1048576.0 : 0.0;
+            jpsastar::Searcher searcher(algo);
+            std::vector<cv::Vec2i> path;
+            double ms = 0, expanded = 0, length = 0;
+            size_t found = 0;
+            for(size_t q = 0; q < queries.size() ;++q){
+                begin = std::chrono::steady_clock::now();
+                if( searcher.findPath(queries[q].start, queries[q].target, path) ){
+                    ++found;
+                    length += pathLength(path);
+                    }
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                expanded += searcher.stats().popped;
+                }
+            char name[32];
+            std::snprintf(name, sizeof(name), enabled ? "%d landmarks" : "octile", landmarks);
+            std::printf("%-16s %10.1f %10.1f %10zu %12.3f %12.1f %12.1f\n", name, build_ms, mb, found,
+                        ms / queries.size(), expanded / queries.size(), length / std::max<size_t>(found, 1));
+            }
+        }
+    }
+
+
+/**
+ *  Compares queries on a ClusterGraph with findPath on a rooms map
+ *
+ *  \param size         Width and height of the map
+ *  \param cluster_size Width and height of the clusters
+ *  \param count        Number of queries
+**/
+static void benchClusters(int size, int cluster_size, int count){
+    cv::Mat map = roomsMap(size, 32, 42);
+    jpsastar::JPSAStar algo(map);
+    std::vector<jpsastar::PathQuery> queries = randomQueries(map, count, 7);
+    auto begin = std::chrono::steady_clock::now();
+    jpsastar::ClusterGraph graph(algo, cluster_size);
+    double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::vector<cv::Vec2i> path;
+    double graph_ms = 0, find_ms = 0, graph_length = 0, find_length = 0;
+    for(size_t i = 0; i < queries.size() ;++i){
+        begin = std::chrono::steady_clock::now();
+        graph.findPath(queries[i].start, queries[i].target, path);
+        graph_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        graph_length += pathLength(path);
+        begin = std::chrono::steady_clock::now();
+        algo.findPath(queries[i].start, queries[i].target, path);
+        find_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        find_length += pathLength(path);
+        }
+    begin = std::chrono::steady_clock::now();
+    algo.setCell(size / 2, size / 2, true);
+    graph.findPath(queries[0].start, queries[0].target, path);
+    double update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("graph: %zu nodes, built in %.1f ms, setCell and query in %.3f ms\n", graph.nodes(), build_ms, update_ms);
+    std::printf("%-12s %10s %14s %14s\n", "mode", "queries", "ms/query", "length");
+    std::printf("%-12s %10zu %14.3f %14.4f\n", "clusters", queries.size(), graph_ms / queries.size(), graph_length / find_length);
+    std::printf("%-12s %10zu %14.3f %14.4f\n", "findPath", queries.size(), find_ms / queries.size(), 1.0);
+    }
+
+
+/**
+ *  Compares building a preprocessed engine from an image with mapping a saved file
+ *
+ *  \param size Width and height of the map
+ *  \param file Path of the temporary map file
+**/
+static void benchStartup(int size, const std::string &file){
+    cv::Mat map = roomsMap(size, 32, 42);
+    std::vector<jpsastar::PathQuery> queries = randomQueries(map, 1, 7);
+    std::vector<cv::Vec2i> path;
+    std::printf("%-12s %14s %14s\n", "mode", "startup ms", "query ms");
+    for(int mapped = 0; mapped < 2 ;++mapped){
+        auto begin = std::chrono::steady_clock::now();
+        std::unique_ptr<jpsastar::JPSAStar> algo;
+        if(mapped)
+            algo.reset( new jpsastar::JPSAStar(file) );
+        else{
+            algo.reset( new jpsastar::JPSAStar(map) );
+            algo->preprocess();
+            }
+        auto ready = std::chrono::steady_clock::now();
+        // The first query of a mapped engine loads the pages it touches
+        algo->findPath(queries[0].start, queries[0].target, path);
+        auto end = std::chrono::steady_clock::now();
+        std::printf("%-12s %14.3f %14.3f\n", mapped ? "mapped" : "preprocess",
+                    std::chrono::duration<double, std::milli>(ready - begin).count(),
+                    std::chrono::duration<double, std::milli>(end - ready).count());
+        if(!mapped)
+            algo->save(file);
+        }
+    std::remove( file.c_str() );
+    }
+
+
+/**
+ *  Measures query throughput against the number of threads sharing one map,
+ *  every thread queries through its own Searcher
+ *
+ *  \param size        Width and height of the map
+ *  \param density     Fraction of occupied pixels
+ *  \param max_threads Largest number of threads, counts double starting at 1
+**/
+static void benchThreads(int size, double density, int max_threads){
+    cv::Mat map = randomMap(size, density, 42);
+    jpsastar::JPSAStar algo(map);
+    const int queries = 64;
+    std::printf("%-10s %10s %14s %10s\n", "threads", "queries", "queries/s", "speedup");
+    double single = 0;
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        std::vector<std::thread> workers;
+        auto begin = std::chrono::steady_clock::now();
+        for(int t = 0; t < threads ;++t){
+            workers.push_back(std::thread([&algo, size, t](){
+                jpsastar::Searcher searcher(algo);
+                std::vector<cv::Vec2i> path;
+                std::mt19937 rng(t);
+                std::uniform_int_distribution<int> coordinate(0, size - 1);
+                for(int i = 0; i < queries ;++i){
+                    cv::Vec2i start(coordinate(rng), coordinate(rng));
+                    cv::Vec2i target(coordinate(rng), coordinate(rng));
+                    searcher.findPath(start, target, path);
+                    }
+                }));
+            }
+        for(size_t t = 0; t < workers.size() ;++t)
+            workers[t].join();
+        auto end = std::chrono::steady_clock::now();
+        double qps = threads * queries / std::chrono::duration<double>(end - begin).count();
+        if(threads == 1)
+            single = qps;
+        std::printf("%-10d %10d %14.1f %10.2f\n", threads, threads * queries, qps, qps / single);
+        }
+    }
+
+
+/**
+ *  Returns a numeric argument
+ *
+ *  \param args     Arguments following the mode
+ *  \param index    Position of the argument
+ *  \param fallback Value if the argument is missing
+ *
+ *  \return         Value of the argument
+**/
+static double argument(const std::vector<std::string> &args, size_t index, double fallback){
+    return index < args.size() ? std::atof(args[index].c_str()) : fallback;
+    }
+
+
+int main(int argc, char *argv[]){
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool bidirectional = !args.empty() && args.back() == "bidir";
+    if(bidirectional)
+        args.pop_back();
+    bool preprocess = !args.empty() && args.back() == "jps+";
+    if(preprocess)
+        args.pop_back();
+    // Without mode the corpus is benchmarked
+    std::string mode = "suite";
+    if( !args.empty() && !std::isdigit(static_cast<unsigned char>(args[0][0])) ){
+        mode = args[0];
+        args.erase(args.begin());
+        }
+
+    try{
+        if(mode == "suite"){
+            benchCorpus(syntheticCorpus(argument(args, 0, 512), argument(args, 1, 200)), preprocess, bidirectional);
+            }
+        else if(mode == "movingai" && !args.empty()){
+            std::vector<Scenario> corpus(1);
+            corpus[0].name = args[0].substr(args[0].find_last_of('/') + 1);
+            corpus[0].map = loadMovingAIMap(args[0]);
+            if(1 < args.size())
+                corpus[0].queries = loadMovingAIScenario(args[1]);
+            else
+                corpus[0].queries = randomQueries(corpus[0].map, 200, 7);
+            benchCorpus(corpus, preprocess, bidirectional);
+            }
+        else if(mode == "sizes"){
+            benchSizes(argument(args, 0, 1024), argument(args, 1, 0.2), preprocess);
+            }
+        else if(mode == "threads"){
+            benchThreads(argument(args, 0, 1024), 0.2,
+                         argument(args, 1, std::max(1u, std::thread::hardware_concurrency())));
+            }
+        else if(mode == "batch"){
+            benchBatch(argument(args, 0, 1024), 0.2, argument(args, 1, 256));
+            }
+        else if(mode == "targets"){
+            benchTargets(argument(args, 0, 1024), 0.2, argument(args, 1, 16));
+            }
+        else if(mode == "cache"){
+            benchCache(argument(args, 0, 1024), argument(args, 1, 16), argument(args, 2, 2000));
+            }
+        else if(mode == "costs"){
+            benchCosts(argument(args, 0, 1024), argument(args, 1, 100));
+            }
+        else if(mode == "movement"){
+            benchMovement(argument(args, 0, 1024), argument(args, 1, 100));
+            }
+        else if(mode == "smoothing"){
+            benchSmoothing(argument(args, 0, 1024), argument(args, 1, 100));
+            }
+        else if(mode == "weight"){
+            benchWeight(argument(args, 0, 1024), argument(args, 1, 100));
+            }
+        else if(mode == "landmarks"){
+            benchLandmarks(argument(args, 0, 1024), argument(args, 1, 100), argument(args, 2, 8));
+            }
+        else if(mode == "clusters"){
+            benchClusters(argument(args, 0, 2048), argument(args, 1, 64), argument(args, 2, 200));
+            }
+        else if(mode == "startup"){
+            benchStartup(argument(args, 0, 4096), "bench_startup.map");
+            }
+        else if(mode == "replan"){
+            benchReplan(argument(args, 0, 1024), 0.2, argument(args, 1, 200), argument(args, 2, 8));
+            }
+        else{
+            std::printf("Usage:\n"
+                        "  bench [suite] [map_size] [queries] [jps+] [bidir]\n"
+                        "  bench movingai file.map [file.scen] [jps+] [bidir]\n"
+                        "  bench sizes [max_map_size] [obstacle_density] [jps+]\n"
+                        "  bench threads [map_size] [max_threads]\n"
+                        "  bench batch [map_size] [queries]\n"
+                        "  bench targets [map_size] [targets]\n"
+                        "  bench replan [map_size] [steps] [changes]\n"
+                        "  bench clusters [map_size] [cluster_size] [queries]\n"
+                        "  bench cache [map_size] [hubs] [queries]\n"
+                        "  bench costs [map_size] [queries]\n"
+                        "  bench movement [map_size] [queries]\n"
+                        "  bench smoothing [map_size] [queries]\n"
+                        "  bench weight [map_size] [queries]\n"
+                        "  bench landmarks [map_size] [queries] [landmarks]\n"
+                        "  bench startup [map_size]\n");
+            return 1;
+            }
+        }
+    catch(const std::exception &e){
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+        }
+    return 0;
+    }
@@ -74,7 +74,11 @@ int main(int argc, char *argv[]){
     // Parse commandline options
     po::options_description options("Options");
     options.add_options()("help,h", "Show this help output.")
-                         ("map,m", po::value< std::string >(), "Path to the image of the map");
+                         ("map,m", po::value< std::string >(), "Path to the image of the map")
+                         ("costs,c", "Keep grey pixels free and let darker ones cost more instead of thresholding")
+                         ("smooth", "Join waypoints which can see each other by straight lines")
+                         ("any-angle", "Search any-angle paths with Lazy Theta*")
+                         ("save,s", po::value< std::string >(), "Preprocess the map and write it to a file for JPSAStar::load");
     po::positional_options_description operands;
     operands.add("map", 1);
 
@@ -100,8 +104,20 @@ int main(int argc, char *argv[]){
 
     cv::Mat map_thres;
     cv::cvtColor(map_color, map_thres, CV_BGR2GRAY);
-    cv::threshold(map_thres, map_thres, 230, 255, cv::THRESH_BINARY);
-    algo.setMap(map_thres);
+    if(vm.count("costs")){
+        algo.setMap(map_thres);
+        algo.setCosts( jpsastar::JPSAStar::greyCosts(map_thres) );
+        }
+    else{
+        cv::threshold(map_thres, map_thres, 230, 255, cv::THRESH_BINARY);
+        algo.setMap(map_thres);
+        }
+    algo.setSmoothing( vm.count("smooth") );
+    algo.setAnyAngle( vm.count("any-angle") );
+    if(vm.count("save")){
+        algo.preprocess();
+        algo.save(vm["save"].as<std::string>());
+        }
     cv::namedWindow("JPSAStar");
     cv::imshow("JPSAStar", map_color);
     cv::namedWindow("threshold");
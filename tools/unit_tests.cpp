@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 #define private public
@@ -9,7 +15,8 @@
 #undef private
 
 
-std::string to_string(const std::list<cv::Vec2i> &vec_list){
+template<typename VecList>
+std::string to_string(const VecList &vec_list){
                        std::string r = "[ ";
                        for(auto &vec : vec_list){
                            r += "(" + std::to_string(vec[0]) + "," + std::to_string(vec[1]) + ") ";
@@ -22,9 +29,20 @@ std::string to_string(const cv::Vec2i &vec){
                        return "(" + std::to_string(vec[0]) + "," + std::to_string(vec[1]) + ")";
                        };
 
+template<typename Iterator>
+double pathLength(Iterator begin, Iterator end){
+                       double length = 0.0;
+                       for(Iterator it = begin; it != end && it + 1 != end ;++it){
+                           cv::Vec2i step = *(it + 1) - *it;
+                           length += std::sqrt( double(step[0] * step[0] + step[1] * step[1]) );
+                           }
+                       return length;
+                       };
+
 
 TEST(PruneNeighbors, PartentNULL){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -41,8 +59,9 @@ TEST(PruneNeighbors, PartentNULL){
     expected.push_back( cv::Vec2i(2,2) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node current(cv::Vec2i(1,1), NULL);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -51,7 +70,8 @@ TEST(PruneNeighbors, PartentNULL){
 
 
 TEST(PruneNeighbors, StraightForcedRight){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255,   0, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -62,9 +82,10 @@ TEST(PruneNeighbors, StraightForcedRight){
     expected.push_back( cv::Vec2i(3,2) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(1,2), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -73,7 +94,8 @@ TEST(PruneNeighbors, StraightForcedRight){
 
 
 TEST(PruneNeighbors, StraightForcedLeft){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255,   0, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -85,9 +107,10 @@ TEST(PruneNeighbors, StraightForcedLeft){
     expected.push_back( cv::Vec2i(1,3) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(3,2), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -96,7 +119,8 @@ TEST(PruneNeighbors, StraightForcedLeft){
 
 
 TEST(PruneNeighbors, StraightForcedUp){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255,   0,   0, 255, 255,
                                              255,   0, 255,   0, 255,
@@ -106,9 +130,10 @@ TEST(PruneNeighbors, StraightForcedUp){
     expected.push_back( cv::Vec2i(3,1) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(2,3), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -117,7 +142,8 @@ TEST(PruneNeighbors, StraightForcedUp){
 
 
 TEST(PruneNeighbors, StraightWallDown){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -125,9 +151,10 @@ TEST(PruneNeighbors, StraightWallDown){
                                                0,   0,   0,   0,   0);
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(2,2), NULL);
     jpsastar::Node current(cv::Vec2i(2,3), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -136,7 +163,8 @@ TEST(PruneNeighbors, StraightWallDown){
 
 
 TEST(PruneNeighbors, DiagonalNatural){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -147,9 +175,10 @@ TEST(PruneNeighbors, DiagonalNatural){
     expected.push_back( cv::Vec2i(3,2) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(1,1), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -158,7 +187,8 @@ TEST(PruneNeighbors, DiagonalNatural){
 
 
 TEST(PruneNeighbors, DiagonalForced){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255, 255,   0, 255, 255,
                                              255, 255, 255, 255, 255,
@@ -170,9 +200,10 @@ TEST(PruneNeighbors, DiagonalForced){
     expected.push_back( cv::Vec2i(2,3) );
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(3,1), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -181,16 +212,18 @@ TEST(PruneNeighbors, DiagonalForced){
 
 
 TEST(PruneNeighbors, DiagonalWall){
-    std::list<cv::Vec2i> expected, pruned;
+    std::list<cv::Vec2i> expected;
+    jpsastar::Neighbors pruned;
     cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
                                              255,   0,   0, 255, 255,
                                              255,   0, 255, 255, 255,
                                              255, 255, 255, 255, 255,
                                              255, 255, 255, 255, 255);
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     jpsastar::Node parent(cv::Vec2i(3,3), NULL);
     jpsastar::Node current(cv::Vec2i(2,2), &parent);
-    pruned = jpsastar.prunedNeighbors(current);
+    pruned = searcher.prunedNeighbors(current);
 
     ASSERT_THAT( expected, testing::UnorderedElementsAreArray(pruned.begin(), pruned.end()) )
         << "Expected: " << to_string(expected) << "\n"
@@ -205,11 +238,12 @@ TEST(JumpPointSearch, StraightWall){
                                              0, 255, 255, 255, 255,
                                              0, 255, 255, 255, 255);
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     cv::Vec2i current(4,2);
     cv::Vec2i neighbor(3,2);
-    cv::Vec2i *jp = jpsastar.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
 
-    ASSERT_THAT(jp, testing::IsNull());
+    ASSERT_EQ(jp, jpsastar::NO_JUMP_POINT);
     }
 
 
@@ -220,11 +254,12 @@ TEST(JumpPointSearch, StraightJP){
                                              255, 255,   0, 255, 255,
                                              255, 255, 255, 255, 255);
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     cv::Vec2i current(1,0);
     cv::Vec2i neighbor(1,1);
-    cv::Vec2i *jp = jpsastar.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
 
-    ASSERT_EQ( *jp, cv::Vec2i(1,3) );
+    ASSERT_EQ( jp, cv::Vec2i(1,3) );
     }
 
 
@@ -235,13 +270,14 @@ TEST(JumpPointSearch, DiagonalWall){
                                              255, 255, 255, 255,   0,
                                              255, 255, 255, 255,   0);
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     cv::Vec2i current(0,0);
     cv::Vec2i neighbor(1,1);
-    cv::Vec2i *jp = jpsastar.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
 
-    ASSERT_THAT(jp, testing::IsNull())
-        << "Expected: NULL\n"
-        << "  Actual: " << to_string(*jp);
+    ASSERT_EQ(jp, jpsastar::NO_JUMP_POINT)
+        << "Expected: NO_JUMP_POINT\n"
+        << "  Actual: " << to_string(jp);
     }
 
 
@@ -254,13 +290,14 @@ TEST(JumpPointSearch, DiagonalJPNeighbor){
     cv::Vec2i expected(1,3);
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     cv::Vec2i current(0,4);
     cv::Vec2i neighbor(1,3);
-    cv::Vec2i *jp = jpsastar.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
 
-    ASSERT_EQ(*jp, expected)
+    ASSERT_EQ(jp, expected)
         << "Expected: " << to_string(expected) << "\n"
-        << "  Actual: " << to_string(*jp);
+        << "  Actual: " << to_string(jp);
     }
 
 
@@ -274,13 +311,751 @@ TEST(JumpPointSearch, DiagonalJPDiag){
     cv::Vec2i expected(3,2);
 
     jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
     cv::Vec2i current(0,5);
     cv::Vec2i neighbor(1,4);
-    cv::Vec2i *jp = jpsastar.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
 
-    ASSERT_EQ(*jp, expected)
+    ASSERT_EQ(jp, expected)
         << "Expected: " << to_string(expected) << "\n"
-        << "  Actual: " << to_string(*jp);
+        << "  Actual: " << to_string(jp);
+    }
+
+
+TEST(JumpPointSearch, StraightBorder){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
+    cv::Vec2i current(4,0);
+    cv::Vec2i neighbor(3,0);
+    cv::Vec2i jp = searcher.jumpPoint( current, neighbor, cv::Vec2i(0,0) );
+
+    ASSERT_EQ( jp, cv::Vec2i(0,0) );
+    }
+
+
+TEST(BitGrid, ScanAcrossWords){
+    cv::Mat map(3, 150, CV_8UC1, cv::Scalar(255));
+    map.at<uchar>(0, 100) = 0;
+    map.at<uchar>(1, 140) = 0;
+    jpsastar::BitGrid grid(map);
+
+    ASSERT_TRUE(grid.isFree(149, 2));
+    ASSERT_FALSE(grid.isFree(150, 2));
+    ASSERT_FALSE(grid.isFree(-1, 0));
+    // Forced neighbor behind the obstacle in the row above
+    ASSERT_EQ(grid.scanRow(2, 1, 1), 100);
+    ASSERT_EQ(grid.scanRow(101, 1, 1), 140);
+    ASSERT_EQ(grid.scanRow(130, 1, -1), 100);
+    ASSERT_EQ(grid.scanRow(99, 1, -1), -1);
+    ASSERT_EQ(grid.scanRow(10, 2, 1), 140);
+    ASSERT_EQ(grid.scanRow(141, 2, 1), 150);
+    ASSERT_EQ(grid.scanColumn(140, 2, -1), 1);
+    ASSERT_EQ(grid.scanColumn(50, 2, -1), -1);
+    }
+
+
+TEST(BitGrid, LineOfSight){
+    cv::Mat map(5, 150, CV_8UC1, cv::Scalar(255));
+    map.at<uchar>(0, 100) = 0;
+    map.at<uchar>(3, 60) = 0;
+    map.at<uchar>(2, 61) = 0;
+    map.at<uchar>(1, 21) = 0;
+    map.at<uchar>(2, 11) = 0;
+    jpsastar::BitGrid grid(map);
+
+    // Flat lines are checked in spans across word borders
+    ASSERT_FALSE( grid.lineOfSight(cv::Vec2i(0,0), cv::Vec2i(149,0), false) );
+    ASSERT_TRUE( grid.lineOfSight(cv::Vec2i(0,4), cv::Vec2i(149,4), false) );
+    ASSERT_TRUE( grid.lineOfSight(cv::Vec2i(0,0), cv::Vec2i(149,1), false) );
+    ASSERT_FALSE( grid.lineOfSight(cv::Vec2i(149,0), cv::Vec2i(0,1), false) );
+    // Steep lines, the line passes between (21,1) and (20,1)
+    ASSERT_TRUE( grid.lineOfSight(cv::Vec2i(20,0), cv::Vec2i(21,4), false) );
+    ASSERT_FALSE( grid.lineOfSight(cv::Vec2i(11,4), cv::Vec2i(10,0), false) );
+    // Pixels touched at a corner only block if corners are checked
+    ASSERT_TRUE( grid.lineOfSight(cv::Vec2i(59,1), cv::Vec2i(62,4), false) );
+    ASSERT_FALSE( grid.lineOfSight(cv::Vec2i(59,1), cv::Vec2i(62,4), true) );
+    ASSERT_TRUE( grid.lineOfSight(cv::Vec2i(5,3), cv::Vec2i(5,3), true) );
+    }
+
+
+TEST(BitGrid, PacksRowsAndColumns){
+    // Rows and columns cross word borders and end within a word
+    cv::Mat map(70, 150, CV_8UC1, cv::Scalar(255));
+    for(int y = 0; y < map.rows ;++y)
+        for(int x = 0; x < map.cols ;++x)
+            if( (x * 7 + y * 13 + x * y) % 5 == 0 )
+                map.at<uchar>(y, x) = 0;
+    jpsastar::BitGrid grid(map);
+    for(int y = -1; y <= map.rows ;++y){
+        for(int x = -1; x <= map.cols ;++x){
+            const bool free = grid.isInside(x, y) && 0 < map.at<uchar>(y, x);
+            ASSERT_EQ(free, grid.isFree(x, y)) << to_string(cv::Vec2i(x, y));
+            ASSERT_EQ( free, ((grid.column(x)[(y + 64) / 64] >> ((y + 64) & 63)) & 1) == 1 ) << to_string(cv::Vec2i(x, y));
+            }
+        }
+
+    // Updates only read the pixels of the region
+    cv::Mat expected = map.clone();
+    cv::Mat changed = map.clone();
+    changed.setTo( cv::Scalar(128) );
+    const cv::Rect regions[3] = { cv::Rect(60, 3, 10, 65), cv::Rect(0, 63, 150, 2), cv::Rect(149, 69, 1, 1) };
+    for(int i = 0; i < 3 ;++i){
+        cv::Mat region = changed(regions[i]);
+        region.setTo( cv::Scalar(i % 2 == 0 ? 0 : 255) );
+        cv::Mat expected_region = expected(regions[i]);
+        region.copyTo(expected_region);
+        grid.update(changed, regions[i]);
+        ASSERT_EQ(jpsastar::BitGrid(expected).words_, grid.words_);
+        }
+    }
+
+
+TEST(ClusterGraph, FindPathSaveAndUpdate){
+    // Wall in column 6 with a gap in row 10
+    cv::Mat map(12, 12, CV_8UC1, cv::Scalar(255));
+    for(int y = 0; y < 12 ;++y)
+        map.at<uchar>(y, 6) = y == 10 ? 255 : 0;
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::ClusterGraph graph(jpsastar, 4);
+    std::vector<cv::Vec2i> path, expected;
+
+    ASSERT_TRUE( graph.findPath(cv::Vec2i(1,1), cv::Vec2i(10,1), path) );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(1,1), cv::Vec2i(10,1), expected) );
+    ASSERT_EQ(cv::Vec2i(1,1), path.front());
+    ASSERT_EQ(cv::Vec2i(10,1), path.back());
+    ASSERT_LE(pathLength(expected.begin(), expected.end()) - 1e-4, pathLength(path.begin(), path.end()));
+    ASSERT_GE(pathLength(expected.begin(), expected.end()) * 1.2, pathLength(path.begin(), path.end()));
+    // Neighbors on both sides of a cluster border take the direct step
+    ASSERT_TRUE( graph.findPath(cv::Vec2i(3,5), cv::Vec2i(4,6), path) );
+    ASSERT_NEAR(std::sqrt(2.0), pathLength(path.begin(), path.end()), 1e-4);
+
+    std::stringstream file, copy;
+    graph.save(file);
+    jpsastar::ClusterGraph loaded(jpsastar, 3);
+    loaded.load(file);
+    ASSERT_EQ(graph.nodes(), loaded.nodes());
+    loaded.save(copy);
+    ASSERT_EQ(file.str(), copy.str());
+
+    // Sides of the first cluster out of order
+    std::string broken = file.str();
+    const int32_t side_begin = -1;
+    broken.replace( 32, sizeof(side_begin), reinterpret_cast<const char*>(&side_begin), sizeof(side_begin) );
+    std::stringstream broken_file(broken);
+    ASSERT_THROW(loaded.load(broken_file), std::runtime_error);
+    // The saved graph belongs to other costs
+    jpsastar.setCosts( cv::Mat(12, 12, CV_32FC1, cv::Scalar(2)) );
+    file.clear();
+    file.seekg(0);
+    ASSERT_THROW(loaded.load(file), std::runtime_error);
+    jpsastar.setCosts( cv::Mat() );
+
+    // Closing the gap only rebuilds the clusters around it
+    jpsastar.setCell(6, 10, true);
+    ASSERT_FALSE( graph.findPath(cv::Vec2i(1,1), cv::Vec2i(10,1), path) );
+    jpsastar.setCell(6, 2, false);
+    ASSERT_TRUE( graph.findPath(cv::Vec2i(1,1), cv::Vec2i(10,1), path) );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(1,1), cv::Vec2i(10,1), expected) );
+    ASSERT_GE(pathLength(expected.begin(), expected.end()) * 1.2, pathLength(path.begin(), path.end()));
+
+    // The saved graph belongs to the old map
+    file.clear();
+    file.seekg(0);
+    ASSERT_THROW(loaded.load(file), std::runtime_error);
+    }
+
+
+TEST(ClusterGraph, RejectsBrokenFiles){
+    cv::Mat map(40, 40, CV_8UC1, cv::Scalar(255));
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::ClusterGraph graph(jpsastar, 10);
+    std::stringstream file;
+    graph.save(file);
+    const std::string saved = file.str();
+    // Loads the file with some bytes replaced
+    auto load = [&](size_t offset, const void *bytes, size_t size){
+        std::string broken = saved;
+        broken.replace( offset, size, static_cast<const char*>(bytes), size );
+        std::stringstream in(broken);
+        graph.load(in);
+        };
+
+    // The first cluster starts at byte 28 with its sides, followed by its nodes,
+    // costs, path offsets and waypoints. It has two entrances on the right side
+    // and two at the bottom.
+    int32_t sides[5];
+    std::memcpy(sides, saved.data() + 28, sizeof(sides));
+    ASSERT_EQ(0, sides[1]);
+    ASSERT_EQ(2, sides[2]);
+    ASSERT_EQ(4, sides[4]);
+    ASSERT_NO_THROW( load(28, sides, sizeof(sides)) );
+    const size_t nodes = 48;
+    const size_t costs = nodes + 4 * 8;
+    const size_t offsets = costs + 16 * 4;
+    const size_t waypoints = offsets + 17 * 8;
+
+    // The first node belongs to no side
+    const int32_t unassigned[5] = { 1, 1, 2, 2, 4 };
+    ASSERT_THROW(load(28, unassigned, sizeof(unassigned)), std::runtime_error);
+    // An entrance on the left border of the map
+    const int32_t left[5] = { 0, 1, 2, 2, 4 };
+    const int32_t corner[2] = { 0, 0 };
+    std::string moved = saved;
+    moved.replace( nodes, sizeof(corner), reinterpret_cast<const char*>(corner), sizeof(corner) );
+    moved.replace( 28, sizeof(left), reinterpret_cast<const char*>(left), sizeof(left) );
+    std::stringstream moved_file(moved);
+    ASSERT_THROW(graph.load(moved_file), std::runtime_error);
+    // One entrance less on the right side than on the left side of the neighbor
+    const int32_t uneven[5] = { 0, 0, 1, 1, 4 };
+    ASSERT_THROW(load(28, uneven, sizeof(uneven)), std::runtime_error);
+    // A bottom entrance outside of the cluster
+    const int32_t outside[2] = { 0, 30 };
+    ASSERT_THROW(load(nodes + 2 * 8, outside, sizeof(outside)), std::runtime_error);
+    // Negative costs between two entrances
+    const float negative = -1.0f;
+    ASSERT_THROW(load(costs + 4, &negative, sizeof(negative)), std::runtime_error);
+    // The waypoints of the first path end behind those of the second one
+    uint64_t second_end;
+    std::memcpy(&second_end, saved.data() + offsets + 2 * 8, sizeof(second_end));
+    const uint64_t first_end = second_end + 1;
+    ASSERT_THROW(load(offsets + 8, &first_end, sizeof(first_end)), std::runtime_error);
+    // A waypoint outside of the cluster
+    const int32_t far[2] = { 30, 0 };
+    ASSERT_THROW(load(waypoints, far, sizeof(far)), std::runtime_error);
+
+    // A failed load keeps the graph
+    std::vector<cv::Vec2i> path;
+    ASSERT_TRUE( graph.findPath(cv::Vec2i(1,1), cv::Vec2i(38,38), path) );
+    }
+
+
+TEST(ComponentLabels, SplitAndMerge){
+    // Ring of free pixels around a walled room in the middle
+    cv::Mat map(7, 7, CV_8UC1, cv::Scalar(255));
+    for(int i = 1; i < 6 ;++i){
+        map.at<uchar>(1, i) = map.at<uchar>(5, i) = 0;
+        map.at<uchar>(i, 1) = map.at<uchar>(i, 5) = 0;
+        }
+    jpsastar::JPSAStar jpsastar(map);
+    std::vector<cv::Vec2i> path;
+    const jpsastar::ComponentLabels *labels = &jpsastar.snapshot()->components;
+    ASSERT_NE(labels->label(0, 0), labels->label(3, 3));
+    ASSERT_EQ(0u, labels->label(1, 1));
+    ASSERT_FALSE( jpsastar.findPath(cv::Vec2i(0,0), cv::Vec2i(3,3), path) );
+    // An occupied start is left through its free neighbors
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(2,1), cv::Vec2i(3,3), path) );
+
+    // A door merges the room with the ring
+    jpsastar.setCell(3, 5, false);
+    labels = &jpsastar.snapshot()->components;
+    ASSERT_EQ(labels->label(0, 0), labels->label(3, 3));
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(0,0), cv::Vec2i(3,3), path) );
+
+    // Cutting the ring twice splits it, the room stays with the lower half
+    jpsastar.setCell(0, 3, true);
+    labels = &jpsastar.snapshot()->components;
+    ASSERT_EQ(labels->label(0, 0), labels->label(3, 3));
+    jpsastar.updateRegion( cv::Rect(5,3,2,1), cv::Mat(1, 2, CV_8UC1, cv::Scalar(0)) );
+    labels = &jpsastar.snapshot()->components;
+    ASSERT_NE(labels->label(0, 0), labels->label(3, 3));
+    ASSERT_EQ(labels->label(0, 6), labels->label(3, 3));
+    ASSERT_EQ(labels->label(0, 0), labels->label(6, 0));
+    ASSERT_FALSE( jpsastar.findPath(cv::Vec2i(0,0), cv::Vec2i(0,6), path) );
+
+    // Incremental labels describe the same components as new ones
+    jpsastar::ComponentLabels rebuilt;
+    rebuilt.assign(jpsastar.snapshot()->grid);
+    for(int a = 0; a < 49 ;++a){
+        for(int b = 0; b < 49 ;++b){
+            ASSERT_EQ( labels->label(a % 7, a / 7) == labels->label(b % 7, b / 7),
+                       rebuilt.label(a % 7, a / 7) == rebuilt.label(b % 7, b / 7) );
+            }
+        }
+    }
+
+
+TEST(JumpTable, SameAsScan){
+    cv::Mat map6x8 = (cv::Mat_<char>(6,8) << 255, 255, 255, 255, 255, 255, 255, 255,
+                                             255,   0, 255, 255, 255, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255,
+                                             255,   0, 255, 255,   0, 255,   0, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255);
+    jpsastar::JPSAStar scan(map6x8);
+    jpsastar::JPSAStar table(map6x8);
+    table.preprocess();
+    ASSERT_TRUE(table.isPreprocessed());
+    jpsastar::Searcher scan_searcher(scan);
+    jpsastar::Searcher table_searcher(table);
+
+    const cv::Vec2i targets[3] = { cv::Vec2i(-1,-1), cv::Vec2i(7,0), cv::Vec2i(2,5) };
+    for(int y = 0; y < 6 ;++y){
+        for(int x = 0; x < 8 ;++x){
+            for(int dir = 0; dir < 8 ;++dir){
+                for(int t = 0; t < 3 ;++t){
+                    cv::Vec2i current(x,y);
+                    cv::Vec2i neighbor = current + jpsastar::JumpTable::DIRECTIONS[dir];
+                    ASSERT_EQ( scan_searcher.jumpPoint(current, neighbor, targets[t]),
+                               table_searcher.jumpPoint(current, neighbor, targets[t]) )
+                        << "Current: " << to_string(current) << " Neighbor: " << to_string(neighbor)
+                        << " Target: " << to_string(targets[t]);
+                    }
+                }
+            }
+        }
+
+    std::list<cv::Vec2i> path = table.findPath( cv::Vec2i(0,5), cv::Vec2i(7,5) );
+    ASSERT_EQ(path.front(), cv::Vec2i(0,5));
+    ASSERT_EQ(path.back(), cv::Vec2i(7,5));
+    }
+
+
+TEST(LandmarkTable, BoundsAndUpdates){
+    // Serpentine corridors, the Euclidean distance misses every turn
+    cv::Mat map(16, 16, CV_8UC1, cv::Scalar(255));
+    for(int y = 1; y < map.rows ;y += 2)
+        for(int x = 0; x < map.cols ;++x)
+            if( x != ((y / 2) % 2 == 0 ? map.cols - 1 : 0) )
+                map.at<uchar>(y,x) = 0;
+    jpsastar::JPSAStar plain(map);
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar.setLandmarks(4);
+    std::shared_ptr<const jpsastar::MapData> data = jpsastar.snapshot();
+    ASSERT_TRUE( data->landmarks );
+    ASSERT_EQ(4, data->landmarks->count());
+    ASSERT_THROW(jpsastar.setLandmarks(-1), std::invalid_argument);
+
+    jpsastar::Searcher plain_searcher(plain);
+    jpsastar::Searcher searcher(jpsastar);
+    std::vector<cv::Vec2i> path, landmark_path;
+    bool tighter = false;
+    for(int start = 0; start < 256 ;start += 3){
+        for(int target = 0; target < 256 ;target += 5){
+            const cv::Vec2i start_vec(start % 16, start / 16);
+            const cv::Vec2i target_vec(target % 16, target / 16);
+            const bool found = plain_searcher.findPath(start_vec, target_vec, path);
+            ASSERT_EQ( found, searcher.findPath(start_vec, target_vec, landmark_path) );
+            if(!found)
+                continue;
+            const double costs = pathLength(path.begin(), path.end());
+            ASSERT_NEAR( costs, pathLength(landmark_path.begin(), landmark_path.end()), 1e-3 );
+            ASSERT_LE(searcher.popped_, plain_searcher.popped_);
+            const float bound = data->landmarks->lowerBound(start, target);
+            ASSERT_LE(bound, costs + 1e-3) << to_string(start_vec) << " to " << to_string(target_vec);
+            const cv::Vec2i step = target_vec - start_vec;
+            tighter = tighter || std::sqrt( double(step[0] * step[0] + step[1] * step[1]) ) + 1.0 < bound;
+            }
+        }
+    ASSERT_TRUE(tighter);
+
+    // Freeing repairs the distances of the same landmarks to those built from scratch
+    jpsastar.setCell(3, 1, false);
+    plain.setCell(3, 1, false);
+    std::shared_ptr<const jpsastar::MapData> freed = jpsastar.snapshot();
+    ASSERT_NE( data->landmarks, freed->landmarks );
+    ASSERT_EQ( data->landmarks->landmarks(), freed->landmarks->landmarks() );
+    jpsastar::LandmarkTable fresh(*freed->landmarks);
+    for(int i = 0; i < fresh.count() ;++i)
+        fresh.fill(*freed, i);
+    ASSERT_EQ( 0, std::memcmp(fresh.distances_, freed->landmarks->distances_, 256 * 4 * sizeof(uint16_t)) );
+    jpsastar::JPSAStar rebuilt( freed->map.clone() );
+    rebuilt.setLandmarks(4);
+    for(int start = 0; start < 256 ;start += 3){
+        for(int target = 0; target < 256 ;target += 5){
+            if( !plain_searcher.findPath(cv::Vec2i(start % 16, start / 16), cv::Vec2i(target % 16, target / 16), path) )
+                continue;
+            const double costs = pathLength(path.begin(), path.end());
+            ASSERT_LE(freed->landmarks->lowerBound(start, target), costs + 1e-3);
+            ASSERT_LE(rebuilt.snapshot()->landmarks->lowerBound(start, target), costs + 1e-3);
+            }
+        }
+
+    // Blocking keeps the bounds
+    jpsastar.setCell(5, 0, true);
+    ASSERT_EQ( freed->landmarks, jpsastar.snapshot()->landmarks );
+    jpsastar.setCell(5, 1, false);
+    ASSERT_NE( freed->landmarks, jpsastar.snapshot()->landmarks );
+    ASSERT_TRUE( jpsastar.snapshot()->landmarks );
+
+    // Any value above 0 frees a pixel, brightening a free one keeps the bounds
+    std::shared_ptr<const jpsastar::MapData> before = jpsastar.snapshot();
+    jpsastar.updateRegion( cv::Rect(7, 3, 1, 1), cv::Mat(1, 1, CV_8UC1, cv::Scalar(128)) );
+    ASSERT_NE( before->landmarks, jpsastar.snapshot()->landmarks );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(7,2), cv::Vec2i(7,4), landmark_path) );
+    ASSERT_NEAR( 2.0, pathLength(landmark_path.begin(), landmark_path.end()), 1e-3 );
+    before = jpsastar.snapshot();
+    jpsastar.updateRegion( cv::Rect(7, 3, 1, 1), cv::Mat(1, 1, CV_8UC1, cv::Scalar(255)) );
+    ASSERT_EQ( before->landmarks, jpsastar.snapshot()->landmarks );
+
+    const std::string file = "unit_tests_landmarks.map";
+    jpsastar.save(file);
+    jpsastar::JPSAStar loaded(file);
+    ASSERT_TRUE( loaded.snapshot()->landmarks );
+    ASSERT_TRUE( loaded.snapshot()->landmarks->owned_.empty() );
+    ASSERT_EQ( jpsastar.snapshot()->landmarks->landmarks(), loaded.snapshot()->landmarks->landmarks() );
+    ASSERT_EQ( jpsastar.snapshot()->landmarks->scales_, loaded.snapshot()->landmarks->scales_ );
+    ASSERT_EQ( 0, std::memcmp(jpsastar.snapshot()->landmarks->distances_, loaded.snapshot()->landmarks->distances_, 256 * 4 * sizeof(uint16_t)) );
+    std::remove( file.c_str() );
+
+    jpsastar.setLandmarks(0);
+    ASSERT_FALSE( jpsastar.snapshot()->landmarks );
+    }
+
+
+TEST(PathCache, HubsAndInvalidation){
+    cv::Mat map(10, 10, CV_8UC1, cv::Scalar(255));
+    for(int y = 0; y < 8 ;++y)
+        map.at<uchar>(y, 4) = 0;
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::PathCache cache(jpsastar);
+    cache.addHub( cv::Vec2i(8,1) );
+    std::vector<cv::Vec2i> path, expected;
+
+    // Paths to and from the hub need no search
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(1,1), cv::Vec2i(8,1), path) );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(1,1), cv::Vec2i(8,1), expected) );
+    ASSERT_EQ(cv::Vec2i(1,1), path.front());
+    ASSERT_EQ(cv::Vec2i(8,1), path.back());
+    ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(path.begin(), path.end()), 1e-4);
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(8,1), cv::Vec2i(0,0), path) );
+    ASSERT_EQ(cv::Vec2i(8,1), path.front());
+    ASSERT_EQ(cv::Vec2i(0,0), path.back());
+    ASSERT_EQ(2u, cache.hits());
+    ASSERT_EQ(0u, cache.misses());
+
+    // Trees collect far changes and outlive the change history of the engine
+    const jpsastar::PathCache::Hub &hub = cache.hubs_.begin()->second;
+    for(int i = 0; i < 70 ;++i){
+        jpsastar.setCell(0, 9, i % 2 == 0);
+        ASSERT_TRUE( cache.findPath(cv::Vec2i(9,0), cv::Vec2i(8,1), path) );
+        }
+    ASSERT_EQ(jpsastar.snapshot()->version, hub.version);
+    ASSERT_EQ(70u, hub.changed.size());
+
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(0,2), cv::Vec2i(2,2), path) );
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(0,2), cv::Vec2i(2,2), path) );
+    ASSERT_EQ(1u, cache.misses());
+    ASSERT_LT(0u, cache.bytes());
+
+    // Changes far from a cached path keep it, a gap in the wall drops it
+    jpsastar.setCell(8, 8, true);
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(0,2), cv::Vec2i(2,2), path) );
+    ASSERT_EQ(1u, cache.misses());
+    jpsastar.setCell(4, 1, false);
+    ASSERT_TRUE( cache.findPath(cv::Vec2i(1,1), cv::Vec2i(8,1), path) );
+    expected.assign(1, cv::Vec2i(1,1));
+    expected.push_back( cv::Vec2i(8,1) );
+    ASSERT_EQ(expected, path)
+        << "Expected: " << to_string(expected) << "\n"
+        << "  Actual: " << to_string(path);
+
+    // Closing the wall separates the hub
+    jpsastar.setCell(4, 1, true);
+    jpsastar.updateRegion( cv::Rect(4, 8, 1, 2), cv::Mat(2, 1, CV_8UC1, cv::Scalar(0)) );
+    ASSERT_FALSE( cache.findPath(cv::Vec2i(1,1), cv::Vec2i(8,1), path) );
+    ASSERT_TRUE(path.empty());
+
+    // A limit smaller than a path keeps nothing
+    jpsastar::PathCache tiny(jpsastar, 16);
+    ASSERT_TRUE( tiny.findPath(cv::Vec2i(0,2), cv::Vec2i(2,2), path) );
+    ASSERT_TRUE( tiny.findPath(cv::Vec2i(0,2), cv::Vec2i(2,2), path) );
+    ASSERT_EQ(2u, tiny.misses());
+    ASSERT_EQ(0u, tiny.bytes());
+    }
+
+
+TEST(QueryPool, SameCostsAsFindPath){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0,   0,   0,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    std::vector<jpsastar::PathQuery> queries;
+    for(int y = 0; y < 5 ;++y){
+        for(int x = 0; x < 5 ;++x){
+            queries.push_back( jpsastar::PathQuery(cv::Vec2i(1,2), cv::Vec2i(x,y)) );
+            queries.push_back( jpsastar::PathQuery(cv::Vec2i(x,y), cv::Vec2i(4,0)) );
+            }
+        }
+    // Repeated and off map queries
+    queries.push_back( jpsastar::PathQuery(cv::Vec2i(1,2), cv::Vec2i(4,0)) );
+    queries.push_back( jpsastar::PathQuery(cv::Vec2i(1,2), cv::Vec2i(4,0)) );
+    queries.push_back( jpsastar::PathQuery(cv::Vec2i(5,0), cv::Vec2i(4,0)) );
+    queries.push_back( jpsastar::PathQuery(cv::Vec2i(0,0), cv::Vec2i(0,-1)) );
+
+    jpsastar::QueryPool pool(jpsastar, 3);
+    jpsastar::PathBatch batch;
+    pool.findPaths(queries, batch);
+
+    ASSERT_EQ(queries.size(), batch.size());
+    for(size_t i = 0; i < queries.size() ;++i){
+        std::vector<cv::Vec2i> expected;
+        const cv::Vec2i &start = queries[i].start;
+        const cv::Vec2i &target = queries[i].target;
+        if(   0 <= start[0] && start[0] < 5 && 0 <= start[1] && start[1] < 5
+           && 0 <= target[0] && target[0] < 5 && 0 <= target[1] && target[1] < 5 )
+            jpsastar.findPath(start, target, expected);
+        // Paths of a group may pass other targets of the group, compare costs
+        std::vector<cv::Vec2i> path(batch.begin(i), batch.end(i));
+        ASSERT_EQ(expected.empty(), path.empty())
+            << "Query: " << to_string(start) << " -> " << to_string(target);
+        if(path.empty())
+            continue;
+        ASSERT_EQ(expected.back(), path.back());
+        ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(path.begin(), path.end()), 1e-4)
+            << "Query: " << to_string(start) << " -> " << to_string(target) << "\n"
+            << "Expected: " << to_string(expected) << "\n"
+            << "  Actual: " << to_string(path);
+        }
+    // Second batch reuses the workers
+    jpsastar.findPaths(queries, batch);
+    ASSERT_EQ(queries.size(), batch.size());
+    }
+
+
+TEST(Replanner, RepairsAfterChanges){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Replanner replanner(jpsastar);
+    std::vector<cv::Vec2i> path, expected;
+
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(1,2), cv::Vec2i(3,2), path) );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(1,2), cv::Vec2i(3,2), expected) );
+    ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(path.begin(), path.end()), 1e-4);
+
+    // A gap in the wall shortens the path
+    jpsastar.setCell(2, 2, false);
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(1,2), cv::Vec2i(3,2), path) );
+    expected.assign(1, cv::Vec2i(1,2));
+    expected.push_back( cv::Vec2i(3,2) );
+    ASSERT_EQ(expected, path)
+        << "Expected: " << to_string(expected) << "\n"
+        << "  Actual: " << to_string(path);
+
+    // Moving along the path needs no new search
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(2,2), cv::Vec2i(3,2), path) );
+    ASSERT_EQ(2u, path.size());
+    ASSERT_EQ(0u, replanner.stats().popped);
+
+    jpsastar.setCell(2, 2, true);
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(1,3), cv::Vec2i(3,2), path) );
+    ASSERT_TRUE( jpsastar.findPath(cv::Vec2i(1,3), cv::Vec2i(3,2), expected) );
+    ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(path.begin(), path.end()), 1e-4);
+
+    jpsastar.setCell(2, 4, true);
+    ASSERT_FALSE( replanner.findPath(cv::Vec2i(1,3), cv::Vec2i(3,2), path) );
+    ASSERT_TRUE(path.empty());
+    }
+
+
+TEST(Replanner, RepairsAfterCostChanges){
+    jpsastar::JPSAStar jpsastar( cv::Mat(5, 9, CV_8UC1, cv::Scalar(255)) );
+    jpsastar::Replanner replanner(jpsastar);
+    std::vector<cv::Vec2i> path, expected;
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(0,2), cv::Vec2i(8,2), path) );
+
+    // Expensive middle row, the repaired path goes around it like a new search
+    cv::Mat costs(5, 9, CV_32FC1, cv::Scalar(1));
+    for(int x = 0; x < costs.cols ;++x)
+        costs.at<float>(2, x) = 50.0f;
+    jpsastar.setCosts(costs);
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(0,2), cv::Vec2i(8,2), path) );
+    jpsastar::Replanner fresh(jpsastar);
+    ASSERT_TRUE( fresh.findPath(cv::Vec2i(0,2), cv::Vec2i(8,2), expected) );
+    ASSERT_EQ(expected, path)
+        << "Expected: " << to_string(expected) << "\n"
+        << "  Actual: " << to_string(path);
+
+    jpsastar.setCosts( cv::Mat() );
+    ASSERT_TRUE( replanner.findPath(cv::Vec2i(0,2), cv::Vec2i(8,2), path) );
+    ASSERT_EQ(2u, path.size());
+    }
+
+
+TEST(SearchArena, DecreaseKey){
+    jpsastar::SearchArena arena;
+    arena.reset(3);
+    arena.push(0, 3.0);
+    arena.push(1, 2.0);
+    arena.push(2, 5.0);
+    arena.update(2, 1.0);
+
+    ASSERT_TRUE(arena.isOpen(1));
+    ASSERT_EQ(arena.pop(), 2);
+    ASSERT_EQ(arena.pop(), 1);
+    ASSERT_FALSE(arena.isOpen(1));
+    ASSERT_TRUE(arena.isClosed(1));
+    ASSERT_EQ(arena.pop(), 0);
+    ASSERT_TRUE(arena.empty());
+    }
+
+
+TEST(SearchArena, GenerationReset){
+    jpsastar::SearchArena arena;
+    arena.reset(2);
+    arena.cell(0).g_value = 1.0;
+    arena.push(0, 1.0);
+    arena.pop();
+    arena.reset(2);
+
+    ASSERT_FALSE(arena.isClosed(0));
+    ASSERT_EQ(arena.cell(0).g_value, std::numeric_limits<float>::infinity());
+    }
+
+
+TEST(JPSAStar, AroundWall){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255, 255, 255, 255);
+    std::list<cv::Vec2i> expected;
+    expected.push_back( cv::Vec2i(1,2) );
+    expected.push_back( cv::Vec2i(1,3) );
+    expected.push_back( cv::Vec2i(2,4) );
+    expected.push_back( cv::Vec2i(3,3) );
+    expected.push_back( cv::Vec2i(3,2) );
+
+    jpsastar::JPSAStar jpsastar(map5x5);
+    std::list<cv::Vec2i> path = jpsastar.findPath( cv::Vec2i(1,2), cv::Vec2i(3,2) );
+
+    ASSERT_EQ(expected, path)
+        << "Expected: " << to_string(expected) << "\n"
+        << "  Actual: " << to_string(path);
+    // Second query on the same instance reuses the search arena
+    path = jpsastar.findPath( cv::Vec2i(1,2), cv::Vec2i(3,2) );
+    ASSERT_EQ(expected, path)
+        << "Expected: " << to_string(expected) << "\n"
+        << "  Actual: " << to_string(path);
+    }
+
+
+TEST(JPSAStar, ConcurrentSearchers){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    std::list<cv::Vec2i> expected = jpsastar.findPath( cv::Vec2i(1,2), cv::Vec2i(3,2) );
+    std::vector<int> mismatches(4, 0);
+    std::vector<std::thread> threads;
+
+    for(int t = 0; t < 4 ;++t){
+        threads.push_back(std::thread([&jpsastar, &expected, &mismatches, t](){
+            jpsastar::Searcher searcher(jpsastar);
+            for(int i = 0; i < 200 ;++i){
+                if(searcher.findPath( cv::Vec2i(1,2), cv::Vec2i(3,2) ) != expected)
+                    ++mismatches[t];
+                }
+            }));
+        }
+    // Swapping in an equal map must not disturb running queries
+    for(int i = 0; i < 50 ;++i)
+        jpsastar.setMap(map5x5);
+    for(int t = 0; t < 4 ;++t)
+        threads[t].join();
+
+    ASSERT_EQ(std::vector<int>(4, 0), mismatches);
+    }
+
+
+TEST(JPSAStar, Costs){
+    cv::Mat map7x7 = (cv::Mat_<char>(7,7) << 255, 255, 255, 255, 255, 255, 255,
+                                             255,  85,  85,  85,  85,  85, 255,
+                                             255,  85,   0,   0,   0,  85, 255,
+                                             255,  85,  85, 128,  85,  85, 255,
+                                             255, 255, 255, 128, 255,   0, 255,
+                                               0,   0, 255, 128, 255,   0, 255,
+                                             255, 255, 255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map7x7);
+    jpsastar.setCosts( jpsastar::JPSAStar::greyCosts(map7x7) );
+    jpsastar::Searcher searcher(jpsastar);
+    ASSERT_FLOAT_EQ( 3.0, jpsastar.costs().at<float>(1, 1) );
+    ASSERT_THROW( jpsastar.setCosts(cv::Mat(7, 7, CV_32FC1, cv::Scalar(0.5))), std::invalid_argument );
+    ASSERT_THROW( jpsastar.setCosts(cv::Mat(6, 7, CV_32FC1, cv::Scalar(1.0))), std::invalid_argument );
+
+    for(int round = 0; round < 4 ;++round){
+        // Jump distances are ignored, changed pixels update the uniform regions
+        if(round == 1)
+            jpsastar.preprocess();
+        if(round == 2)
+            searcher.setBidirectional(true);
+        if(round == 3)
+            jpsastar.setCell(3, 4, true);
+        std::shared_ptr<const jpsastar::MapData> data = jpsastar.snapshot();
+        // Shortest costs between all free pixels (Floyd-Warshall)
+        std::vector<double> best(49 * 49, 1e9);
+        auto costs = [&data](const cv::Vec2i &a, const cv::Vec2i &b){
+            cv::Vec2i step = b - a;
+            return std::sqrt( double(step[0] * step[0] + step[1] * step[1]) )
+                 * 0.5 * (data->costs.at<float>(a[1], a[0]) + data->costs.at<float>(b[1], b[0])); };
+        for(int a = 0; a < 49 ;++a){
+            best[a * 49 + a] = 0.0;
+            for(int b = 0; b < 49 ;++b){
+                cv::Vec2i a_vec(a % 7, a / 7), b_vec(b % 7, b / 7);
+                if(   a != b && std::abs(a_vec[0] - b_vec[0]) <= 1 && std::abs(a_vec[1] - b_vec[1]) <= 1
+                   && data->grid.isFree(a_vec[0], a_vec[1]) && data->grid.isFree(b_vec[0], b_vec[1]) )
+                    best[a * 49 + b] = costs(a_vec, b_vec);
+                }
+            }
+        for(int k = 0; k < 49 ;++k)
+            for(int a = 0; a < 49 ;++a)
+                for(int b = 0; b < 49 ;++b)
+                    best[a * 49 + b] = std::min(best[a * 49 + b], best[a * 49 + k] + best[k * 49 + b]);
+
+        for(int start = 0; start < 49 ;++start){
+            for(int target = 0; target < 49 ;++target){
+                cv::Vec2i start_vec(start % 7, start / 7);
+                cv::Vec2i target_vec(target % 7, target / 7);
+                if( !data->grid.isFree(start_vec[0], start_vec[1]) )
+                    continue;
+                std::vector<cv::Vec2i> path;
+                ASSERT_EQ( best[start * 49 + target] < 1e9, searcher.findPath(start_vec, target_vec, path) )
+                    << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec);
+                double path_costs = 0.0;
+                for(size_t i = 1; i < path.size() ;++i){
+                    cv::Vec2i step = path[i] - path[i - 1];
+                    int steps = std::max( std::abs(step[0]), std::abs(step[1]) );
+                    for(int j = 0; j < steps ;++j){
+                        cv::Vec2i from = path[i - 1] + j * cv::Vec2i(step[0] / steps, step[1] / steps);
+                        path_costs += costs( from, from + cv::Vec2i(step[0] / steps, step[1] / steps) );
+                        }
+                    }
+                if( !path.empty() ){
+                    ASSERT_NEAR(best[start * 49 + target], path_costs, 1e-4)
+                        << "Round: " << round << " Query: " << to_string(start_vec) << " -> " << to_string(target_vec) << "\n"
+                        << "  Path: " << to_string(path);
+                    }
+                }
+            }
+        }
+
+    // Costs are stored in map files
+    const std::string file = "unit_tests_costs.map";
+    jpsastar.save(file);
+    jpsastar::JPSAStar loaded(file);
+    for(int y = 0; y < 7 ;++y){
+        for(int x = 0; x < 7 ;++x){
+            ASSERT_EQ( jpsastar.costs().at<float>(y, x), loaded.costs().at<float>(y, x) );
+            ASSERT_EQ( jpsastar.snapshot()->uniform.isFree(x, y), loaded.snapshot()->uniform.isFree(x, y) );
+            }
+        }
+    ASSERT_FALSE( loaded.snapshot()->uniform.isFree(1, 1) );
+    ASSERT_TRUE( loaded.snapshot()->uniform.isFree(6, 6) );
+    std::remove( file.c_str() );
+    jpsastar.setCosts( cv::Mat() );
+    ASSERT_TRUE( jpsastar.costs().empty() );
     }
 
 
@@ -295,6 +1070,470 @@ TEST(JPSAStar, EmptyMap){
     }
 
 
+TEST(JPSAStar, MultiTarget){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0,   0,   0,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    cv::Vec2i start(1,2);
+    std::vector<cv::Vec2i> targets;
+    targets.push_back( cv::Vec2i(4,0) );
+    targets.push_back( cv::Vec2i(1,0) );
+    targets.push_back( cv::Vec2i(4,4) );
+    targets.push_back( cv::Vec2i(1,0) );
+    targets.push_back( cv::Vec2i(2,4) );
+    jpsastar::PathBatch batch;
+
+    // (4,0) is enclosed by walls
+    ASSERT_EQ(4u, jpsastar.findPaths(start, targets, batch));
+    ASSERT_EQ(targets.size(), batch.size());
+    ASSERT_TRUE( batch.empty(0) );
+    for(size_t i = 1; i < targets.size() ;++i){
+        std::vector<cv::Vec2i> expected;
+        jpsastar.findPath(start, targets[i], expected);
+        ASSERT_EQ(expected.back(), *(batch.end(i) - 1));
+        ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(batch.begin(i), batch.end(i)), 1e-4)
+            << "Target: " << to_string(targets[i]);
+        }
+
+    // Only the two closest targets
+    ASSERT_EQ(3u, jpsastar.findPaths(start, targets, batch, 2));
+    ASSERT_TRUE( batch.empty(0) );
+    ASSERT_FALSE( batch.empty(1) );
+    ASSERT_TRUE( batch.empty(2) );
+    ASSERT_FALSE( batch.empty(3) );
+    ASSERT_FALSE( batch.empty(4) );
+
+    targets.push_back( cv::Vec2i(5,0) );
+    ASSERT_THROW(jpsastar.findPaths(start, targets, batch), jpsastar::NotOnMap);
+    }
+
+
+TEST(JPSAStar, UpdateRegion){
+    cv::Mat map6x8 = (cv::Mat_<char>(6,8) << 255, 255, 255, 255, 255, 255, 255, 255,
+                                             255,   0, 255, 255, 255, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255,
+                                             255,   0, 255, 255,   0, 255,   0, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255);
+    jpsastar::JPSAStar jpsastar(map6x8);
+    jpsastar.preprocess();
+    cv::Mat patch = (cv::Mat_<char>(3,2) << 0, 255,
+                                            0, 255,
+                                            0,   0);
+    jpsastar.updateRegion(cv::Rect(3,3,2,3), patch);
+    jpsastar.setCell(6, 1, false);
+    jpsastar.setCell(0, 0, true);
+    // The image passed by the caller stays untouched
+    ASSERT_EQ(255, map6x8.at<uchar>(0,0));
+
+    cv::Mat expected = map6x8.clone();
+    cv::Mat expected_patch = expected(cv::Rect(3,3,2,3));
+    patch.copyTo(expected_patch);
+    expected.at<uchar>(1,6) = 255;
+    expected.at<uchar>(0,0) = 0;
+    jpsastar::JPSAStar rebuilt(expected);
+    rebuilt.preprocess();
+    std::shared_ptr<const jpsastar::MapData> updated = jpsastar.snapshot();
+    ASSERT_EQ(rebuilt.snapshot()->grid.words_, updated->grid.words_);
+    ASSERT_EQ(rebuilt.snapshot()->jumps.owned_, updated->jumps.owned_);
+
+    // Without readers the replaced snapshot is reused by the next update
+    const jpsastar::MapData *spare = jpsastar.spare_.get();
+    updated.reset();
+    jpsastar.setCell(7, 0, true);
+    ASSERT_EQ(spare, jpsastar.snapshot().get());
+
+    ASSERT_THROW(jpsastar.setCell(8, 0, true), jpsastar::NotOnMap);
+    ASSERT_THROW(jpsastar.updateRegion(cv::Rect(0,0,2,2), patch), std::invalid_argument);
+    }
+
+
+TEST(JPSAStar, SaveAndLoad){
+    cv::Mat map6x8 = (cv::Mat_<char>(6,8) << 255, 255, 255, 255, 255, 255, 255, 255,
+                                             255,   0, 255, 255, 255, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255,
+                                             255,   0, 255, 255,   0, 255,   0, 255,
+                                             255, 255, 255, 255, 255, 255,   0, 255);
+    const std::string file = "unit_tests_save_and_load.map";
+    jpsastar::JPSAStar jpsastar(map6x8);
+    jpsastar.preprocess();
+    jpsastar.save(file);
+
+    // Bits and jump distances are used from the mapped file
+    jpsastar::JPSAStar loaded(file);
+    std::shared_ptr<const jpsastar::MapData> data = loaded.snapshot();
+    ASSERT_TRUE( loaded.isPreprocessed() );
+    ASSERT_TRUE( data->grid.words_.empty() );
+    ASSERT_TRUE( data->jumps.owned_.empty() );
+    ASSERT_TRUE( data->components.owned_.empty() );
+    ASSERT_EQ( jpsastar.snapshot()->grid.hash(), data->grid.hash() );
+    ASSERT_EQ( 0, loaded.map().at<uchar>(1, 1) );
+    ASSERT_EQ( 255, loaded.map().at<uchar>(5, 7) );
+    std::vector<cv::Vec2i> path, loaded_path;
+    for(int start = 0; start < 48 ;++start){
+        for(int target = 0; target < 48 ;++target){
+            cv::Vec2i start_vec(start % 8, start / 8);
+            cv::Vec2i target_vec(target % 8, target / 8);
+            ASSERT_EQ( jpsastar.findPath(start_vec, target_vec, path), loaded.findPath(start_vec, target_vec, loaded_path) );
+            ASSERT_EQ(path, loaded_path);
+            }
+        }
+
+    // Updates copy the mapped data
+    jpsastar.setCell(2, 2, true);
+    loaded.setCell(2, 2, true);
+    ASSERT_EQ( jpsastar.snapshot()->grid.words_, loaded.snapshot()->grid.words_ );
+    ASSERT_EQ( jpsastar.snapshot()->jumps.owned_, loaded.snapshot()->jumps.owned_ );
+    ASSERT_EQ( 255, data->map.at<uchar>(2, 2) );
+
+    // A file without jump distances keeps an engine preprocessed
+    jpsastar::JPSAStar plain(map6x8);
+    plain.save(file);
+    loaded.load(file);
+    ASSERT_TRUE( loaded.isPreprocessed() );
+    ASSERT_FALSE( loaded.snapshot()->jumps.empty() );
+
+    std::ofstream(file.c_str(), std::ios::binary) << "not a map";
+    ASSERT_THROW(loaded.load(file), std::runtime_error);
+    std::remove( file.c_str() );
+    ASSERT_THROW(jpsastar::JPSAStar missing(file), std::runtime_error);
+    }
+
+
+TEST(Searcher, AnyAngleAndSmoothing){
+    cv::Mat map7x7 = (cv::Mat_<char>(7,7) << 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255,   0, 255,   0,   0, 255,
+                                             255, 255,   0, 255, 255,   0, 255,
+                                             255,   0,   0,   0, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255,
+                                             255,   0, 255, 255, 255,   0,   0,
+                                             255,   0, 255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map7x7);
+    jpsastar::Searcher smoothing(jpsastar), any_angle(jpsastar);
+    smoothing.setSmoothing(true);
+    any_angle.setAnyAngle(true);
+    ASSERT_TRUE( smoothing.smoothing() );
+    ASSERT_TRUE( any_angle.anyAngle() );
+    const jpsastar::BitGrid &grid = jpsastar.snapshot()->grid;
+
+    for(int start = 0; start < 49 ;++start){
+        for(int target = 0; target < 49 ;++target){
+            cv::Vec2i start_vec(start % 7, start / 7);
+            cv::Vec2i target_vec(target % 7, target / 7);
+            if( !grid.isFree(start_vec[0], start_vec[1]) )
+                continue;
+            std::vector<cv::Vec2i> expected, smoothed, any;
+            bool found = jpsastar.findPath(start_vec, target_vec, expected);
+            ASSERT_EQ( found, smoothing.findPath(start_vec, target_vec, smoothed) );
+            ASSERT_EQ( found, any_angle.findPath(start_vec, target_vec, any) );
+            if(!found)
+                continue;
+            ASSERT_EQ(target_vec, smoothed.back());
+            ASSERT_EQ(target_vec, any.back());
+            ASSERT_LE(smoothed.size(), expected.size());
+            ASSERT_LE(pathLength(smoothed.begin(), smoothed.end()), pathLength(expected.begin(), expected.end()) + 1e-4)
+                << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec);
+            for(size_t i = 1; i < smoothed.size() ;++i)
+                ASSERT_TRUE( grid.lineOfSight(smoothed[i - 1], smoothed[i], false) ) << "Path: " << to_string(smoothed);
+            for(size_t i = 1; i < any.size() ;++i)
+                ASSERT_TRUE( grid.lineOfSight(any[i - 1], any[i], false) ) << "Path: " << to_string(any);
+            }
+        }
+    // Diagonal staircase below the wall of row 3 is replaced by a single line
+    std::list<cv::Vec2i> path = smoothing.findPath( cv::Vec2i(0,0), cv::Vec2i(6,6) );
+    std::vector<cv::Vec2i> expected = { cv::Vec2i(0,0), cv::Vec2i(0,3), cv::Vec2i(3,6), cv::Vec2i(6,6) };
+    ASSERT_EQ( to_string(expected), to_string(path) );
+    }
+
+
+#ifndef JPSASTAR_NO_STATS
+TEST(Searcher, BidirectionalSameCosts){
+    cv::Mat map7x7 = (cv::Mat_<char>(7,7) << 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255,   0, 255,   0,   0, 255,
+                                             255, 255,   0, 255, 255,   0, 255,
+                                             255,   0,   0,   0, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255,
+                                             255,   0, 255, 255, 255,   0,   0,
+                                             255,   0, 255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map7x7);
+    jpsastar::Searcher searcher(jpsastar);
+    searcher.setBidirectional(true);
+    ASSERT_TRUE( searcher.bidirectional() );
+
+    for(int preprocess = 0; preprocess < 2 ;++preprocess){
+        if(preprocess)
+            jpsastar.preprocess();
+        for(int start = 0; start < 49 ;++start){
+            for(int target = 0; target < 49 ;++target){
+                cv::Vec2i start_vec(start % 7, start / 7);
+                cv::Vec2i target_vec(target % 7, target / 7);
+                std::vector<cv::Vec2i> expected, path;
+                bool found = jpsastar.findPath(start_vec, target_vec, expected);
+                ASSERT_EQ( found, searcher.findPath(start_vec, target_vec, path) )
+                    << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec);
+                if(!found)
+                    continue;
+                ASSERT_EQ(start_vec, path.front());
+                ASSERT_EQ(target_vec, path.back());
+                ASSERT_NEAR(pathLength(expected.begin(), expected.end()), pathLength(path.begin(), path.end()), 1e-4)
+                    << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec) << "\n"
+                    << "Expected: " << to_string(expected) << "\n"
+                    << "  Actual: " << to_string(path);
+                }
+            }
+        }
+    }
+
+#endif
+
+
+TEST(Searcher, Limits){
+    // Serpentine corridors, the path visits every row
+    cv::Mat map(64, 64, CV_8UC1, cv::Scalar(255));
+    for(int y = 1; y < map.rows ;y += 2)
+        for(int x = 0; x < map.cols ;++x)
+            if( x != ((y / 2) % 2 == 0 ? map.cols - 1 : 0) )
+                map.at<uchar>(y,x) = 0;
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::Searcher searcher(jpsastar);
+    const cv::Vec2i start(0,0), target(0,62);
+    std::vector<cv::Vec2i> path;
+    ASSERT_TRUE( searcher.findPath(start, target, path) );
+    ASSERT_EQ(jpsastar::SearchLimits::NONE, searcher.stopped());
+
+    jpsastar::SearchLimits limits;
+    limits.max_popped = 5;
+    limits.partial_path = true;
+    searcher.setLimits(limits);
+    for(int bidirectional = 0; bidirectional < 2 ;++bidirectional){
+        searcher.setBidirectional(bidirectional);
+        ASSERT_FALSE( searcher.findPath(start, target, path) );
+        ASSERT_EQ(jpsastar::SearchLimits::POPPED, searcher.stopped());
+        ASSERT_FALSE( path.empty() );
+        ASSERT_EQ(start, path.front());
+        ASSERT_NE(target, path.back());
+        }
+    searcher.setBidirectional(false);
+
+    limits = jpsastar::SearchLimits();
+    limits.max_scanned = 100;
+    searcher.setLimits(limits);
+    ASSERT_FALSE( searcher.findPath(start, target, path) );
+    ASSERT_EQ(jpsastar::SearchLimits::SCANNED, searcher.stopped());
+    ASSERT_TRUE( path.empty() );
+
+    std::atomic<bool> cancel(true);
+    limits = jpsastar::SearchLimits();
+    limits.cancel = &cancel;
+    searcher.setLimits(limits);
+    ASSERT_FALSE( searcher.findPath(start, target, path) );
+    ASSERT_EQ(jpsastar::SearchLimits::CANCELLED, searcher.stopped());
+    cancel = false;
+    ASSERT_TRUE( searcher.findPath(start, target, path) );
+    ASSERT_EQ(jpsastar::SearchLimits::NONE, searcher.stopped());
+
+    limits = jpsastar::SearchLimits();
+    limits.deadline = std::chrono::steady_clock::now();
+    searcher.setLimits(limits);
+    searcher.setAnyAngle(true);
+    ASSERT_FALSE( searcher.findPath(start, target, path) );
+    ASSERT_EQ(jpsastar::SearchLimits::DEADLINE, searcher.stopped());
+    }
+
+
+/**
+ *  Compares the paths of a movement model with shortest paths between all pairs of free pixels
+ *
+ *  \param map      8 bit map which is searched
+ *  \param diagonal 0 if diagonal steps are not allowed, 1 if they must not cut corners, 2 otherwise
+**/
+template<class Movement>
+void checkMovement(const cv::Mat &map, int diagonal){
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::BasicSearcher<Movement> searcher(jpsastar);
+    const jpsastar::BitGrid &grid = jpsastar.snapshot()->grid;
+    const int cells = map.rows * map.cols;
+    auto allowed = [&grid, diagonal](const cv::Vec2i &from, const cv::Vec2i &to){
+        if( !grid.isFree(from[0], from[1]) || !grid.isFree(to[0], to[1]) )
+            return false;
+        if(from[0] == to[0] || from[1] == to[1])
+            return true;
+        return diagonal == 2 || ( diagonal == 1 && grid.isFree(to[0], from[1]) && grid.isFree(from[0], to[1]) ); };
+    // Shortest costs between all free pixels (Floyd-Warshall)
+    std::vector<double> best(cells * cells, 1e9);
+    for(int a = 0; a < cells ;++a){
+        best[a * cells + a] = 0.0;
+        for(int b = 0; b < cells ;++b){
+            cv::Vec2i a_vec(a % map.cols, a / map.cols), b_vec(b % map.cols, b / map.cols);
+            if( a != b && std::abs(a_vec[0] - b_vec[0]) <= 1 && std::abs(a_vec[1] - b_vec[1]) <= 1 && allowed(a_vec, b_vec) )
+                best[a * cells + b] = a_vec[0] == b_vec[0] || a_vec[1] == b_vec[1] ? 1.0 : std::sqrt(2.0);
+            }
+        }
+    for(int k = 0; k < cells ;++k)
+        for(int a = 0; a < cells ;++a)
+            for(int b = 0; b < cells ;++b)
+                best[a * cells + b] = std::min(best[a * cells + b], best[a * cells + k] + best[k * cells + b]);
+
+    for(int bidirectional = 0; bidirectional < 2 ;++bidirectional){
+        searcher.setBidirectional(bidirectional);
+        for(int start = 0; start < cells ;++start){
+            for(int target = 0; target < cells ;++target){
+                cv::Vec2i start_vec(start % map.cols, start / map.cols);
+                cv::Vec2i target_vec(target % map.cols, target / map.cols);
+                if( !grid.isFree(start_vec[0], start_vec[1]) )
+                    continue;
+                std::vector<cv::Vec2i> path;
+                ASSERT_EQ( best[start * cells + target] < 1e9, searcher.findPath(start_vec, target_vec, path) )
+                    << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec);
+                if( path.empty() )
+                    continue;
+                // Every step of the path has to be allowed by the movement model
+                for(size_t i = 1; i < path.size() ;++i){
+                    cv::Vec2i step = path[i] - path[i - 1];
+                    int steps = std::max( std::abs(step[0]), std::abs(step[1]) );
+                    for(int j = 0; j < steps ;++j){
+                        cv::Vec2i from = path[i - 1] + j * cv::Vec2i(step[0] / steps, step[1] / steps);
+                        ASSERT_TRUE( allowed(from, from + cv::Vec2i(step[0] / steps, step[1] / steps)) )
+                            << "Path: " << to_string(path);
+                        }
+                    }
+                ASSERT_NEAR(best[start * cells + target], pathLength(path.begin(), path.end()), 1e-4)
+                    << "Query: " << to_string(start_vec) << " -> " << to_string(target_vec) << "\n"
+                    << "Path: " << to_string(path);
+                }
+            }
+        }
+    }
+
+
+TEST(Searcher, MovementModels){
+    cv::Mat map7x7 = (cv::Mat_<char>(7,7) << 255, 255,   0, 255, 255, 255, 255,
+                                             255, 255,   0, 255,   0,   0, 255,
+                                             255, 255, 255,   0, 255,   0, 255,
+                                             255,   0,   0, 255, 255,   0, 255,
+                                             255, 255, 255,   0, 255, 255, 255,
+                                             255,   0, 255, 255,   0,   0,   0,
+                                             255,   0, 255, 255, 255,   0, 255);
+    checkMovement<jpsastar::CornerCutting>(map7x7, 2);
+    checkMovement<jpsastar::NoCornerCutting>(map7x7, 1);
+    checkMovement<jpsastar::FourConnected>(map7x7, 0);
+    // Without corner cutting the scan stops at a free side pixel behind an occupied one
+    jpsastar::BitGrid grid(map7x7);
+    ASSERT_EQ(1, grid.scanRow(1, 4, 1));
+    ASSERT_EQ(2, grid.scanRowPastCorners(1, 4, 1));
+    ASSERT_EQ(3, grid.scanColumn(6, 1, 1));
+    ASSERT_EQ(4, grid.scanColumnPastCorners(6, 1, 1));
+    }
+
+
+#ifndef JPSASTAR_NO_STATS
+TEST(Searcher, StatsAndTrace){
+    cv::Mat map5x5 = (cv::Mat_<char>(5,5) << 255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255,   0, 255, 255,
+                                             255, 255, 255, 255, 255);
+    jpsastar::JPSAStar jpsastar(map5x5);
+    jpsastar::Searcher searcher(jpsastar);
+    std::vector<cv::Vec2i> expanded;
+    searcher.setTrace([&expanded](const cv::Vec2i &node, const cv::Vec2i &, float){
+        expanded.push_back(node); });
+    std::vector<cv::Vec2i> path;
+
+    ASSERT_TRUE( searcher.findPath(cv::Vec2i(1,2), cv::Vec2i(3,2), path) );
+    const jpsastar::SearchStats &stats = searcher.stats();
+    ASSERT_EQ(expanded.size(), stats.popped);
+    ASSERT_EQ(cv::Vec2i(1,2), expanded.front());
+    ASSERT_EQ(cv::Vec2i(3,2), expanded.back());
+    ASSERT_LE(stats.popped, stats.pushed);
+    ASSERT_LE(stats.open_peak, stats.pushed);
+    ASSERT_LT(0u, stats.jumps);
+    ASSERT_LT(0u, stats.scanned);
+
+    jpsastar::SearchStats engine_stats;
+    jpsastar.findPath(cv::Vec2i(1,2), cv::Vec2i(3,2), path, &engine_stats);
+    ASSERT_EQ(stats.popped, engine_stats.popped);
+    ASSERT_EQ(stats.jumps, engine_stats.jumps);
+    }
+#endif
+
+
+TEST(Searcher, WeightAndAnytime){
+    cv::Mat map(40, 40, CV_8UC1, cv::Scalar(255));
+    for(int y = 0; y < map.rows ;++y)
+        for(int x = 0; x < map.cols ;++x)
+            if( (x * 7 + y * 13) % 11 == 0 || (x % 8 == 4 && y % 10 != 2) )
+                map.at<uchar>(y,x) = 0;
+    jpsastar::JPSAStar jpsastar(map);
+    jpsastar::Searcher searcher(jpsastar);
+    const cv::Vec2i start(1,1), target(38,37);
+    std::vector<cv::Vec2i> path;
+    ASSERT_TRUE( searcher.findPath(start, target, path) );
+    const double shortest = pathLength(path.begin(), path.end());
+
+    ASSERT_THROW(searcher.setWeight(0.5f), std::invalid_argument);
+    ASSERT_THROW(searcher.setWeight(std::numeric_limits<float>::infinity()), std::invalid_argument);
+    searcher.setWeight(3.0f);
+    ASSERT_TRUE( searcher.findPath(start, target, path) );
+    ASSERT_LE(pathLength(path.begin(), path.end()), 3.0 * shortest + 1e-4);
+
+    // Without limits the anytime search ends with a shortest path
+    float bound;
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    ASSERT_TRUE( searcher.findPathAnytime(start, target, path, bound, deadline) );
+    ASSERT_EQ(1.0f, bound);
+    ASSERT_NEAR(shortest, pathLength(path.begin(), path.end()), 1e-4);
+    ASSERT_EQ(start, path.front());
+    ASSERT_EQ(target, path.back());
+
+    // A node budget stops the improvements, the bound still holds
+    for(size_t max_popped = 1; max_popped < 200 ;max_popped += 7){
+        if( !searcher.findPathAnytime(start, target, path, bound, deadline, max_popped) )
+            continue;
+        ASSERT_LE(1.0f, bound);
+        ASSERT_LE(bound, 3.0f);
+        ASSERT_LE(pathLength(path.begin(), path.end()), bound * shortest + 1e-4);
+        }
+    ASSERT_FALSE( searcher.findPathAnytime(start, target, path, bound, std::chrono::steady_clock::now()) );
+    ASSERT_TRUE( path.empty() );
+    }
+
+
+TEST(TargetSet, NextInLine){
+    std::vector<cv::Vec2i> targets;
+    targets.push_back( cv::Vec2i(3,1) );
+    targets.push_back( cv::Vec2i(7,1) );
+    targets.push_back( cv::Vec2i(3,5) );
+    targets.push_back( cv::Vec2i(3,1) );
+    jpsastar::TargetSet set;
+    set.assign(targets.data(), targets.size());
+
+    ASSERT_EQ(3u, set.size());
+    ASSERT_TRUE( set.contains(7,1) );
+    ASSERT_FALSE( set.contains(1,7) );
+    ASSERT_EQ(3, set.nextInRow(0, 1, 1));
+    ASSERT_EQ(3, set.nextInRow(3, 1, 1));
+    ASSERT_EQ(7, set.nextInRow(4, 1, 1));
+    ASSERT_EQ(-1, set.nextInRow(8, 1, 1));
+    ASSERT_EQ(3, set.nextInRow(6, 1, -1));
+    ASSERT_EQ(-1, set.nextInRow(2, 1, -1));
+    ASSERT_EQ(-1, set.nextInRow(0, 2, 1));
+    ASSERT_EQ(5, set.nextInColumn(3, 2, 1));
+    ASSERT_EQ(1, set.nextInColumn(3, 4, -1));
+    ASSERT_EQ(-1, set.nextInColumn(7, 2, 1));
+    ASSERT_EQ(5, set.nextRow(1, 1));
+    ASSERT_EQ(1, set.nextRow(5, -1));
+    ASSERT_EQ(-1, set.nextRow(1, -1));
+    ASSERT_EQ(7, set.nextColumn(3, 1));
+    ASSERT_EQ(-1, set.nextColumn(7, 1));
+    ASSERT_EQ(3, set.nextColumn(7, -1));
+    }
+
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();